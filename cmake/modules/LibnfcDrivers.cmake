@@ -2,6 +2,7 @@ SET(LIBNFC_DRIVER_ACR122 ON CACHE BOOL "Enable ACR122 support (Depends on PC/SC)
 SET(LIBNFC_DRIVER_PN53X_USB ON CACHE BOOL "Enable PN531 and PN531 USB support (Depends on libusb)")
 SET(LIBNFC_DRIVER_ARYGON ON CACHE BOOL "Enable ARYGON support (Use serial port)")
 SET(LIBNFC_DRIVER_PN532_UART OFF CACHE BOOL "Enable PN532 UART support (Use serial port)")
+SET(LIBNFC_DRIVER_PN53X_REPLAY ON CACHE BOOL "Enable PN53x frames replay support (Use a recorded trace)")
 
 IF(LIBNFC_DRIVER_ACR122)
   FIND_PACKAGE(PCSC REQUIRED)
@@ -25,5 +26,10 @@ IF(LIBNFC_DRIVER_PN532_UART)
   SET(DRIVERS_SOURCES ${DRIVERS_SOURCES} "drivers/pn532_uart")
 ENDIF(LIBNFC_DRIVER_PN532_UART)
 
+IF(LIBNFC_DRIVER_PN53X_REPLAY)
+  ADD_DEFINITIONS("-DDRIVER_PN53X_REPLAY_ENABLED")
+  SET(DRIVERS_SOURCES ${DRIVERS_SOURCES} "drivers/pn53x_replay")
+ENDIF(LIBNFC_DRIVER_PN53X_REPLAY)
+
 INCLUDE_DIRECTORIES(${CMAKE_CURRENT_SOURCE_DIR}/drivers)
 
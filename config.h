@@ -0,0 +1,4 @@
+#define PACKAGE_NAME "libnfc"
+#define PACKAGE_VERSION "1.6.0"
+#define PACKAGE_STRING "libnfc 1.6.0"
+#define _XOPEN_SOURCE 600
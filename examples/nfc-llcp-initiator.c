@@ -0,0 +1,132 @@
+/*-
+ * Public platform independent Near Field Communication (NFC) library examples
+ *
+ * Copyright (C) 2012 Romuald Conty
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  1) Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *  2 )Redistributions in binary form must reproduce the above copyright
+ *  notice, this list of conditions and the following disclaimer in the
+ *  documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Note that this license only applies on the examples, NFC library itself is under LGPL
+ *
+ */
+
+/**
+ * @file nfc-llcp-initiator.c
+ * @brief Turns the NFC device into a LLCP initiator and talks to an echo service (see NFC Forum LLCP)
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+
+#include <nfc/nfc.h>
+#include <nfc/nfc-llcp.h>
+
+#include "utils/nfc-utils.h"
+
+#define ECHO_SERVICE_NAME "urn:nfc:xsn:libnfc.org:echo"
+
+static nfc_device *pnd;
+
+static void stop_llcp_communication(int sig)
+{
+  (void) sig;
+  if (pnd)
+    nfc_abort_command(pnd);
+  else
+    exit(EXIT_FAILURE);
+}
+
+int
+main(int argc, const char *argv[])
+{
+  uint8_t  abtRx[NFC_LLCP_MIU_MAX + 1];
+  const char *pcTx = "Hello World!";
+  nfc_llcp_link *link = NULL;
+  int connection;
+  int res;
+  int iExitCode = EXIT_FAILURE;
+
+  if (argc > 2) {
+    printf("Usage: %s [message]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  if (argc == 2)
+    pcTx = argv[1];
+
+  nfc_init(NULL);
+
+  pnd = nfc_open(NULL, NULL);
+  if (!pnd) {
+    printf("Unable to open NFC device.\n");
+    return EXIT_FAILURE;
+  }
+  printf("NFC device: %s opened\n", nfc_device_get_name(pnd));
+
+  signal(SIGINT, stop_llcp_communication);
+
+  if (nfc_initiator_init(pnd) < 0) {
+    nfc_perror(pnd, "nfc_initiator_init");
+    goto error;
+  }
+  if (!(link = nfc_llcp_link_new(pnd, NULL))) {
+    printf("Unable to allocate LLCP link.\n");
+    goto error;
+  }
+  if ((res = nfc_llcp_link_activate_initiator(link, NDM_PASSIVE, NBR_212, 1000)) < 0) {
+    printf("Unable to activate LLCP link: %s\n", nfc_strerror(pnd));
+    goto error;
+  }
+  nfc_llcp_params remote;
+  nfc_llcp_link_get_remote_params(link, &remote);
+  printf("LLCP link activated (remote MIU %d, LTO %d ms)\n", (int) remote.szMiu, remote.iLto);
+
+  if ((connection = nfc_llcp_connect(link, 0, ECHO_SERVICE_NAME, 1000)) < 0) {
+    printf("Unable to connect to \"%s\".\n", ECHO_SERVICE_NAME);
+    goto deactivate;
+  }
+  printf("Sending: %s\n", pcTx);
+  if (nfc_llcp_send(link, connection, (const uint8_t *) pcTx, strlen(pcTx), 1000) < 0) {
+    printf("Unable to send data.\n");
+    goto close;
+  }
+  if ((res = nfc_llcp_receive(link, connection, abtRx, sizeof(abtRx) - 1, 1000)) < 0) {
+    printf("Unable to receive data.\n");
+    goto close;
+  }
+  abtRx[res] = '\0';
+  printf("Received: %s\n", abtRx);
+  iExitCode = EXIT_SUCCESS;
+
+close:
+  nfc_llcp_close(link, connection, 1000);
+deactivate:
+  nfc_llcp_link_deactivate(link);
+error:
+  nfc_llcp_link_free(link);
+  nfc_close(pnd);
+  nfc_exit(NULL);
+  return iExitCode;
+}
@@ -0,0 +1,140 @@
+/*-
+ * Public platform independent Near Field Communication (NFC) library examples
+ *
+ * Copyright (C) 2012 Romuald Conty
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  1) Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *  2 )Redistributions in binary form must reproduce the above copyright
+ *  notice, this list of conditions and the following disclaimer in the
+ *  documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Note that this license only applies on the examples, NFC library itself is under LGPL
+ *
+ */
+
+/**
+ * @file nfc-llcp-target.c
+ * @brief Turns the NFC device into a LLCP target running an echo service (see NFC Forum LLCP)
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+
+#include <nfc/nfc.h>
+#include <nfc/nfc-llcp.h>
+
+#include "utils/nfc-utils.h"
+
+#define ECHO_SERVICE_NAME "urn:nfc:xsn:libnfc.org:echo"
+// Echo service is reachable by name only
+#define ECHO_SAP 16
+
+static nfc_device *pnd;
+
+static void stop_llcp_communication(int sig)
+{
+  (void) sig;
+  if (pnd)
+    nfc_abort_command(pnd);
+  else
+    exit(EXIT_FAILURE);
+}
+
+int
+main(int argc, const char *argv[])
+{
+  uint8_t  abtRx[NFC_LLCP_MIU_MAX + 1];
+  nfc_llcp_link *link = NULL;
+  int connection;
+  int res;
+  int iExitCode = EXIT_FAILURE;
+#define MAX_DEVICE_COUNT 2
+  nfc_connstring connstrings[MAX_DEVICE_COUNT];
+  size_t szDeviceFound = nfc_list_devices(NULL, connstrings, MAX_DEVICE_COUNT);
+  // Like nfc-dep-target: if there is more than one reader, the second one is
+  // opened so that nfc-llcp-initiator can use the first one
+  nfc_init(NULL);
+  if (szDeviceFound == 1) {
+    pnd = nfc_open(NULL, connstrings[0]);
+  } else if (szDeviceFound > 1) {
+    pnd = nfc_open(NULL, connstrings[1]);
+  } else {
+    printf("No device found.\n");
+    return EXIT_FAILURE;
+  }
+
+  if (argc > 1) {
+    printf("Usage: %s\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  if (!pnd) {
+    printf("Unable to open NFC device.\n");
+    return EXIT_FAILURE;
+  }
+  printf("NFC device: %s opened\n", nfc_device_get_name(pnd));
+
+  signal(SIGINT, stop_llcp_communication);
+
+  if (!(link = nfc_llcp_link_new(pnd, NULL))) {
+    printf("Unable to allocate LLCP link.\n");
+    goto error;
+  }
+  // Services have to be registered before activation
+  if (nfc_llcp_listen(link, ECHO_SAP, ECHO_SERVICE_NAME) < 0) {
+    printf("Unable to listen on SAP %d.\n", ECHO_SAP);
+    goto error;
+  }
+
+  printf("Waiting for initiator request...\n");
+  if ((res = nfc_llcp_link_activate_target(link, 0)) < 0) {
+    printf("Unable to activate LLCP link: %s\n", nfc_strerror(pnd));
+    goto error;
+  }
+  printf("LLCP link activated. Waiting for a connection to \"%s\"...\n", ECHO_SERVICE_NAME);
+  if ((connection = nfc_llcp_accept(link, ECHO_SAP, 0)) < 0) {
+    printf("Unable to accept a connection.\n");
+    goto deactivate;
+  }
+
+  // Every SDU is sent back until the initiator closes the connection
+  while ((res = nfc_llcp_receive(link, connection, abtRx, sizeof(abtRx) - 1, 0)) > 0) {
+    abtRx[res] = '\0';
+    printf("Received: %s\n", abtRx);
+    if (nfc_llcp_send(link, connection, abtRx, res, 0) < 0)
+      break;
+  }
+  printf("Connection closed.\n");
+  iExitCode = EXIT_SUCCESS;
+  nfc_llcp_close(link, connection, 1000);
+
+deactivate:
+  // Keep the link up until the initiator deactivates it
+  while (nfc_llcp_link_service(link, 0) >= 0)
+    ;
+error:
+  nfc_llcp_link_free(link);
+  nfc_close(pnd);
+  nfc_exit(NULL);
+  return iExitCode;
+}
@@ -0,0 +1,216 @@
+/*-
+ * Public platform independent Near Field Communication (NFC) library examples
+ *
+ * Copyright (C) 2012 Romuald Conty
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *  1) Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *  2 )Redistributions in binary form must reproduce the above copyright
+ *  notice, this list of conditions and the following disclaimer in the
+ *  documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Note that this license only applies on the examples, NFC library itself is under LGPL
+ *
+ */
+
+/**
+ * @file pn53x-frame-recorder.c
+ * @brief Decode frames recorded by libnfc's frame recorder
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <nfc/nfc.h>
+
+#include "utils/nfc-utils.h"
+#include "libnfc/chips/pn53x.h"
+
+#define MAX_RECORD_COUNT 64
+
+static const char *
+command_name(const uint8_t ui8Command)
+{
+  if ((ui8Command < (sizeof(pn53x_commands) / sizeof(pn53x_command))) && pn53x_commands[ui8Command].abtCommandText)
+    return pn53x_commands[ui8Command].abtCommandText;
+  return "Unknown";
+}
+
+static const char *
+register_name(const uint16_t ui16Address)
+{
+  if (((ui16Address & 0xFFC0) == 0x6300) || ((ui16Address & 0xFF00) == 0xFF00)) {
+    const pn53x_register *pr = &pn53x_registers[PNREG_INDEX(ui16Address)];
+    if (pr->ui16Address == ui16Address)
+      return pr->abtRegisterText;
+  }
+  return NULL;
+}
+
+static void
+print_registers(const nfc_frame_record *pnfr, const size_t szStep)
+{
+  const size_t szData = (pnfr->szData < NFC_FRAME_RECORD_DATA_LEN) ? pnfr->szData : NFC_FRAME_RECORD_DATA_LEN;
+  for (size_t n = 1; n + 1 < szData; n += szStep) {
+    const uint16_t ui16Address = (pnfr->abtData[n] << 8) | pnfr->abtData[n + 1];
+    const char *pcName = register_name(ui16Address);
+    if (pcName)
+      printf("  %s", pcName);
+    else
+      printf("  0x%04x", ui16Address);
+    if ((szStep == 3) && (n + 2 < szData))
+      printf("=%02x", pnfr->abtData[n + 2]);
+  }
+  printf("\n");
+}
+
+static void
+print_records(const nfc_frame_record records[], const size_t szRecords)
+{
+  for (size_t n = 0; n < szRecords; n++) {
+    const nfc_frame_record *pnfr = &records[n];
+    const double dElapsed = (pnfr->i64Timestamp - records[0].i64Timestamp) / 1000.0;
+
+    printf("+%10.3f ms  %s  %s", dElapsed, (pnfr->nfd == NFD_TX) ? "TX" : "RX", command_name(pnfr->ui8Command));
+    if (pnfr->iResult < 0)
+      printf("  error %d", pnfr->iResult);
+    printf("\n");
+
+    if (pnfr->szData) {
+      printf("               ");
+      print_hex(pnfr->abtData, (pnfr->szData < NFC_FRAME_RECORD_DATA_LEN) ? pnfr->szData : NFC_FRAME_RECORD_DATA_LEN);
+      if (pnfr->szData > NFC_FRAME_RECORD_DATA_LEN)
+        printf("               (%lu more bytes not recorded)\n", (unsigned long)(pnfr->szData - NFC_FRAME_RECORD_DATA_LEN));
+    }
+    if (pnfr->nfd == NFD_TX) {
+      if (pnfr->ui8Command == ReadRegister) {
+        printf("             ");
+        print_registers(pnfr, 2);
+      } else if (pnfr->ui8Command == WriteRegister) {
+        printf("             ");
+        print_registers(pnfr, 3);
+      }
+    }
+  }
+}
+
+// Text trace, as read by the pn53x_replay driver
+static void
+print_trace(const nfc_frame_record records[], const size_t szRecords)
+{
+  for (size_t n = 0; n < szRecords; n++) {
+    const nfc_frame_record *pnfr = &records[n];
+
+    printf("%s %lld", (pnfr->nfd == NFD_TX) ? "TX" : "RX", (long long) pnfr->i64Timestamp);
+    if (pnfr->iResult < 0) {
+      printf(" error %d\n", pnfr->iResult);
+      continue;
+    }
+    for (size_t szPos = 0; (szPos < pnfr->szData) && (szPos < NFC_FRAME_RECORD_DATA_LEN); szPos++)
+      printf(" %02x", pnfr->abtData[szPos]);
+    printf("%s\n", (pnfr->szData > NFC_FRAME_RECORD_DATA_LEN) ? " ..." : "");
+  }
+}
+
+static void
+print_usage(const char *progname)
+{
+  printf("usage: %s [-t] [-w FILE] [DUMP]\n", progname);
+  printf("  DUMP     decode records previously saved with nfc_device_get_frame_records()\n");
+  printf("           without DUMP, records the frames of a passive target selection on the first device\n");
+  printf("  -t       print records as a text trace, to be replayed with \"pn53x_replay:FILE\" connstring\n");
+  printf("  -w FILE  save these records to FILE\n");
+}
+
+int
+main(int argc, const char *argv[])
+{
+  const char *pcDumpFile = NULL;
+  const char *pcSaveFile = NULL;
+  bool bTrace = false;
+  nfc_frame_record records[MAX_RECORD_COUNT];
+  int iRecords;
+
+  for (int arg = 1; arg < argc; arg++) {
+    if (0 == strcmp(argv[arg], "-t")) {
+      bTrace = true;
+    } else if ((0 == strcmp(argv[arg], "-w")) && (arg + 1 < argc)) {
+      pcSaveFile = argv[++arg];
+    } else if ((argv[arg][0] != '-') && !pcDumpFile) {
+      pcDumpFile = argv[arg];
+    } else {
+      print_usage(argv[0]);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  if (pcDumpFile) {
+    FILE *fp = fopen(pcDumpFile, "rb");
+    if (!fp)
+      err(EXIT_FAILURE, "%s", pcDumpFile);
+    iRecords = fread(records, sizeof(nfc_frame_record), MAX_RECORD_COUNT, fp);
+    fclose(fp);
+  } else {
+    nfc_init(NULL);
+    nfc_device *pnd = nfc_open(NULL, NULL);
+    if (pnd == NULL) {
+      ERR("%s", "Unable to open NFC device.");
+      nfc_exit(NULL);
+      exit(EXIT_FAILURE);
+    }
+    printf("NFC reader: %s opened\n", nfc_device_get_name(pnd));
+
+    nfc_target nt;
+    const nfc_modulation nmMifare = {
+      .nmt = NMT_ISO14443A,
+      .nbr = NBR_106,
+    };
+    if ((nfc_initiator_init(pnd) < 0) ||
+        (nfc_device_set_property_bool(pnd, NP_INFINITE_SELECT, false) < 0) ||
+        (nfc_initiator_select_passive_target(pnd, nmMifare, NULL, 0, &nt) < 0)) {
+      nfc_perror(pnd, "nfc_initiator_select_passive_target");
+    }
+    iRecords = nfc_device_get_frame_records(pnd, records, MAX_RECORD_COUNT);
+    nfc_close(pnd);
+    nfc_exit(NULL);
+  }
+  if (iRecords < 0) {
+    ERR("%s", "Unable to get frame records.");
+    exit(EXIT_FAILURE);
+  }
+
+  if (bTrace)
+    print_trace(records, iRecords);
+  else
+    print_records(records, iRecords);
+
+  if (pcSaveFile) {
+    FILE *fp = fopen(pcSaveFile, "wb");
+    if (!fp)
+      err(EXIT_FAILURE, "%s", pcSaveFile);
+    if (fwrite(records, sizeof(nfc_frame_record), iRecords, fp) != (size_t) iRecords)
+      err(EXIT_FAILURE, "%s", pcSaveFile);
+    fclose(fp);
+  }
+  exit(EXIT_SUCCESS);
+}
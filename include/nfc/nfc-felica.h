@@ -0,0 +1,70 @@
+/*-
+ * Public platform independent Near Field Communication (NFC) library
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/**
+ * @file nfc-felica.h
+ * @brief Provide a small API to read and write FeliCa blocks (NFC Forum Type 3 tags)
+ */
+
+#ifndef __NFC_FELICA_H__
+#define __NFC_FELICA_H__
+
+#include <sys/types.h>
+#include <nfc/nfc.h>
+
+#ifdef __cplusplus
+extern  "C" {
+#endif /* __cplusplus */
+
+  /** Size of a FeliCa block */
+#define NFC_FELICA_BLOCK_LEN 16
+  /** NFC Forum Type 3 tag NDEF service, read/write access */
+#define NFC_FELICA_SERVICE_NDEF_RW 0x0009
+  /** NFC Forum Type 3 tag NDEF service, read-only access */
+#define NFC_FELICA_SERVICE_NDEF_RO 0x000b
+
+  /**
+   * @struct nfc_felica_attribute_info
+   * @brief NFC Forum Type 3 tag attribute information block (block 0 of NDEF service)
+   */
+  typedef struct {
+    /** NDEF mapping version (major version in upper nibble) */
+    uint8_t ui8Version;
+    /** Nbr: maximum number of blocks read by a Check command */
+    uint8_t ui8Nbr;
+    /** Nbw: maximum number of blocks written by an Update command */
+    uint8_t ui8Nbw;
+    /** Nmaxb: maximum number of blocks of NDEF data */
+    uint16_t ui16Nmaxb;
+    /** WriteFlag: 0x0f while a write is in progress */
+    uint8_t ui8WriteFlag;
+    /** RWFlag: 0x01 when NDEF data can be written */
+    uint8_t ui8RwFlag;
+    /** Ln: NDEF message length in bytes */
+    uint32_t ui32Ln;
+  } nfc_felica_attribute_info;
+
+  NFC_EXPORT int nfc_felica_check(nfc_device *pnd, const nfc_target *pnt, const uint16_t ui16ServiceCode, const uint16_t ui16FirstBlock, uint8_t *pbtData, const size_t szBlocks, const size_t szMaxBlocks);
+  NFC_EXPORT int nfc_felica_update(nfc_device *pnd, const nfc_target *pnt, const uint16_t ui16ServiceCode, const uint16_t ui16FirstBlock, const uint8_t *pbtData, const size_t szBlocks, const size_t szMaxBlocks);
+  NFC_EXPORT int nfc_felica_read_attribute_info(nfc_device *pnd, const nfc_target *pnt, nfc_felica_attribute_info *pnfai);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+
+#endif /* __NFC_FELICA_H__ */
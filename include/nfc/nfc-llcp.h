@@ -0,0 +1,83 @@
+/*-
+ * Public platform independent Near Field Communication (NFC) library
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/**
+ * @file nfc-llcp.h
+ * @brief Provide NFC Forum Logical Link Control Protocol (LLCP) over D.E.P.
+ */
+
+#ifndef __NFC_LLCP_H__
+#define __NFC_LLCP_H__
+
+#include <sys/types.h>
+#include <nfc/nfc.h>
+
+#ifdef __cplusplus
+extern  "C" {
+#endif /* __cplusplus */
+
+  /** Largest MIU (Maximum Information Unit): an I PDU has to fit in a single D.E.P. frame */
+#define NFC_LLCP_MIU_MAX 245
+  /** Largest receive window of a connection */
+#define NFC_LLCP_RW_MAX 15
+  /** Service Discovery Protocol SAP: connections by service name are requested to this SAP */
+#define NFC_LLCP_SAP_SDP 1
+  /** Well-known SAP of SNEP (Simple NDEF Exchange Protocol), service name "urn:nfc:sn:snep" */
+#define NFC_LLCP_SAP_SNEP 4
+
+  /**
+   * @struct nfc_llcp_params
+   * @brief LLCP link and connection parameters
+   */
+  typedef struct {
+    /** Maximum Information Unit of the link and of its connections, from 128 bytes up to \a NFC_LLCP_MIU_MAX */
+    size_t szMiu;
+    /** Receive window of connections, from 1 up to \a NFC_LLCP_RW_MAX */
+    uint8_t ui8Rw;
+    /** Link timeout in milliseconds, from 10 up to 2550 */
+    int iLto;
+    /** Well-known services (one bit per SAP); listening well-known SAPs are added to local ones */
+    uint16_t ui16Wks;
+  } nfc_llcp_params;
+
+  /**
+   * @struct nfc_llcp_link
+   * @brief LLCP link over a NFC device
+   */
+  typedef struct nfc_llcp_link nfc_llcp_link;
+
+  NFC_EXPORT nfc_llcp_link *nfc_llcp_link_new(nfc_device *pnd, const nfc_llcp_params *pnlpLocal);
+  NFC_EXPORT void nfc_llcp_link_free(nfc_llcp_link *link);
+  NFC_EXPORT int nfc_llcp_link_activate_initiator(nfc_llcp_link *link, const nfc_dep_mode ndm, const nfc_baud_rate nbr, const int timeout);
+  NFC_EXPORT int nfc_llcp_link_activate_target(nfc_llcp_link *link, const int timeout);
+  NFC_EXPORT int nfc_llcp_link_deactivate(nfc_llcp_link *link);
+  NFC_EXPORT int nfc_llcp_link_get_remote_params(const nfc_llcp_link *link, nfc_llcp_params *pnlpRemote);
+  NFC_EXPORT int nfc_llcp_link_service(nfc_llcp_link *link, const int timeout);
+
+  NFC_EXPORT int nfc_llcp_listen(nfc_llcp_link *link, const uint8_t sap, const char *service_name);
+  NFC_EXPORT int nfc_llcp_accept(nfc_llcp_link *link, const uint8_t sap, const int timeout);
+  NFC_EXPORT int nfc_llcp_connect(nfc_llcp_link *link, const uint8_t sap, const char *service_name, const int timeout);
+  NFC_EXPORT int nfc_llcp_send(nfc_llcp_link *link, const int connection, const uint8_t *pbtTx, const size_t szTx, const int timeout);
+  NFC_EXPORT int nfc_llcp_receive(nfc_llcp_link *link, const int connection, uint8_t *pbtRx, const size_t szRx, const int timeout);
+  NFC_EXPORT int nfc_llcp_close(nfc_llcp_link *link, const int connection, const int timeout);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+
+#endif /* __NFC_LLCP_H__ */
@@ -0,0 +1,100 @@
+/*-
+ * Public platform independent Near Field Communication (NFC) library
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/**
+ * @file nfc-mfclassic.h
+ * @brief Provide a small API to read MIFARE Classic tags sector by sector
+ */
+
+#ifndef __NFC_MFCLASSIC_H__
+#define __NFC_MFCLASSIC_H__
+
+#include <sys/types.h>
+#include <nfc/nfc.h>
+
+#ifdef __cplusplus
+extern  "C" {
+#endif /* __cplusplus */
+
+  /** Size of a MIFARE Classic block */
+#define NFC_MFCLASSIC_BLOCK_LEN 16
+  /** Size of a MIFARE Classic key */
+#define NFC_MFCLASSIC_KEY_LEN 6
+  /** Number of sectors of the biggest MIFARE Classic (4K: 32 sectors of 4 blocks then 8 sectors of 16 blocks) */
+#define NFC_MFCLASSIC_MAX_SECTORS 40
+  /** Number of cards a key cache remembers */
+#define NFC_MFCLASSIC_KEY_CACHE_CARDS 16
+
+  /**
+   * @enum nfc_mfclassic_key_type
+   * @brief Key type, valued as the AUTH command using it
+   */
+  typedef enum {
+    NFC_MFCLASSIC_KEY_NONE = 0x00,
+    NFC_MFCLASSIC_KEY_A = 0x60,
+    NFC_MFCLASSIC_KEY_B = 0x61,
+  } nfc_mfclassic_key_type;
+
+  /**
+   * @struct nfc_mfclassic_key
+   * @brief MIFARE Classic key, unset when its type is \a NFC_MFCLASSIC_KEY_NONE
+   */
+  typedef struct {
+    nfc_mfclassic_key_type mkt;
+    uint8_t abtKey[NFC_MFCLASSIC_KEY_LEN];
+  } nfc_mfclassic_key;
+
+  /**
+   * @struct nfc_mfclassic_keymap
+   * @brief Keys to try on each sector
+   */
+  typedef struct {
+    /** Known keys of each sector (ie. from a keys dump), key A first */
+    nfc_mfclassic_key amkSector[NFC_MFCLASSIC_MAX_SECTORS][2];
+    /** Keys tried on every sector not opened by its own keys (ie. default keys), may be NULL */
+    const nfc_mfclassic_key *pmkDictionary;
+    /** Number of keys of \a pmkDictionary */
+    size_t szDictionary;
+  } nfc_mfclassic_keymap;
+
+  /**
+   * @struct nfc_mfclassic_key_cache
+   * @brief Keys which opened sectors of the last cards read, kept by the caller between sessions
+   */
+  typedef struct {
+    struct {
+      /** Card UID, unused entry when \a ui8UidLen is 0 */
+      uint8_t abtUid[10];
+      uint8_t ui8UidLen;
+      /** Key which opened each sector */
+      nfc_mfclassic_key amkSector[NFC_MFCLASSIC_MAX_SECTORS];
+    } acard[NFC_MFCLASSIC_KEY_CACHE_CARDS];
+    /** Entry replaced by the next new card */
+    uint8_t ui8Next;
+  } nfc_mfclassic_key_cache;
+
+  NFC_EXPORT size_t nfc_mfclassic_sector_first_block(const uint8_t ui8Sector);
+  NFC_EXPORT size_t nfc_mfclassic_sector_blocks(const uint8_t ui8Sector);
+  NFC_EXPORT int nfc_mfclassic_read_sectors(nfc_device *pnd, nfc_target *pnt, const nfc_mfclassic_keymap *pmkm, nfc_mfclassic_key_cache *pmkc,
+                                            const uint8_t ui8FirstSector, const size_t szSectors, uint8_t *pbtData, nfc_mfclassic_key *pmkOpened);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+
+#endif /* __NFC_MFCLASSIC_H__ */
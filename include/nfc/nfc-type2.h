@@ -0,0 +1,59 @@
+/*-
+ * Public platform independent Near Field Communication (NFC) library
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/**
+ * @file nfc-type2.h
+ * @brief Provide a small API to read NFC Forum Type 2 tags (MIFARE Ultralight, NTAG)
+ */
+
+#ifndef __NFC_TYPE2_H__
+#define __NFC_TYPE2_H__
+
+#include <sys/types.h>
+#include <nfc/nfc.h>
+
+#ifdef __cplusplus
+extern  "C" {
+#endif /* __cplusplus */
+
+  /** Size of a Type 2 tag page */
+#define NFC_TYPE2_PAGE_LEN 4
+  /** Largest number of pages of a Type 2 tag (pages are addressed by a single byte) */
+#define NFC_TYPE2_MAX_PAGES 256
+
+  /**
+   * @struct nfc_type2_info
+   * @brief Type 2 tag identification
+   */
+  typedef struct {
+    /** GET_VERSION response: fixed header, vendor ID, product type, product subtype, major and minor product versions, storage size and protocol type; zeroed when the tag does not support it */
+    uint8_t abtVersion[8];
+    /** Tag supports FAST_READ (tags answering GET_VERSION: MIFARE Ultralight EV1, NTAG) */
+    bool bFastRead;
+    /** Number of pages of the whole memory */
+    size_t szPages;
+  } nfc_type2_info;
+
+  NFC_EXPORT int nfc_type2_identify(nfc_device *pnd, nfc_target *pnt, nfc_type2_info *pnti);
+  NFC_EXPORT int nfc_type2_read(nfc_device *pnd, const nfc_type2_info *pnti, const uint8_t ui8FirstPage, uint8_t *pbtData, const size_t szPages);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+
+#endif /* __NFC_TYPE2_H__ */
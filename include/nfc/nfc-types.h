@@ -125,6 +125,8 @@ typedef enum {
   NP_FORCE_ISO14443_B,
   /** Force the chip to run at 106 kbps */
   NP_FORCE_SPEED_106,
+  /** Raise the bit rate of a D.E.P. link right after ATR (PSL) to the highest one supported by both the initiator and the target */
+  NP_AUTO_PSL,
 } nfc_property;
 
 // Compiler directive, set struct alignment to 1 uint8_t for compatibility
@@ -162,6 +164,8 @@ typedef struct {
   size_t  szGB;
   /** DEP mode */
   nfc_dep_mode ndm;
+  /** Maximum frame payload length, from LR of PP Parameters (64, 128, 192 or 254 bytes), informational only: D.E.P. frames are built by the device, not checked against it by libnfc */
+  size_t  szLR;
 } nfc_dep_info;
 
 /**
@@ -316,6 +320,113 @@ typedef struct {
   nfc_modulation nm;
 } nfc_target;
 
+/**
+ * @enum nfc_discovery_flag
+ * @brief Flags tuning a single targets discovery, can be OR'ed
+ */
+typedef enum {
+  /** Stop right after anticollision: neither RATS nor ATR_REQ is sent whatever \a NP_AUTO_ISO14443_4 is, only ATQA, SAK and UID are retrieved */
+  NDF_UID_ONLY = 0x01,
+} nfc_discovery_flag;
+
+/**
+ * @enum nfc_poll_event_type
+ * @brief Kind of event reported by nfc_initiator_poll_stream()
+ */
+typedef enum {
+  /** A target entered the field */
+  NPE_ARRIVAL,
+  /** The target left the field */
+  NPE_REMOVAL,
+} nfc_poll_event_type;
+
+/**
+ * @struct nfc_poll_event
+ * @brief Event reported by nfc_initiator_poll_stream()
+ */
+typedef struct {
+  nfc_poll_event_type npet;
+  nfc_target nt;
+  /** Monotonic time in microseconds at which the device reported the arrival (resp. the removal) */
+  int64_t i64Time;
+  /** Upper bound of the delay in microseconds between the arrival (resp. the removal) and the event delivery */
+  uint32_t ui32Latency;
+} nfc_poll_event;
+
+/**
+ * @brief Callback used by nfc_initiator_poll_stream(), return \e false to stop polling
+ */
+typedef bool (*nfc_poll_callback)(nfc_device *pnd, const nfc_poll_event *pnpe, void *user_data);
+
+/**
+ * @enum nfc_frame_direction
+ * @brief Direction of a frame stored by the frame recorder
+ */
+typedef enum {
+  /** Frame sent to the chip */
+  NFD_TX,
+  /** Frame received from the chip */
+  NFD_RX,
+} nfc_frame_direction;
+
+/** Number of frame bytes kept in a nfc_frame_record, longer frames are truncated */
+#  define NFC_FRAME_RECORD_DATA_LEN 64
+
+/**
+ * @struct nfc_frame_record
+ * @brief Frame exchanged with the chip, see nfc_device_get_frame_records()
+ */
+typedef struct {
+  /** Monotonic timestamp in microseconds */
+  int64_t i64Timestamp;
+  nfc_frame_direction nfd;
+  /** Chip command the frame belongs to */
+  uint8_t ui8Command;
+  /** Send (resp. receive) result: received length or libnfc's error code */
+  int iResult;
+  /** Frame length, only the first NFC_FRAME_RECORD_DATA_LEN bytes are kept in abtData */
+  size_t szData;
+  uint8_t abtData[NFC_FRAME_RECORD_DATA_LEN];
+} nfc_frame_record;
+
+/** Number of round-trip latency buckets: bucket 0 counts exchanges under 128 us, bucket n
+ * (0 < n < NFC_STATS_LATENCY_BUCKETS - 1) counts [2^(n+6), 2^(n+7)) us, the last one longer exchanges */
+#  define NFC_STATS_LATENCY_BUCKETS 16
+/** Number of command codes tracked by nfc_device_stats */
+#  define NFC_STATS_COMMANDS 256
+
+/**
+ * @struct nfc_command_stats
+ * @brief Counters of a chip command, see nfc_device_get_stats()
+ */
+typedef struct {
+  uint32_t ui32Calls;
+  /** Bytes sent to (resp. received from) the chip */
+  uint64_t ui64BytesOut;
+  uint64_t ui64BytesIn;
+  /** Exchanges which failed with NFC_ETIMEOUT, NFC_ERFTRANS, NFC_ECHIP and any other error */
+  uint32_t ui32Timeouts;
+  uint32_t ui32RfErrors;
+  uint32_t ui32ChipErrors;
+  uint32_t ui32OtherErrors;
+  /** Round-trip latency histogram, log2 buckets (see NFC_STATS_LATENCY_BUCKETS) */
+  uint32_t aui32Latency[NFC_STATS_LATENCY_BUCKETS];
+} nfc_command_stats;
+
+/**
+ * @struct nfc_device_stats
+ * @brief Per command counters of a device, indexed by chip command code
+ */
+typedef struct {
+  nfc_command_stats ancs[NFC_STATS_COMMANDS];
+  /** Automatic recoveries of a wedged device (resync, wake up and configuration replay), and failed ones */
+  uint32_t ui32Recoveries;
+  uint32_t ui32FailedRecoveries;
+  /** Total and longest time spent recovering, in microseconds */
+  uint64_t ui64RecoveryTime;
+  uint32_t ui32MaxRecoveryTime;
+} nfc_device_stats;
+
 // Reset struct alignment to default
 #  pragma pack()
 
@@ -65,6 +65,7 @@ extern  "C" {
   /* Library initialization/deinitialization */
   NFC_EXPORT void nfc_init(nfc_context *context);
   NFC_EXPORT void nfc_exit(nfc_context *context);
+  NFC_EXPORT int nfc_log_set_priority(const char *category, const char *priority);
 
   /* NFC Device/Hardware manipulation */
   NFC_EXPORT bool nfc_get_default_device(nfc_connstring *connstring);
@@ -78,12 +79,18 @@ extern  "C" {
   NFC_EXPORT int nfc_initiator_init(nfc_device *pnd);
   NFC_EXPORT int nfc_initiator_init_secure_element(nfc_device *pnd);
   NFC_EXPORT int nfc_initiator_select_passive_target(nfc_device *pnd, const nfc_modulation nm, const uint8_t *pbtInitData, const size_t szInitData, nfc_target *pnt);
+  NFC_EXPORT int nfc_initiator_select_passive_target_ext(nfc_device *pnd, const nfc_modulation nm, const uint8_t *pbtInitData, const size_t szInitData, nfc_target *pnt, const int flags);
+  NFC_EXPORT int nfc_initiator_activate_iso14443_4(nfc_device *pnd, nfc_target *pnt);
   NFC_EXPORT int nfc_initiator_list_passive_targets(nfc_device *pnd, const nfc_modulation nm, nfc_target ant[], const size_t szTargets);
   NFC_EXPORT int nfc_initiator_poll_target(nfc_device *pnd, const nfc_modulation *pnmTargetTypes, const size_t szTargetTypes, const uint8_t uiPollNr, const uint8_t uiPeriod, nfc_target *pnt);
+  NFC_EXPORT int nfc_initiator_poll_target_ext(nfc_device *pnd, const nfc_modulation *pnmTargetTypes, const size_t szTargetTypes, const uint8_t uiPollNr, const uint8_t uiPeriod, nfc_target *pnt, const int flags);
+  NFC_EXPORT int nfc_initiator_poll_stream(nfc_device *pnd, const nfc_modulation *pnmModulations, const size_t szModulations, const int holdoff, nfc_poll_callback callback, void *user_data);
   NFC_EXPORT int nfc_initiator_select_dep_target(nfc_device *pnd, const nfc_dep_mode ndm, const nfc_baud_rate nbr, const nfc_dep_info *pndiInitiator, nfc_target *pnt, const int timeout);
   NFC_EXPORT int nfc_initiator_poll_dep_target(nfc_device *pnd, const nfc_dep_mode ndm, const nfc_baud_rate nbr, const nfc_dep_info *pndiInitiator, nfc_target *pnt, const int timeout);
+  NFC_EXPORT int nfc_initiator_poll_dep_and_passive_target(nfc_device *pnd, const nfc_modulation *pnmModulations, const size_t szModulations, const nfc_dep_info *pndiInitiator, nfc_target *pnt, const int timeout);
   NFC_EXPORT int nfc_initiator_deselect_target(nfc_device *pnd);
   NFC_EXPORT int nfc_initiator_transceive_bytes(nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx, uint8_t *pbtRx, const size_t szRx, int timeout);
+  NFC_EXPORT int nfc_initiator_transceive_apdu(nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx, uint8_t *pbtRx, const size_t szRx);
   NFC_EXPORT int nfc_initiator_transceive_bits(nfc_device *pnd, const uint8_t *pbtTx, const size_t szTxBits, const uint8_t *pbtTxPar, uint8_t *pbtRx, uint8_t *pbtRxPar);
   NFC_EXPORT int nfc_initiator_transceive_bytes_timed(nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx, uint8_t *pbtRx, uint32_t *cycles);
   NFC_EXPORT int nfc_initiator_transceive_bits_timed(nfc_device *pnd, const uint8_t *pbtTx, const size_t szTxBits, const uint8_t *pbtTxPar, uint8_t *pbtRx, uint8_t *pbtRxPar, uint32_t *cycles);
@@ -116,9 +123,16 @@ extern  "C" {
   NFC_EXPORT void iso14443a_crc(uint8_t *pbtData, size_t szLen, uint8_t *pbtCrc);
   NFC_EXPORT void iso14443a_crc_append(uint8_t *pbtData, size_t szLen);
   NFC_EXPORT uint8_t *iso14443a_locate_historical_bytes(uint8_t *pbtAts, size_t szAts, size_t *pszTk);
+  NFC_EXPORT void iso14443b_crc(uint8_t *pbtData, size_t szLen, uint8_t *pbtCrc);
+  NFC_EXPORT void iso14443b_crc_append(uint8_t *pbtData, size_t szLen);
 
   NFC_EXPORT const char *nfc_version(void);
   NFC_EXPORT int nfc_device_get_information_about(nfc_device *pnd, char **buf);
+  NFC_EXPORT int nfc_device_get_frame_records(nfc_device *pnd, nfc_frame_record records[], const size_t szRecords);
+  NFC_EXPORT int nfc_device_get_stats(nfc_device *pnd, nfc_device_stats *pnds);
+  NFC_EXPORT int nfc_device_reset_stats(nfc_device *pnd);
+  NFC_EXPORT int nfc_device_set_capture(nfc_device *pnd, const char *filename);
+  NFC_EXPORT int nfc_device_set_trace(nfc_device *pnd, const char *filename);
 
   /* String converter functions */
   NFC_EXPORT const char *str_nfc_modulation_type(const nfc_modulation_type nmt);
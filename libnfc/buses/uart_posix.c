@@ -239,13 +239,8 @@ uart_close(const serial_port sp)
   uart_close_ext(sp, true);
 }
 
-/**
- * @brief Receive data from UART and copy data to \a pbtRx
- *
- * @return 0 on success, otherwise driver error code
- */
-int
-uart_receive(serial_port sp, uint8_t *pbtRx, const size_t szRx, void *abort_p, int timeout)
+static int
+uart_receive_bytes(serial_port sp, uint8_t *pbtRx, const size_t szRx, void *abort_p, int timeout)
 {
   int iAbortFd = abort_p ? *((int *)abort_p) : 0;
   int received_bytes_count = 0;
@@ -313,6 +308,19 @@ select:
   return NFC_SUCCESS;
 }
 
+/**
+ * @brief Receive data from UART and copy data to \a pbtRx
+ *
+ * @return 0 on success, otherwise driver error code
+ */
+int
+uart_receive(serial_port sp, uint8_t *pbtRx, const size_t szRx, void *abort_p, int timeout)
+{
+  int res = uart_receive_bytes(sp, pbtRx, szRx, abort_p, timeout);
+  NFC_PROBE3(uart_receive__return, szRx, timeout, res);
+  return res;
+}
+
 /**
  * @brief Send \a pbtTx content to UART
  *
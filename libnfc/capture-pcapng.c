@@ -0,0 +1,303 @@
+/*-
+ * Public platform independent Near Field Communication (NFC) library
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/**
+ * @file capture-pcapng.c
+ * @brief Traffic capture in pcapng format
+ * @see http://www.winpcap.org/ntar/draft/PCAP-DumpFileFormat.html
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#ifdef HAVE_PTHREAD_H
+#  include <pthread.h>
+#endif
+
+#include <nfc/nfc.h>
+
+#include "nfc-internal.h"
+#include "capture.h"
+
+#define LOG_CATEGORY "libnfc.capture"
+
+// Frames are queued in one buffer while the other one is written
+#define CAPTURE_BUFFER_SIZE 65536
+
+// Largest frame captured: PN53x extended frame and its LINKTYPE_ISO_14443 pseudo-header
+#define CAPTURE_FRAME_MAX_LEN 300
+
+struct capture {
+  FILE *fp;
+  uint8_t *pbtActive;
+  size_t szActive;
+  uint8_t *pbtSpare;
+  uint32_t ui32Dropped;
+#ifdef HAVE_PTHREAD_H
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  bool bStop;
+#endif
+};
+
+static size_t
+pcapng_put_u16(uint8_t *pbt, const uint16_t ui16)
+{
+  memcpy(pbt, &ui16, sizeof(ui16));
+  return sizeof(ui16);
+}
+
+static size_t
+pcapng_put_u32(uint8_t *pbt, const uint32_t ui32)
+{
+  memcpy(pbt, &ui32, sizeof(ui32));
+  return sizeof(ui32);
+}
+
+static size_t
+pcapng_put_option(uint8_t *pbt, const uint16_t ui16Code, const void *pData, const uint16_t ui16Len)
+{
+  size_t sz = pcapng_put_u16(pbt, ui16Code);
+  sz += pcapng_put_u16(pbt + sz, ui16Len);
+  memcpy(pbt + sz, pData, ui16Len);
+  memset(pbt + sz + ui16Len, 0x00, PCAPNG_PAD(ui16Len) - ui16Len);
+  return sz + PCAPNG_PAD(ui16Len);
+}
+
+// Close a block started at pbtBlock: append options end, trailing length and fix the leading one
+static size_t
+pcapng_end_block(uint8_t *pbtBlock, size_t szBlock)
+{
+  szBlock += pcapng_put_u16(pbtBlock + szBlock, PCAPNG_OPT_ENDOFOPT);
+  szBlock += pcapng_put_u16(pbtBlock + szBlock, 0);
+  szBlock += pcapng_put_u32(pbtBlock + szBlock, szBlock + 4);
+  pcapng_put_u32(pbtBlock + 4, szBlock);
+  return szBlock;
+}
+
+static size_t
+pcapng_idb(uint8_t *pbt, const uint16_t ui16LinkType, const char *pcName)
+{
+  const uint8_t ui8TsResol = 9; // Nanoseconds
+  size_t sz = pcapng_put_u32(pbt, PCAPNG_IDB);
+  sz += 4; // Block length
+  sz += pcapng_put_u16(pbt + sz, ui16LinkType);
+  sz += pcapng_put_u16(pbt + sz, 0);
+  sz += pcapng_put_u32(pbt + sz, 0); // No snapshot length limit
+  sz += pcapng_put_option(pbt + sz, PCAPNG_OPT_IF_NAME, pcName, strlen(pcName));
+  sz += pcapng_put_option(pbt + sz, PCAPNG_OPT_IF_TSRESOL, &ui8TsResol, sizeof(ui8TsResol));
+  return pcapng_end_block(pbt, sz);
+}
+
+static uint64_t
+realtime_ns(void)
+{
+#if defined(CLOCK_REALTIME) && !defined(WIN32)
+  struct timespec ts;
+  if (clock_gettime(CLOCK_REALTIME, &ts) == 0) {
+    return ((uint64_t) ts.tv_sec * 1000000000) + ts.tv_nsec;
+  }
+#endif
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return ((uint64_t) tv.tv_sec * 1000000000) + ((uint64_t) tv.tv_usec * 1000);
+}
+
+static void
+capture_write(struct capture *pc, const uint8_t *pbt, const size_t sz)
+{
+  if (fwrite(pbt, 1, sz, pc->fp) != sz) {
+    log_put(LOG_CATEGORY, NFC_PRIORITY_ERROR, "%s", "Unable to write capture file");
+  }
+  fflush(pc->fp);
+}
+
+#ifdef HAVE_PTHREAD_H
+static void *
+capture_writer(void *arg)
+{
+  struct capture *pc = arg;
+
+  pthread_mutex_lock(&pc->mutex);
+  while (true) {
+    while (!pc->bStop && (pc->szActive == 0))
+      pthread_cond_wait(&pc->cond, &pc->mutex);
+    if (pc->szActive == 0)
+      break;
+    // Swap buffers, so frames can be queued while this one is written
+    uint8_t *pbt = pc->pbtActive;
+    const size_t sz = pc->szActive;
+    pc->pbtActive = pc->pbtSpare;
+    pc->szActive = 0;
+    pc->pbtSpare = pbt;
+    pthread_mutex_unlock(&pc->mutex);
+    capture_write(pc, pbt, sz);
+    pthread_mutex_lock(&pc->mutex);
+  }
+  pthread_mutex_unlock(&pc->mutex);
+  return NULL;
+}
+#endif
+
+struct capture *
+capture_open(const char *filename)
+{
+  struct capture *pc = malloc(sizeof(*pc));
+  if (!pc)
+    return NULL;
+  pc->pbtActive = malloc(CAPTURE_BUFFER_SIZE);
+  pc->pbtSpare = malloc(CAPTURE_BUFFER_SIZE);
+  pc->szActive = 0;
+  pc->ui32Dropped = 0;
+  if (!pc->pbtActive || !pc->pbtSpare || !(pc->fp = fopen(filename, "wb"))) {
+    log_put(LOG_CATEGORY, NFC_PRIORITY_ERROR, "Unable to open capture file \"%s\"", filename);
+    free(pc->pbtActive);
+    free(pc->pbtSpare);
+    free(pc);
+    return NULL;
+  }
+
+  // Section Header Block then one Interface Description Block per capture interface
+  uint8_t abtHeader[256];
+  size_t szHeader = pcapng_put_u32(abtHeader, PCAPNG_SHB);
+  szHeader += 4; // Block length
+  szHeader += pcapng_put_u32(abtHeader + szHeader, PCAPNG_BYTE_ORDER_MAGIC);
+  szHeader += pcapng_put_u16(abtHeader + szHeader, 1);
+  szHeader += pcapng_put_u16(abtHeader + szHeader, 0);
+  szHeader += pcapng_put_u32(abtHeader + szHeader, 0xFFFFFFFF); // Section length is unknown
+  szHeader += pcapng_put_u32(abtHeader + szHeader, 0xFFFFFFFF);
+  szHeader = pcapng_end_block(abtHeader, szHeader);
+  szHeader += pcapng_idb(abtHeader + szHeader, LINKTYPE_ISO_14443, "iso14443");
+  szHeader += pcapng_idb(abtHeader + szHeader, LINKTYPE_USER0, "pn53x");
+  capture_write(pc, abtHeader, szHeader);
+
+#ifdef HAVE_PTHREAD_H
+  pc->bStop = false;
+  pthread_mutex_init(&pc->mutex, NULL);
+  pthread_cond_init(&pc->cond, NULL);
+  if (pthread_create(&pc->thread, NULL, capture_writer, pc) != 0) {
+    log_put(LOG_CATEGORY, NFC_PRIORITY_ERROR, "%s", "Unable to start capture writer");
+    pthread_cond_destroy(&pc->cond);
+    pthread_mutex_destroy(&pc->mutex);
+    fclose(pc->fp);
+    free(pc->pbtActive);
+    free(pc->pbtSpare);
+    free(pc);
+    return NULL;
+  }
+#endif
+  return pc;
+}
+
+void
+capture_close(struct capture *pc)
+{
+  if (!pc)
+    return;
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_lock(&pc->mutex);
+  pc->bStop = true;
+  pthread_cond_signal(&pc->cond);
+  pthread_mutex_unlock(&pc->mutex);
+  pthread_join(pc->thread, NULL);
+  pthread_cond_destroy(&pc->cond);
+  pthread_mutex_destroy(&pc->mutex);
+#else
+  capture_write(pc, pc->pbtActive, pc->szActive);
+#endif
+  if (pc->ui32Dropped)
+    log_put(LOG_CATEGORY, NFC_PRIORITY_WARN, "%lu frame(s) dropped from capture", (unsigned long) pc->ui32Dropped);
+  fclose(pc->fp);
+  free(pc->pbtActive);
+  free(pc->pbtSpare);
+  free(pc);
+}
+
+// Queue an Enhanced Packet Block made of an optional pseudo-header and frame data
+static void
+capture_epb(struct capture *pc, const uint32_t ui32Interface, const uint32_t ui32Flags, const char *pcComment,
+            const uint8_t *pbtHeader, const size_t szHeader, const uint8_t *pbtData, size_t szData)
+{
+  const uint64_t ui64Timestamp = realtime_ns();
+  if (szHeader + szData > CAPTURE_FRAME_MAX_LEN)
+    szData = CAPTURE_FRAME_MAX_LEN - szHeader;
+  const size_t szPacket = szHeader + szData;
+
+  uint8_t abtBlock[28 + PCAPNG_PAD(CAPTURE_FRAME_MAX_LEN) + 12 + 4 + 32 + 8];
+  size_t sz = pcapng_put_u32(abtBlock, PCAPNG_EPB);
+  sz += 4; // Block length
+  sz += pcapng_put_u32(abtBlock + sz, ui32Interface);
+  sz += pcapng_put_u32(abtBlock + sz, (uint32_t)(ui64Timestamp >> 32));
+  sz += pcapng_put_u32(abtBlock + sz, (uint32_t) ui64Timestamp);
+  sz += pcapng_put_u32(abtBlock + sz, szPacket);
+  sz += pcapng_put_u32(abtBlock + sz, szPacket);
+  if (szHeader)
+    memcpy(abtBlock + sz, pbtHeader, szHeader);
+  if (szData)
+    memcpy(abtBlock + sz + szHeader, pbtData, szData);
+  memset(abtBlock + sz + szPacket, 0x00, PCAPNG_PAD(szPacket) - szPacket);
+  sz += PCAPNG_PAD(szPacket);
+  if (ui32Flags)
+    sz += pcapng_put_option(abtBlock + sz, PCAPNG_OPT_EPB_FLAGS, &ui32Flags, sizeof(ui32Flags));
+  if (*pcComment)
+    sz += pcapng_put_option(abtBlock + sz, PCAPNG_OPT_COMMENT, pcComment, strlen(pcComment));
+  sz = pcapng_end_block(abtBlock, sz);
+
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_lock(&pc->mutex);
+  if (pc->szActive + sz <= CAPTURE_BUFFER_SIZE) {
+    memcpy(pc->pbtActive + pc->szActive, abtBlock, sz);
+    pc->szActive += sz;
+    pthread_cond_signal(&pc->cond);
+  } else {
+    pc->ui32Dropped++;
+  }
+  pthread_mutex_unlock(&pc->mutex);
+#else
+  // No background writer: write synchronously once the buffer is full
+  if (pc->szActive + sz > CAPTURE_BUFFER_SIZE) {
+    capture_write(pc, pc->pbtActive, pc->szActive);
+    pc->szActive = 0;
+  }
+  memcpy(pc->pbtActive + pc->szActive, abtBlock, sz);
+  pc->szActive += sz;
+#endif
+}
+
+void
+capture_iso14443(struct capture *pc, const uint8_t ui8Event, const uint8_t *pbtData, const size_t szData)
+{
+  // LINKTYPE_ISO_14443 pseudo-header: version, event and big endian data length
+  const uint8_t abtHeader[] = { 0x00, ui8Event, (szData >> 8) & 0xff, szData & 0xff };
+  capture_epb(pc, CAPTURE_IF_ISO14443, 0, "", abtHeader, sizeof(abtHeader), pbtData, szData);
+}
+
+void
+capture_pn53x(struct capture *pc, const bool bToChip, const int iResult, const uint8_t *pbtData, const size_t szData)
+{
+  char acComment[32] = "";
+  if (iResult < 0)
+    snprintf(acComment, sizeof(acComment), PCAPNG_COMMENT_ERROR "%d", iResult);
+  capture_epb(pc, CAPTURE_IF_PN53X, bToChip ? PCAPNG_EPB_FLAGS_OUTBOUND : PCAPNG_EPB_FLAGS_INBOUND, acComment, NULL, 0, pbtData, szData);
+}
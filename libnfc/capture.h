@@ -0,0 +1,75 @@
+/*-
+ * Public platform independent Near Field Communication (NFC) library
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/**
+ * @file capture.h
+ * @brief Traffic capture in pcapng format
+ */
+
+#ifndef __NFC_CAPTURE_H__
+#define __NFC_CAPTURE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// pcapng blocks and options used by captures
+#define PCAPNG_SHB 0x0A0D0D0A
+#define PCAPNG_IDB 0x00000001
+#define PCAPNG_EPB 0x00000006
+#define PCAPNG_BYTE_ORDER_MAGIC 0x1A2B3C4D
+
+// Block bodies and option values are padded to 32 bits
+#define PCAPNG_PAD(X) (((X) + 3) & ~((size_t) 3))
+
+#define PCAPNG_OPT_ENDOFOPT 0
+#define PCAPNG_OPT_COMMENT 1
+#define PCAPNG_OPT_IF_NAME 2
+#define PCAPNG_OPT_IF_TSRESOL 9
+#define PCAPNG_OPT_EPB_FLAGS 2
+#define PCAPNG_EPB_FLAGS_INBOUND 0x01
+#define PCAPNG_EPB_FLAGS_OUTBOUND 0x02
+
+#define LINKTYPE_USER0 147
+#define LINKTYPE_ISO_14443 264
+
+// Comment of a PN53x frame whose transfer failed, followed by libnfc's error code
+#define PCAPNG_COMMENT_ERROR "error "
+
+// Capture interfaces, each one is described by its own pcapng Interface Description Block
+#define CAPTURE_IF_ISO14443 0 // LINKTYPE_ISO_14443: frames exchanged with the target
+#define CAPTURE_IF_PN53X    1 // LINKTYPE_USER0: frames exchanged with the PN53x chip
+
+// LINKTYPE_ISO_14443 pseudo-header events
+#define CAPTURE_EVT_PICC_TO_PCD              0xFF
+#define CAPTURE_EVT_PCD_TO_PICC              0xFE
+#define CAPTURE_EVT_FIELD_OFF                0xFD
+#define CAPTURE_EVT_FIELD_ON                 0xFC
+#define CAPTURE_EVT_PICC_TO_PCD_CRC_DROPPED  0xFB
+#define CAPTURE_EVT_PCD_TO_PICC_CRC_DROPPED  0xFA
+
+struct capture;
+
+// Frames are queued in memory and written to the file by a background thread (when available)
+struct capture *capture_open(const char *filename);
+void  capture_close(struct capture *pc);
+
+// Queue a frame, dropped (and counted) when the writer lags behind, never blocks on I/O
+void  capture_iso14443(struct capture *pc, const uint8_t ui8Event, const uint8_t *pbtData, const size_t szData);
+void  capture_pn53x(struct capture *pc, const bool bToChip, const int iResult, const uint8_t *pbtData, const size_t szData);
+
+#endif // __NFC_CAPTURE_H__
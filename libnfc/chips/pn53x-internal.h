@@ -115,9 +115,7 @@
 typedef struct {
   uint8_t ui8Code;
   uint8_t ui8CompatFlags;
-#ifdef LOGGING
   const char *abtCommandText;
-#endif
 } pn53x_command;
 
 typedef enum {
@@ -128,17 +126,16 @@ typedef enum {
   RCS360  = 0x08
 } pn53x_type;
 
+// Commands table is indexed by command code, names are also used to decode recorded frames
+#  define PNCMD( X, Y ) [X] = { X , Y, #X }
 #ifndef LOGGING
-#  define PNCMD( X, Y ) { X , Y }
 #  define PNCMD_TRACE( X ) do {} while(0)
 #else
-#  define PNCMD( X, Y ) { X , Y, #X }
 #  define PNCMD_TRACE( X ) do { \
-    for (size_t i=0; i<(sizeof(pn53x_commands)/sizeof(pn53x_command)); i++) { \
-      if ( X == pn53x_commands[i].ui8Code ) { \
-        log_put( LOG_CATEGORY, NFC_PRIORITY_TRACE, "%s", pn53x_commands[i].abtCommandText ); \
-        break; \
-      } \
+    if (log_enabled(LOG_CATEGORY, NFC_PRIORITY_TRACE) && \
+        ((X) < (sizeof(pn53x_commands)/sizeof(pn53x_command))) && \
+        pn53x_commands[X].abtCommandText) { \
+      log_emit( LOG_CATEGORY, NFC_PRIORITY_TRACE, "%s", pn53x_commands[X].abtCommandText ); \
     } \
   } while(0)
 #endif
@@ -201,16 +198,15 @@ static const pn53x_command pn53x_commands[] = {
 #define P35 5
 
 // Registers part
-#ifdef LOGGING
 typedef struct {
   uint16_t ui16Address;
   const char *abtRegisterText;
   const char *abtRegisterDescription;
 } pn53x_register;
 
-#  define PNREG( X, Y ) { X , #X, Y }
-
-#endif /* LOGGING */
+// Registers table is indexed by CIU register (0x6301 to 0x633F) then SFR (0xFFx0 to 0xFFxF) lowest nibble
+#  define PNREG_INDEX( X ) ((((X) & 0xFFC0) == 0x6300) ? ((X) & 0x3F) : (0x40 + ((X) & 0x0F)))
+#  define PNREG( X, Y ) [PNREG_INDEX(X)] = { X , #X, Y }
 
 
 #ifndef LOGGING
@@ -218,11 +214,10 @@ typedef struct {
   } while(0)
 #else
 #  define PNREG_TRACE( X ) do { \
-    for (size_t i=0; i<(sizeof(pn53x_registers)/sizeof(pn53x_register)); i++) { \
-      if ( X == pn53x_registers[i].ui16Address ) { \
-        log_put( LOG_CATEGORY, NFC_PRIORITY_TRACE, "%s (%s)", pn53x_registers[i].abtRegisterText, pn53x_registers[i].abtRegisterDescription ); \
-        break; \
-      } \
+    if (log_enabled(LOG_CATEGORY, NFC_PRIORITY_TRACE) && \
+        ((((X) & 0xFFC0) == 0x6300) || (((X) & 0xFF00) == 0xFF00)) && \
+        (pn53x_registers[PNREG_INDEX(X)].ui16Address == (X))) { \
+      log_emit( LOG_CATEGORY, NFC_PRIORITY_TRACE, "%s (%s)", pn53x_registers[PNREG_INDEX(X)].abtRegisterText, pn53x_registers[PNREG_INDEX(X)].abtRegisterDescription ); \
     } \
   } while(0)
 #endif
@@ -329,7 +324,6 @@ typedef struct {
 #define EOVCURRENT	0x2d
 #define ENAD		0x2e
 
-#ifdef LOGGING
 static const pn53x_register pn53x_registers[] = {
   PNREG(PN53X_REG_CIU_Mode, "Defines general modes for transmitting and receiving"),
   PNREG(PN53X_REG_CIU_TxMode, "Defines the transmission data rate and framing during transmission"),
@@ -402,6 +396,5 @@ static const pn53x_register pn53x_registers[] = {
   PNREG(PN53X_SFR_P7CFGB, "Port 7 configuration"),
   PNREG(PN53X_SFR_P7, "Port 7 value"),
 };
-#endif
 
 #endif /* __PN53X_INTERNAL_H__ */
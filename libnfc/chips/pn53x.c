@@ -38,14 +38,17 @@
 #include "pn53x.h"
 #include "pn53x-internal.h"
 
-#include "mirror-subr.h"
-
 #define LOG_CATEGORY "libnfc.chip.pn53x"
 
+#define SAK_ISO14443_4_COMPLIANT 0x20
+#define SAK_ISO18092_COMPLIANT   0x40
+
 const uint8_t pn53x_ack_frame[] = { 0x00, 0x00, 0xff, 0x00, 0xff, 0x00 };
 const uint8_t pn53x_nack_frame[] = { 0x00, 0x00, 0xff, 0xff, 0x00, 0x00 };
 static const uint8_t pn53x_error_frame[] = { 0x00, 0x00, 0xff, 0x01, 0xff, 0x7f, 0x81, 0x00 };
-const nfc_baud_rate pn53x_iso14443a_supported_baud_rates[] = { NBR_106, 0 };
+const nfc_baud_rate pn531_iso14443a_supported_baud_rates[] = { NBR_106, 0 };
+const nfc_baud_rate pn532_iso14443a_supported_baud_rates[] = { NBR_424, NBR_212, NBR_106, 0 };
+const nfc_baud_rate pn533_iso14443a_supported_baud_rates[] = { NBR_847, NBR_424, NBR_212, NBR_106, 0 };
 const nfc_baud_rate pn53x_felica_supported_baud_rates[] = { NBR_424, NBR_212, 0 };
 const nfc_baud_rate pn53x_dep_supported_baud_rates[] = { NBR_424, NBR_212, NBR_106, 0 };
 const nfc_baud_rate pn53x_jewel_supported_baud_rates[] = { NBR_106, 0 };
@@ -142,17 +145,214 @@ pn53x_reset_settings(struct nfc_device *pnd)
   return NFC_SUCCESS;
 }
 
+// Forget what is known about a CIU register in the write-back cache area
+static void
+pn53x_known_register_forget(struct nfc_device *pnd, const uint16_t ui16RegisterAddress)
+{
+  CHIP_DATA(pnd)->kn_mask[ui16RegisterAddress - PN53X_CACHE_REGISTER_MIN_ADDRESS] = 0x00;
+}
+
+// Forget what is known about CIU registers written by a raw WriteRegister frame (e.g. FIFO, BitFraming)
+static void
+pn53x_known_registers_forget_written(struct nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx)
+{
+  for (size_t n = 1; n + 2 < szTx; n += 3) {
+    const uint16_t ui16RegisterAddress = (pbtTx[n] << 8) | pbtTx[n + 1];
+    if ((ui16RegisterAddress >= PN53X_CACHE_REGISTER_MIN_ADDRESS) && (ui16RegisterAddress <= PN53X_CACHE_REGISTER_MAX_ADDRESS))
+      pn53x_known_register_forget(pnd, ui16RegisterAddress);
+  }
+}
+
+// Drop cached RF settings and register values which may be changed by the chip itself while running ui8Command
+static void
+pn53x_settings_cache_invalidate(struct nfc_device *pnd, const uint8_t ui8Command)
+{
+  switch (ui8Command) {
+    case GetFirmwareVersion:
+    case GetGeneralStatus:
+    case ReadRegister:
+    case WriteRegister:
+    case ReadGPIO:
+    case WriteGPIO:
+    case SetParameters:
+    case RFConfiguration:
+      // These commands leave RF settings and CIU mode registers untouched
+      return;
+    case InCommunicateThru:
+      // Some chips (e.g. SCL3711) reset the timer while running it
+      pn53x_known_register_forget(pnd, PN53X_REG_CIU_TMode);
+      pn53x_known_register_forget(pnd, PN53X_REG_CIU_TPrescaler);
+      pn53x_known_register_forget(pnd, PN53X_REG_CIU_TReloadVal_hi);
+      pn53x_known_register_forget(pnd, PN53X_REG_CIU_TReloadVal_lo);
+    // fall through
+    case InDataExchange:
+    case InDeselect:
+    case TgGetData:
+    case TgSetData:
+    case TgGetInitiatorCommand:
+    case TgResponseToInitiator:
+    case TgGetTargetStatus:
+    case TgSetGeneralBytes:
+    case TgSetMetaData:
+      // These commands leave RF settings untouched, but may alter bit framing and Crypto1 state (ie. MIFARE authentication)
+      pn53x_known_register_forget(pnd, PN53X_REG_CIU_BitFraming);
+      pn53x_known_register_forget(pnd, PN53X_REG_CIU_Status2);
+      return;
+    case Diagnose:
+    case PowerDown:
+    case TgInitAsTarget:
+      // Chip may run self tests or go into PowerDown mode and lose its whole RF configuration
+      memset(CHIP_DATA(pnd)->rfci_len, 0x00, PN53X_RFCI_CACHE_SIZE);
+      break;
+    default:
+      // InListPassiveTarget, InJumpForDEP, InAutoPoll, etc. drive the field, framing and speed
+      CHIP_DATA(pnd)->rfci_len[RFCI_FIELD] = 0;
+      break;
+  }
+  CHIP_DATA(pnd)->forced_nmt = 0;
+  CHIP_DATA(pnd)->forced_speed_106 = false;
+  memset(CHIP_DATA(pnd)->kn_mask, 0x00, PN53X_CACHE_REGISTER_SIZE);
+}
+
+// Is ui8Command answered by the chip itself, without waiting for any RF event?
+static bool
+pn53x_command_is_local(const uint8_t ui8Command)
+{
+  switch (ui8Command) {
+    case GetFirmwareVersion:
+    case GetGeneralStatus:
+    case ReadRegister:
+    case WriteRegister:
+    case ReadGPIO:
+    case WriteGPIO:
+    case SetParameters:
+    case RFConfiguration:
+    case SAMConfiguration:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Does a transport failure look like a wedged chip (lost sync, garbled frames) rather than a legitimate wait?
+static bool
+pn53x_is_wedge_error(const uint8_t ui8Command, const bool bSending, const int res)
+{
+  switch (res) {
+    case NFC_EIO:
+      return true;
+    case NFC_ETIMEOUT:
+      // No ACK at all, or no reply to a command which does not wait for any target
+      return bSending || pn53x_command_is_local(ui8Command);
+    default:
+      return false;
+  }
+}
+
+// Staged recovery of a wedged chip: resync the link, check the chip answers, then replay its cached configuration
+static int
+pn53x_recover(struct nfc_device *pnd)
+{
+  const int64_t i64Start = monotonic_time_us();
+  int res = NFC_SUCCESS;
+
+  // Chip may have been reset: keep what it is supposed to be configured with
+  const uint8_t ui8Parameters = CHIP_DATA(pnd)->ui8Parameters;
+  const pn532_sam_mode sam_mode = CHIP_DATA(pnd)->sam_mode;
+  uint8_t abtKnData[PN53X_CACHE_REGISTER_SIZE];
+  uint8_t abtKnMask[PN53X_CACHE_REGISTER_SIZE];
+  uint8_t abtRfciData[PN53X_RFCI_CACHE_SIZE][PN53X_RFCI_DATA_MAX_LEN];
+  uint8_t abtRfciLen[PN53X_RFCI_CACHE_SIZE];
+  memcpy(abtKnData, CHIP_DATA(pnd)->kn_data, sizeof(abtKnData));
+  memcpy(abtKnMask, CHIP_DATA(pnd)->kn_mask, sizeof(abtKnMask));
+  memcpy(abtRfciData, CHIP_DATA(pnd)->rfci_data, sizeof(abtRfciData));
+  memcpy(abtRfciLen, CHIP_DATA(pnd)->rfci_len, sizeof(abtRfciLen));
+
+  log_put(LOG_CATEGORY, NFC_PRIORITY_INFO, "%s", "Chip seems wedged, recovering");
+  TRACE_BEGIN(pnd, "pn53x", "pn53x_recover");
+  CHIP_DATA(pnd)->recovering = true;
+
+  // Stage 1: bring the link back in sync (driver specific)
+  if (CHIP_DATA(pnd)->io->resync)
+    res = CHIP_DATA(pnd)->io->resync(pnd);
+  // Stage 2: make sure the chip answers again
+  if (res >= 0)
+    res = pn53x_check_communication(pnd);
+  // Stage 3: replay the configuration, nothing is known about the chip state anymore
+  if (res >= 0) {
+    pn53x_settings_cache_invalidate(pnd, PowerDown);
+    res = pn53x_SetParameters(pnd, ui8Parameters);
+  }
+  if ((res >= 0) && (CHIP_DATA(pnd)->type == PN532) && (CHIP_DATA(pnd)->sam_mode != sam_mode))
+    res = pn532_SAMConfiguration(pnd, sam_mode, -1);
+  for (size_t n = 0; (res >= 0) && (n < PN53X_RFCI_CACHE_SIZE); n++) {
+    if (abtRfciLen[n])
+      res = pn53x_RFConfiguration(pnd, (uint8_t) n, abtRfciData[n], abtRfciLen[n]);
+  }
+  for (size_t n = 0; (res >= 0) && (n < PN53X_CACHE_REGISTER_SIZE); n++) {
+    if (abtKnMask[n])
+      res = pn53x_write_register(pnd, PN53X_CACHE_REGISTER_MIN_ADDRESS + n, abtKnMask[n], abtKnData[n]);
+  }
+  if ((res >= 0) && CHIP_DATA(pnd)->wb_trigged)
+    res = pn53x_writeback_register(pnd);
+
+  CHIP_DATA(pnd)->recovering = false;
+  CHIP_DATA(pnd)->wedge_count = 0;
+  TRACE_END(pnd, "pn53x", "pn53x_recover", res);
+  const int64_t i64Duration = monotonic_time_us() - i64Start;
+  nfc_device_update_recovery_stats(pnd, res, i64Duration);
+  if (res < 0) {
+    log_put(LOG_CATEGORY, NFC_PRIORITY_ERROR, "Unable to recover the chip (%d)", res);
+  } else {
+    log_put(LOG_CATEGORY, NFC_PRIORITY_INFO, "Chip recovered in %ld us", (long) i64Duration);
+  }
+  return res;
+}
+
+// Supervise a transport failure: recover a wedged chip, then transparently retry commands which never reach a target
+static int
+pn53x_transceive_failed(struct nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx, uint8_t *pbtRx, const size_t szRxLen, int timeout,
+                        const bool bSending, const int res)
+{
+  if (CHIP_DATA(pnd)->recovering || !pn53x_is_wedge_error(pbtTx[0], bSending, res))
+    return res;
+  if (++CHIP_DATA(pnd)->wedge_count < PN53X_WEDGE_THRESHOLD)
+    return res;
+
+  const bool bRecovered = (pn53x_recover(pnd) >= 0);
+  // A command exchanged with a target may have reached it, sending it twice is up to the caller
+  if (bRecovered && pn53x_command_is_local(pbtTx[0]))
+    return pn53x_transceive(pnd, pbtTx, szTx, pbtRx, szRxLen, timeout);
+  pnd->last_error = res;
+  return res;
+}
+
 int
 pn53x_transceive(struct nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx, uint8_t *pbtRx, const size_t szRxLen, int timeout)
 {
   int res = 0;
+  NFC_PROBE2(pn53x_transceive__entry, pbtTx[0], szTx);
   if (CHIP_DATA(pnd)->wb_trigged) {
-    if ((res = pn53x_writeback_register(pnd)) < 0) {
+    NFC_PROBE1(pn53x_writeback_register__entry, pbtTx[0]);
+    TRACE_BEGIN(pnd, "pn53x", "pn53x_writeback_register");
+    res = pn53x_writeback_register(pnd);
+    TRACE_END(pnd, "pn53x", "pn53x_writeback_register", res);
+    NFC_PROBE2(pn53x_writeback_register__return, pbtTx[0], res);
+    if (res < 0) {
+      // Pending register writes, forced framing/speed may not have been applied
+      CHIP_DATA(pnd)->forced_nmt = 0;
+      CHIP_DATA(pnd)->forced_speed_106 = false;
+      memset(CHIP_DATA(pnd)->kn_mask, 0x00, PN53X_CACHE_REGISTER_SIZE);
+      NFC_PROBE3(pn53x_transceive__return, pbtTx[0], szTx, res);
       return res;
     }
   }
 
   PNCMD_TRACE(pbtTx[0]);
+  const char *pcSpan = "pn53x_transceive";
+  if ((pbtTx[0] < (sizeof(pn53x_commands) / sizeof(pn53x_command))) && pn53x_commands[pbtTx[0]].abtCommandText)
+    pcSpan = pn53x_commands[pbtTx[0]].abtCommandText;
+  TRACE_BEGIN(pnd, "pn53x", pcSpan);
   if (timeout > 0) {
     log_put(LOG_CATEGORY, NFC_PRIORITY_TRACE, "Timeout values: %d", timeout);
   } else if (timeout == 0) {
@@ -174,21 +374,48 @@ pn53x_transceive(struct nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx
   }
 
   // Call the send/receice callback functions of the current driver
-  if ((res = CHIP_DATA(pnd)->io->send(pnd, pbtTx, szTx, timeout)) < 0) {
-    return res;
+  const int64_t i64Start = monotonic_time_us();
+  TRACE_BEGIN(pnd, "driver", "send");
+  NFC_PROBE2(driver_send__entry, pbtTx[0], szTx);
+  res = CHIP_DATA(pnd)->io->send(pnd, pbtTx, szTx, timeout);
+  NFC_PROBE3(driver_send__return, pbtTx[0], szTx, res);
+  TRACE_END(pnd, "driver", "send", res);
+  nfc_device_record_frame(pnd, NFD_TX, pbtTx[0], res, pbtTx, szTx);
+  if (res < 0) {
+    nfc_device_update_stats(pnd, pbtTx[0], 0, 0, res, monotonic_time_us() - i64Start);
+    TRACE_END(pnd, "pn53x", pcSpan, res);
+    NFC_PROBE3(pn53x_transceive__return, pbtTx[0], szTx, res);
+    return pn53x_transceive_failed(pnd, pbtTx, szTx, pbtRx, szRxLen, timeout, true, res);
   }
 
   // Command is sent, we store the command
   CHIP_DATA(pnd)->last_command = pbtTx[0];
 
+  // Chip may change RF settings by itself while running this command
+  pn53x_settings_cache_invalidate(pnd, pbtTx[0]);
+  // Only pn53x_writeback_register() learns back the values it writes
+  if (WriteRegister == pbtTx[0])
+    pn53x_known_registers_forget_written(pnd, pbtTx, szTx);
+
   // Handle power mode for PN532
   if ((CHIP_DATA(pnd)->type == PN532) && (TgInitAsTarget == pbtTx[0])) {  // PN532 automatically goes into PowerDown mode when TgInitAsTarget command will be sent
     CHIP_DATA(pnd)->power_mode = POWERDOWN;
   }
 
-  if ((res = CHIP_DATA(pnd)->io->receive(pnd, pbtRx, szRx, timeout)) < 0) {
-    return res;
+  TRACE_BEGIN(pnd, "driver", "receive");
+  NFC_PROBE2(driver_receive__entry, pbtTx[0], szRx);
+  res = CHIP_DATA(pnd)->io->receive(pnd, pbtRx, szRx, timeout);
+  NFC_PROBE3(driver_receive__return, pbtTx[0], szRx, res);
+  TRACE_END(pnd, "driver", "receive", res);
+  nfc_device_record_frame(pnd, NFD_RX, pbtTx[0], res, pbtRx, (res > 0) ? (size_t) res : 0);
+  if (res < 0) {
+    nfc_device_update_stats(pnd, pbtTx[0], szTx, 0, res, monotonic_time_us() - i64Start);
+    TRACE_END(pnd, "pn53x", pcSpan, res);
+    NFC_PROBE3(pn53x_transceive__return, pbtTx[0], szTx, res);
+    return pn53x_transceive_failed(pnd, pbtTx, szTx, pbtRx, szRxLen, timeout, false, res);
   }
+  // Chip answered, the link is in sync
+  CHIP_DATA(pnd)->wedge_count = 0;
 
   if ((CHIP_DATA(pnd)->type == PN532) && (TgInitAsTarget == pbtTx[0])) { // PN532 automatically wakeup on external RF field
     CHIP_DATA(pnd)->power_mode = NORMAL; // When TgInitAsTarget reply that means an external RF have waken up the chip
@@ -295,12 +522,16 @@ pn53x_transceive(struct nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx
     { EMFAUTH, "Mifare Authentication Error" },
   */
 
+  nfc_device_update_stats(pnd, pbtTx[0], szTx, szRx, res, monotonic_time_us() - i64Start);
+
   if (res < 0) {
     pnd->last_error = res;
     log_put(LOG_CATEGORY, NFC_PRIORITY_TRACE, "Chip error: \"%s\" (%02x), returned error: \"%s\" (%d))", pn53x_strerror(pnd), CHIP_DATA(pnd)->last_status_byte, nfc_strerror(pnd), res);
   } else {
     pnd->last_error = 0;
   }
+  TRACE_END(pnd, "pn53x", pcSpan, res);
+  NFC_PROBE3(pn53x_transceive__return, pbtTx[0], szTx, res);
   return res;
 }
 
@@ -334,104 +565,105 @@ int
 pn53x_wrap_frame(const uint8_t *pbtTx, const size_t szTxBits, const uint8_t *pbtTxPar,
                  uint8_t *pbtFrame)
 {
-  uint8_t  btFrame;
-  uint8_t  btData;
-  uint32_t uiBitPos;
-  uint32_t uiDataPos = 0;
-  size_t  szBitsLeft = szTxBits;
-  size_t szFrameBits = 0;
-
   // Make sure we should frame at least something
-  if (szBitsLeft == 0)
+  if (szTxBits == 0)
     return NFC_ECHIP;
 
   // Handle a short response (1byte) as a special case
-  if (szBitsLeft < 9) {
+  if (szTxBits < 9) {
     *pbtFrame = *pbtTx;
-    szFrameBits = szTxBits;
-    return szFrameBits;
+    return szTxBits;
   }
   // We start by calculating the frame length in bits
-  szFrameBits = szTxBits + (szTxBits / 8);
-
-  // Parse the data bytes and add the parity bits
-  // This is really a sensitive process, mirror the frame bytes and append parity bits
-  // buffer = mirror(frame-byte) + parity + mirror(frame-byte) + parity + ...
-  // split "buffer" up in segments of 8 bits again and mirror them
-  // air-bytes = mirror(buffer-byte) + mirror(buffer-byte) + mirror(buffer-byte) + ..
-  while (true) {
-    // Reset the temporary frame byte;
-    btFrame = 0;
-
-    for (uiBitPos = 0; uiBitPos < 8; uiBitPos++) {
-      // Copy as much data that fits in the frame byte
-      btData = mirror(pbtTx[uiDataPos]);
-      btFrame |= (btData >> uiBitPos);
-      // Save this frame byte
-      *pbtFrame = mirror(btFrame);
-      // Set the remaining bits of the date in the new frame byte and append the parity bit
-      btFrame = (btData << (8 - uiBitPos));
-      btFrame |= ((pbtTxPar[uiDataPos] & 0x01) << (7 - uiBitPos));
-      // Backup the frame bits we have so far
-      pbtFrame++;
-      *pbtFrame = mirror(btFrame);
-      // Increase the data (without parity bit) position
-      uiDataPos++;
-      // Test if we are done
-      if (szBitsLeft < 9)
-        return szFrameBits;
-      szBitsLeft -= 8;
-    }
-    // Every 8 data bytes we lose one frame byte to the parities
-    pbtFrame++;
+  const size_t szFrameBits = szTxBits + (szTxBits / 8);
+
+  // Bits are sent LSB first, each data byte being followed by its parity bit:
+  // frame-bits = data-byte + parity + data-byte + parity + ...
+  // So every 8 data bytes and their 8 parity bits fill exactly 9 frame bytes
+  size_t szBytesLeft = (szTxBits + 7) / 8;
+  while (szBytesLeft >= 8) {
+    uint64_t ui64Bits = 0;
+    for (int n = 0; n < 7; n++) {
+      ui64Bits |= ((uint64_t) pbtTx[n] | ((uint64_t)(pbtTxPar[n] & 0x01) << 8)) << (9 * n);
+    }
+    ui64Bits |= (uint64_t)(pbtTx[7] & 0x01) << 63;
+    for (int n = 0; n < 8; n++) {
+      pbtFrame[n] = (uint8_t)(ui64Bits >> (8 * n));
+    }
+    pbtFrame[8] = (pbtTx[7] >> 1) | ((pbtTxPar[7] & 0x01) << 7);
+    pbtTx += 8;
+    pbtTxPar += 8;
+    pbtFrame += 9;
+    szBytesLeft -= 8;
+  }
+
+  // Remaining (less than 8) data bytes go through a bit accumulator
+  uint32_t ui32Bits = 0;
+  uint8_t ui8BitCount = 0;
+  while (szBytesLeft--) {
+    ui32Bits |= ((uint32_t) * pbtTx++ | ((uint32_t)(*pbtTxPar++ & 0x01) << 8)) << ui8BitCount;
+    ui8BitCount += 9;
+    while (ui8BitCount >= 8) {
+      *pbtFrame++ = (uint8_t) ui32Bits;
+      ui32Bits >>= 8;
+      ui8BitCount -= 8;
+    }
   }
+  if (ui8BitCount)
+    *pbtFrame = (uint8_t) ui32Bits;
+
+  return szFrameBits;
 }
 
 int
 pn53x_unwrap_frame(const uint8_t *pbtFrame, const size_t szFrameBits, uint8_t *pbtRx, uint8_t *pbtRxPar)
 {
-  uint8_t  btFrame;
-  uint8_t  btData;
-  uint8_t uiBitPos;
-  uint32_t uiDataPos = 0;
-  uint8_t *pbtFramePos = (uint8_t *) pbtFrame;
-  size_t  szBitsLeft = szFrameBits;
-  size_t szRxBits = 0;
-
   // Make sure we should frame at least something
-  if (szBitsLeft == 0)
+  if (szFrameBits == 0)
     return NFC_ECHIP;
 
   // Handle a short response (1byte) as a special case
-  if (szBitsLeft < 9) {
+  if (szFrameBits < 9) {
     *pbtRx = *pbtFrame;
-    szRxBits = szFrameBits;
-    return szRxBits;
+    return szFrameBits;
   }
   // Calculate the data length in bits
-  szRxBits = szFrameBits - (szFrameBits / 9);
+  const size_t szRxBits = szFrameBits - (szFrameBits / 9);
 
   // Parse the frame bytes, remove the parity bits and store them in the parity array
-  // This process is the reverse of WrapFrame(), look there for more info
-  while (true) {
-    for (uiBitPos = 0; uiBitPos < 8; uiBitPos++) {
-      btFrame = mirror(pbtFramePos[uiDataPos]);
-      btData = (btFrame << uiBitPos);
-      btFrame = mirror(pbtFramePos[uiDataPos + 1]);
-      btData |= (btFrame >> (8 - uiBitPos));
-      pbtRx[uiDataPos] = mirror(btData);
-      if (pbtRxPar != NULL)
-        pbtRxPar[uiDataPos] = ((btFrame >> (7 - uiBitPos)) & 0x01);
-      // Increase the data (without parity bit) position
-      uiDataPos++;
-      // Test if we are done
-      if (szBitsLeft < 9)
-        return szRxBits;
-      szBitsLeft -= 9;
-    }
-    // Every 8 data bytes we lose one frame byte to the parities
-    pbtFramePos++;
+  // This process is the reverse of pn53x_wrap_frame(), look there for more info
+  size_t szBytesLeft = (szFrameBits + 8) / 9;
+  while (szBytesLeft >= 8) {
+    uint64_t ui64Bits = 0;
+    for (int n = 0; n < 8; n++) {
+      ui64Bits |= (uint64_t) pbtFrame[n] << (8 * n);
+    }
+    for (int n = 0; n < 7; n++) {
+      pbtRx[n] = (uint8_t)(ui64Bits >> (9 * n));
+    }
+    pbtRx[7] = (uint8_t)((ui64Bits >> 63) | (pbtFrame[8] << 1));
+    if (pbtRxPar != NULL) {
+      for (int n = 0; n < 7; n++) {
+        pbtRxPar[n] = (ui64Bits >> (9 * n + 8)) & 0x01;
+      }
+      pbtRxPar[7] = pbtFrame[8] >> 7;
+      pbtRxPar += 8;
+    }
+    pbtFrame += 9;
+    pbtRx += 8;
+    szBytesLeft -= 8;
   }
+
+  // Remaining (less than 8) data bytes are read through a 16 bits window
+  for (size_t n = 0; n < szBytesLeft; n++) {
+    const size_t szBitPos = 9 * n;
+    const uint16_t ui16Bits = (pbtFrame[szBitPos / 8] | (pbtFrame[szBitPos / 8 + 1] << 8)) >> (szBitPos % 8);
+    pbtRx[n] = (uint8_t) ui16Bits;
+    if (pbtRxPar != NULL)
+      pbtRxPar[n] = (ui16Bits >> 8) & 0x01;
+  }
+
+  return szRxBits;
 }
 
 int
@@ -633,6 +865,13 @@ pn53x_write_register(struct nfc_device *pnd, const uint16_t ui16RegisterAddress,
   } else {
     // Write-back cache area
     const int internal_address = ui16RegisterAddress - PN53X_CACHE_REGISTER_MIN_ADDRESS;
+    if (((CHIP_DATA(pnd)->kn_mask[internal_address] & ui8SymbolMask) == ui8SymbolMask) &&
+        (((CHIP_DATA(pnd)->kn_data[internal_address] ^ ui8Value) & ui8SymbolMask) == 0)) {
+      // Chip register already holds (or will hold once written back) the requested value
+      return NFC_SUCCESS;
+    }
+    CHIP_DATA(pnd)->kn_data[internal_address] = (CHIP_DATA(pnd)->kn_data[internal_address] & (~ui8SymbolMask)) | (ui8Value & ui8SymbolMask);
+    CHIP_DATA(pnd)->kn_mask[internal_address] = CHIP_DATA(pnd)->kn_mask[internal_address] | ui8SymbolMask;
     CHIP_DATA(pnd)->wb_data[internal_address] = (CHIP_DATA(pnd)->wb_data[internal_address] & CHIP_DATA(pnd)->wb_mask[internal_address] & (~ui8SymbolMask)) | (ui8Value & ui8SymbolMask);
     CHIP_DATA(pnd)->wb_mask[internal_address] = CHIP_DATA(pnd)->wb_mask[internal_address] | ui8SymbolMask;
     CHIP_DATA(pnd)->wb_trigged = true;
@@ -675,6 +914,9 @@ pn53x_writeback_register(struct nfc_device *pnd)
     for (size_t n = 0; n < PN53X_CACHE_REGISTER_SIZE; n++) {
       if ((CHIP_DATA(pnd)->wb_mask[n]) && (CHIP_DATA(pnd)->wb_mask[n] != 0xff)) {
         CHIP_DATA(pnd)->wb_data[n] = ((CHIP_DATA(pnd)->wb_data[n] & CHIP_DATA(pnd)->wb_mask[n]) | (abtRes[i] & (~CHIP_DATA(pnd)->wb_mask[n])));
+        // Whole register value is now known
+        CHIP_DATA(pnd)->kn_data[n] = CHIP_DATA(pnd)->wb_data[n];
+        CHIP_DATA(pnd)->kn_mask[n] = 0xff;
         if (CHIP_DATA(pnd)->wb_data[n] != abtRes[i]) {
           // Requested value is different from read one
           CHIP_DATA(pnd)->wb_mask[n] = 0xff;  // We can now apply whole data bits
@@ -695,18 +937,25 @@ pn53x_writeback_register(struct nfc_device *pnd)
       BUFFER_APPEND(abtWriteRegisterCmd, pn53x_register_address  >> 8);
       BUFFER_APPEND(abtWriteRegisterCmd, pn53x_register_address & 0xff);
       BUFFER_APPEND(abtWriteRegisterCmd, CHIP_DATA(pnd)->wb_data[n]);
-      // This register is handled, we reset the mask to prevent
-      CHIP_DATA(pnd)->wb_mask[n] = 0x00;
     }
   }
 
   if (BUFFER_SIZE(abtWriteRegisterCmd) > 1) {
     // We need to write some registers
-    if ((res = pn53x_transceive(pnd, abtWriteRegisterCmd, BUFFER_SIZE(abtWriteRegisterCmd), NULL, 0, -1)) < 0) {
-      return res;
+    res = pn53x_transceive(pnd, abtWriteRegisterCmd, BUFFER_SIZE(abtWriteRegisterCmd), NULL, 0, -1);
+  }
+  for (size_t n = 0; n < PN53X_CACHE_REGISTER_SIZE; n++) {
+    if (CHIP_DATA(pnd)->wb_mask[n] == 0xff) {
+      if (res >= 0) {
+        // Written register value is known again
+        CHIP_DATA(pnd)->kn_data[n] = CHIP_DATA(pnd)->wb_data[n];
+        CHIP_DATA(pnd)->kn_mask[n] = 0xff;
+      }
+      // This register is handled, we reset the mask to prevent
+      CHIP_DATA(pnd)->wb_mask[n] = 0x00;
     }
   }
-  return NFC_SUCCESS;
+  return (res < 0) ? res : NFC_SUCCESS;
 }
 
 int
@@ -790,6 +1039,7 @@ pn53x_set_property_int(struct nfc_device *pnd, const nfc_property property, cons
       break;
     case NP_TIMEOUT_COM:
       CHIP_DATA(pnd)->timeout_communication = value;
+      pnd->iTimeoutCom = value;
       return pn53x_RFConfiguration__Various_timings(pnd, pn53x_int_to_timeout(CHIP_DATA(pnd)->timeout_atr), pn53x_int_to_timeout(CHIP_DATA(pnd)->timeout_communication));
       break;
       // Following properties are invalid (not integer)
@@ -805,6 +1055,7 @@ pn53x_set_property_int(struct nfc_device *pnd, const nfc_property property, cons
     case NP_FORCE_ISO14443_A:
     case NP_FORCE_ISO14443_B:
     case NP_FORCE_SPEED_106:
+    case NP_AUTO_PSL:
       return NFC_EINVARG;
   }
   return NFC_SUCCESS;
@@ -893,6 +1144,10 @@ pn53x_set_property_bool(struct nfc_device *pnd, const nfc_property property, con
         // Nothing to do
         return NFC_SUCCESS;
       }
+      if (CHIP_DATA(pnd)->forced_nmt == NMT_ISO14443A) {
+        // Already forced
+        return NFC_SUCCESS;
+      }
       // Force pn53x to be in ISO14443-A mode
       if ((res = pn53x_write_register(pnd, PN53X_REG_CIU_TxMode, SYMBOL_TX_FRAMING, 0x00)) < 0) {
         return res;
@@ -901,7 +1156,11 @@ pn53x_set_property_bool(struct nfc_device *pnd, const nfc_property property, con
         return res;
       }
       // Set the PN53X to force 100% ASK Modified miller decoding (default for 14443A cards)
-      return pn53x_write_register(pnd, PN53X_REG_CIU_TxAuto, SYMBOL_FORCE_100_ASK, 0x40);
+      if ((res = pn53x_write_register(pnd, PN53X_REG_CIU_TxAuto, SYMBOL_FORCE_100_ASK, 0x40)) < 0) {
+        return res;
+      }
+      CHIP_DATA(pnd)->forced_nmt = NMT_ISO14443A;
+      return NFC_SUCCESS;
       break;
 
     case NP_FORCE_ISO14443_B:
@@ -909,11 +1168,19 @@ pn53x_set_property_bool(struct nfc_device *pnd, const nfc_property property, con
         // Nothing to do
         return NFC_SUCCESS;
       }
+      if (CHIP_DATA(pnd)->forced_nmt == NMT_ISO14443B) {
+        // Already forced
+        return NFC_SUCCESS;
+      }
       // Force pn53x to be in ISO14443-B mode
       if ((res = pn53x_write_register(pnd, PN53X_REG_CIU_TxMode, SYMBOL_TX_FRAMING, 0x03)) < 0) {
         return res;
       }
-      return pn53x_write_register(pnd, PN53X_REG_CIU_RxMode, SYMBOL_RX_FRAMING, 0x03);
+      if ((res = pn53x_write_register(pnd, PN53X_REG_CIU_RxMode, SYMBOL_RX_FRAMING, 0x03)) < 0) {
+        return res;
+      }
+      CHIP_DATA(pnd)->forced_nmt = NMT_ISO14443B;
+      return NFC_SUCCESS;
       break;
 
     case NP_FORCE_SPEED_106:
@@ -921,11 +1188,30 @@ pn53x_set_property_bool(struct nfc_device *pnd, const nfc_property property, con
         // Nothing to do
         return NFC_SUCCESS;
       }
+      if (CHIP_DATA(pnd)->forced_speed_106) {
+        // Already forced
+        return NFC_SUCCESS;
+      }
       // Force pn53x to be at 106 kbps
       if ((res = pn53x_write_register(pnd, PN53X_REG_CIU_TxMode, SYMBOL_TX_SPEED, 0x00)) < 0) {
         return res;
       }
-      return pn53x_write_register(pnd, PN53X_REG_CIU_RxMode, SYMBOL_RX_SPEED, 0x00);
+      if ((res = pn53x_write_register(pnd, PN53X_REG_CIU_RxMode, SYMBOL_RX_SPEED, 0x00)) < 0) {
+        return res;
+      }
+      if (CHIP_DATA(pnd)->modwidth_changed) {
+        if ((res = pn53x_write_register(pnd, PN53X_REG_CIU_ModWidth, 0xff, PN53X_MODWIDTH_106)) < 0) {
+          return res;
+        }
+        CHIP_DATA(pnd)->modwidth_changed = false;
+      }
+      CHIP_DATA(pnd)->forced_speed_106 = true;
+      return NFC_SUCCESS;
+      break;
+
+    case NP_AUTO_PSL:
+      pnd->bAutoPsl = bEnable;
+      return NFC_SUCCESS;
       break;
       // Following properties are invalid (not boolean)
     case NP_TIMEOUT_COMMAND:
@@ -1029,34 +1315,158 @@ pn532_initiator_init_secure_element(struct nfc_device *pnd)
   return pn532_SAMConfiguration(pnd, PSM_WIRED_CARD, -1);
 }
 
+/**
+ * @brief Configure the PN53x to exchange raw ISO14443-B frames at 106 kbps
+ *
+ * Used for discovery of targets that InListPassiveTarget does not handle natively.
+ */
+static int
+pn53x_initiator_init_iso14443b_raw(struct nfc_device *pnd)
+{
+  int res = 0;
+  if (CHIP_DATA(pnd)->type == RCS360) {
+    // TODO add support for RC-S360, at the moment it refuses to send raw frames without a first select
+    pnd->last_error = NFC_ENOTIMPL;
+    return pnd->last_error;
+  }
+  if ((res = nfc_device_set_property_bool(pnd, NP_FORCE_ISO14443_B, true)) < 0) {
+    return res;
+  }
+  if ((res = nfc_device_set_property_bool(pnd, NP_FORCE_SPEED_106, true)) < 0) {
+    return res;
+  }
+  if ((res = nfc_device_set_property_bool(pnd, NP_HANDLE_CRC, true)) < 0) {
+    return res;
+  }
+  pnd->bEasyFraming = false;
+  return NFC_SUCCESS;
+}
+
+/**
+ * @brief Set automatic RATS and ATR_REQ chip parameters according to discovery flags
+ *
+ * Parameters are left as is after the discovery, so consecutive discoveries
+ * using the same flags do not send any SetParameters command.
+ */
+static int
+pn53x_initiator_set_discovery_parameters(struct nfc_device *pnd, const int flags)
+{
+  uint8_t ui8Parameters = CHIP_DATA(pnd)->ui8Parameters & ~(PARAM_AUTO_RATS | PARAM_AUTO_ATR_RES);
+  if (!(flags & NDF_UID_ONLY)) {
+    ui8Parameters |= PARAM_AUTO_ATR_RES;
+    if (pnd->bAutoIso14443_4)
+      ui8Parameters |= PARAM_AUTO_RATS;
+  }
+  if (ui8Parameters == CHIP_DATA(pnd)->ui8Parameters)
+    return NFC_SUCCESS;
+  return pn53x_SetParameters(pnd, ui8Parameters);
+}
+
+// Highest ISO14443-4A bit rate up to nbrMax supported in both directions by the chip and the target (TA(1) of its ATS)
+static nfc_baud_rate
+pn53x_iso14443a_pps_baud_rate(struct nfc_device *pnd, const nfc_target *pnt, const nfc_baud_rate nbrMax)
+{
+  const uint8_t *pbtAts = pnt->nti.nai.abtAts;
+  const nfc_baud_rate *pnbr;
+
+  if ((pnt->nti.nai.szAtsLen < 2) || !(pbtAts[0] & 0x10)) {
+    // No TA(1): target only supports 106 kbps
+    return NBR_106;
+  }
+  if (pn53x_get_supported_baud_rate(pnd, NMT_ISO14443A, &pnbr) < 0)
+    return NBR_106;
+  // Supported bit rates are listed from the highest one
+  for (; *pnbr; pnbr++) {
+    if ((*pnbr > nbrMax) || (*pnbr == NBR_106))
+      continue;
+    // TA(1): b7..b5 DS (target to chip), b3..b1 DR (chip to target), for 848, 424 and 212 kbps
+    const int n = *pnbr - NBR_106;
+    if ((pbtAts[1] & (0x08 << n)) && (pbtAts[1] & (0x01 << (n - 1))))
+      return *pnbr;
+  }
+  return NBR_106;
+}
+
+// Raise the bit rate of an ISO14443-4A target activated by the chip: the firmware sends PPS itself (InPSL)
+static int
+pn53x_initiator_iso14443a_inpsl(struct nfc_device *pnd, nfc_target *pnt, const nfc_baud_rate nbrMax)
+{
+  const nfc_baud_rate nbr = pn53x_iso14443a_pps_baud_rate(pnd, pnt, nbrMax);
+  pnt->nm.nbr = NBR_106;
+  if (nbr == NBR_106)
+    return NFC_SUCCESS;
+
+  // BRit, BRti: 0x00 for 106 kbps up to 0x03 for 848 kbps
+  const uint8_t btBr = nbr - NBR_106;
+  const uint8_t abtCmd[] = { InPSL, 0x01, btBr, btBr };
+  int res;
+  if ((res = pn53x_transceive(pnd, abtCmd, sizeof(abtCmd), NULL, 0, -1)) < 0) {
+    if (res != NFC_ERFTRANS)
+      return res;
+    // Target did not accept PPS, it keeps on at 106 kbps
+    log_put(LOG_CATEGORY, NFC_PRIORITY_INFO, "%s", "PPS failed, staying at 106 kbps");
+    return NFC_SUCCESS;
+  }
+  pnt->nm.nbr = nbr;
+  return NFC_SUCCESS;
+}
+
+// Raise the bit rate of an ISO14443-4A target activated by the host: PPS is sent as a raw frame, then the CIU is switched to the new bit rate
+static int
+pn53x_initiator_iso14443a_pps(struct nfc_device *pnd, nfc_target *pnt, const nfc_baud_rate nbrMax)
+{
+  // Miller pause width for 212, 424 and 848 kbps
+  const uint8_t abtModWidth[] = { PN53X_MODWIDTH_212, PN53X_MODWIDTH_424, PN53X_MODWIDTH_848 };
+  const nfc_baud_rate nbr = pn53x_iso14443a_pps_baud_rate(pnd, pnt, nbrMax);
+  pnt->nm.nbr = NBR_106;
+  if (nbr == NBR_106)
+    return NFC_SUCCESS;
+
+  // PPSS (CID 0), PPS0 (PPS1 follows), PPS1: DSI (b4..b3) and DRI (b2..b1)
+  const uint8_t n = nbr - NBR_106;
+  const uint8_t abtPps[] = { 0xd0, 0x11, (n << 2) | n };
+  uint8_t abtPpsRes[1];
+  const bool bEasyFraming = pnd->bEasyFraming;
+  int res;
+  pnd->bEasyFraming = false;
+  res = pn53x_initiator_transceive_bytes(pnd, abtPps, sizeof(abtPps), abtPpsRes, sizeof(abtPpsRes), -1);
+  pnd->bEasyFraming = bEasyFraming;
+  if ((res == NFC_ERFTRANS) || ((res >= 0) && ((res != 1) || (abtPpsRes[0] != abtPps[0])))) {
+    // Target did not accept PPS, it keeps on at 106 kbps
+    log_put(LOG_CATEGORY, NFC_PRIORITY_INFO, "%s", "PPS failed, staying at 106 kbps");
+    return NFC_SUCCESS;
+  }
+  if (res < 0)
+    return res;
+
+  if ((res = pn53x_write_register(pnd, PN53X_REG_CIU_TxMode, SYMBOL_TX_SPEED, n << 4)) < 0)
+    return res;
+  if ((res = pn53x_write_register(pnd, PN53X_REG_CIU_RxMode, SYMBOL_RX_SPEED, n << 4)) < 0)
+    return res;
+  if ((res = pn53x_write_register(pnd, PN53X_REG_CIU_ModWidth, 0xff, abtModWidth[n - 1])) < 0)
+    return res;
+  CHIP_DATA(pnd)->forced_speed_106 = false;
+  CHIP_DATA(pnd)->modwidth_changed = true;
+  pnt->nm.nbr = nbr;
+  return NFC_SUCCESS;
+}
+
 static int
 pn53x_initiator_select_passive_target_ext(struct nfc_device *pnd,
                                           const nfc_modulation nm,
                                           const uint8_t *pbtInitData, const size_t szInitData,
                                           nfc_target *pnt,
-                                          int timeout)
+                                          int timeout, const int flags)
 {
   uint8_t  abtTargetsData[PN53x_EXTENDED_FRAME__DATA_MAX_LEN];
   size_t  szTargetsData = sizeof(abtTargetsData);
   int res = 0;
 
   if (nm.nmt == NMT_ISO14443BI || nm.nmt == NMT_ISO14443B2SR || nm.nmt == NMT_ISO14443B2CT) {
-    if (CHIP_DATA(pnd)->type == RCS360) {
-      // TODO add support for RC-S360, at the moment it refuses to send raw frames without a first select
-      pnd->last_error = NFC_ENOTIMPL;
-      return pnd->last_error;
-    }
     // No native support in InListPassiveTarget so we do discovery by hand
-    if ((res = nfc_device_set_property_bool(pnd, NP_FORCE_ISO14443_B, true)) < 0) {
-      return res;
-    }
-    if ((res = nfc_device_set_property_bool(pnd, NP_FORCE_SPEED_106, true)) < 0) {
-      return res;
-    }
-    if ((res = nfc_device_set_property_bool(pnd, NP_HANDLE_CRC, true)) < 0) {
+    if ((res = pn53x_initiator_init_iso14443b_raw(pnd)) < 0) {
       return res;
     }
-    pnd->bEasyFraming = false;
     if (nm.nmt == NMT_ISO14443B2SR) {
       // Some work to do before getting the UID...
       uint8_t abtInitiate[] = "\x06\x00";
@@ -1119,6 +1529,11 @@ pn53x_initiator_select_passive_target_ext(struct nfc_device *pnd,
     return pnd->last_error;
   }
 
+  if (nm.nmt == NMT_ISO14443A) {
+    if ((res = pn53x_initiator_set_discovery_parameters(pnd, flags)) < 0)
+      return res;
+  }
+
   if ((res = pn53x_InListPassiveTarget(pnd, pm, 1, pbtInitData, szInitData, abtTargetsData, &szTargetsData, timeout)) <= 0)
     return res;
 
@@ -1129,6 +1544,13 @@ pn53x_initiator_select_passive_target_ext(struct nfc_device *pnd,
     if ((res = pn53x_decode_target_data(abtTargetsData + 1, szTargetsData - 1, CHIP_DATA(pnd)->type, nm.nmt, &(pnt->nti)) < 0)) {
       return res;
     }
+    if (nm.nmt == NMT_ISO14443A) {
+      // nm.nbr is the highest bit rate to negotiate once the target is activated in ISO14443-4
+      CHIP_DATA(pnd)->pps_nbr_max = nm.nbr;
+      pnt->nm.nbr = NBR_106;
+      if (pnt->nti.nai.szAtsLen && ((res = pn53x_initiator_iso14443a_inpsl(pnd, pnt, nm.nbr)) < 0))
+        return res;
+    }
     pn53x_current_target_new(pnd, pnt);
   }
   return abtTargetsData[0];
@@ -1138,20 +1560,306 @@ int
 pn53x_initiator_select_passive_target(struct nfc_device *pnd,
                                       const nfc_modulation nm,
                                       const uint8_t *pbtInitData, const size_t szInitData,
-                                      nfc_target *pnt)
+                                      nfc_target *pnt, const int flags)
+{
+  return pn53x_initiator_select_passive_target_ext(pnd, nm, pbtInitData, szInitData, pnt, 0, flags);
+}
+
+int
+pn53x_initiator_activate_iso14443_4(struct nfc_device *pnd, nfc_target *pnt)
+{
+  int res = 0;
+
+  if ((pnt->nm.nmt != NMT_ISO14443A) || !(pnt->nti.nai.btSak & SAK_ISO14443_4_COMPLIANT)) {
+    pnd->last_error = NFC_EINVARG;
+    return pnd->last_error;
+  }
+  if (!pn53x_current_target_is(pnd, pnt)) {
+    pnd->last_error = NFC_ETGRELEASED;
+    return pnd->last_error;
+  }
+  if (pnt->nti.nai.szAtsLen) {
+    // RATS has already been sent during selection
+    return NFC_SUCCESS;
+  }
+
+  // RATS: FSDI (max frame size the reader can receive) has to fit in a PN53x frame, CID is 0
+  const uint8_t abtRats[] = { 0xe0, (CHIP_DATA(pnd)->type == PN533) ? 0x80 : 0x70 };
+  uint8_t abtAts[PN53x_EXTENDED_FRAME__DATA_MAX_LEN];
+  const bool bEasyFraming = pnd->bEasyFraming;
+  if ((res = nfc_device_set_property_bool(pnd, NP_HANDLE_CRC, true)) < 0) {
+    return res;
+  }
+  pnd->bEasyFraming = false;
+  res = pn53x_initiator_transceive_bytes(pnd, abtRats, sizeof(abtRats), abtAts, sizeof(abtAts), -1);
+  pnd->bEasyFraming = bEasyFraming;
+  if (res < 0) {
+    return res;
+  }
+  // ATS starts with its own length (TL) which is not stored
+  if ((res < 1) || (abtAts[0] != res) || ((size_t)(res - 1) > sizeof(pnt->nti.nai.abtAts))) {
+    pnd->last_error = NFC_ERFTRANS;
+    return pnd->last_error;
+  }
+  pnt->nti.nai.szAtsLen = res - 1;
+  memcpy(pnt->nti.nai.abtAts, abtAts + 1, pnt->nti.nai.szAtsLen);
+  if ((res = pn53x_initiator_iso14443a_pps(pnd, pnt, CHIP_DATA(pnd)->pps_nbr_max)) < 0)
+    return res;
+  pn53x_current_target_new(pnd, pnt);
+  return NFC_SUCCESS;
+}
+
+// Max number of REQB/WUPB rounds done while at least one collision remains
+#define PN53X_ISO14443B_ANTICOL_MAX_ROUNDS 4
+
+static int
+pn53x_initiator_list_iso14443b_targets(struct nfc_device *pnd,
+                                       const uint8_t *pbtInitData, const size_t szInitData,
+                                       nfc_target ant[], const size_t szTargets)
+{
+  int res = 0;
+  size_t szTargetFound = 0;
+  // Number of slots is 2^ui8SlotsExp: we start with 4 slots and grow up to 16 slots while collisions occur
+  uint8_t ui8SlotsExp = 2;
+  const uint8_t btAfi = (szInitData > 0) ? pbtInitData[0] : 0x00;
+
+  // No anticollision support in InListPassiveTarget so we do it by hand
+  const bool bEasyFraming = pnd->bEasyFraming;
+  if ((res = pn53x_initiator_init_iso14443b_raw(pnd)) < 0) {
+    return res;
+  }
+  pn53x_current_target_free(pnd);
+
+  for (uint8_t ui8Round = 0; (ui8Round < PN53X_ISO14443B_ANTICOL_MAX_ROUNDS) && (szTargetFound < szTargets); ui8Round++) {
+    bool bCollision = false;
+    const size_t szSlots = 1 << ui8SlotsExp;
+    for (size_t szSlot = 0; (szSlot < szSlots) && (szTargetFound < szTargets); szSlot++) {
+      uint8_t abtCmd[3];
+      size_t szCmd;
+      if (szSlot == 0) {
+        // REQB/WUPB: APf, AFI, PARAM (b4: WUPB, b3..b1: N)
+        // Only the first round wakes up HALTed PICCs, the next ones address the remaining PICCs which are not HALTed yet
+        abtCmd[0] = 0x05;
+        abtCmd[1] = btAfi;
+        abtCmd[2] = ((ui8Round == 0) ? 0x08 : 0x00) | ui8SlotsExp;
+        szCmd = 3;
+      } else {
+        // Slot-MARKER: APn with slot number n = szSlot + 1 coded as (n-1) in the upper nibble
+        abtCmd[0] = (uint8_t)(szSlot << 4) | 0x05;
+        szCmd = 1;
+      }
+      uint8_t abtAtqb[PN53x_EXTENDED_FRAME__DATA_MAX_LEN];
+      if ((res = pn53x_initiator_transceive_bytes(pnd, abtCmd, szCmd, abtAtqb, sizeof(abtAtqb), -1)) < 0) {
+        if (res != NFC_ERFTRANS)
+          goto error;
+        // No answer means an empty slot, any other RF error means several PICCs answered in this slot
+        if (CHIP_DATA(pnd)->last_status_byte != ETIMEOUT)
+          bCollision = true;
+        continue;
+      }
+      // ATQB: 0x50, PUPI (4 bytes), Application Data (4 bytes), Protocol Info (3 bytes)
+      if ((res < 12) || (abtAtqb[0] != 0x50)) {
+        bCollision = true;
+        continue;
+      }
+
+      nfc_target nt;
+      memset(&nt, 0x00, sizeof(nfc_target));
+      nt.nm.nmt = NMT_ISO14443B;
+      nt.nm.nbr = NBR_106;
+      // Mimic InListPassiveTarget output: Tg, ATQB, no ATTRIB_RES
+      uint8_t abtTargetData[14];
+      abtTargetData[0] = 1;
+      memcpy(abtTargetData + 1, abtAtqb, 12);
+      abtTargetData[13] = 0;
+      if ((res = pn53x_decode_target_data(abtTargetData, sizeof(abtTargetData), CHIP_DATA(pnd)->type, NMT_ISO14443B, &(nt.nti))) < 0) {
+        goto error;
+      }
+
+      // HLTB: the PICC will not answer to the following REQB
+      uint8_t abtHltb[5] = { 0x50 };
+      memcpy(abtHltb + 1, nt.nti.nbi.abtPupi, 4);
+      if (((res = pn53x_initiator_transceive_bytes(pnd, abtHltb, sizeof(abtHltb), NULL, 0, -1)) < 0) && (res != NFC_ERFTRANS)) {
+        goto error;
+      }
+
+      bool seen = false;
+      for (size_t i = 0; i < szTargetFound; i++) {
+        if (memcmp(ant[i].nti.nbi.abtPupi, nt.nti.nbi.abtPupi, 4) == 0) {
+          seen = true;
+        }
+      }
+      if (!seen) {
+        memcpy(&(ant[szTargetFound]), &nt, sizeof(nfc_target));
+        szTargetFound++;
+      }
+    }
+    if (!bCollision) {
+      // Every PICC in the field has answered in its own slot
+      break;
+    }
+    if (ui8SlotsExp < 4) {
+      ui8SlotsExp++;
+    }
+  }
+  pnd->bEasyFraming = bEasyFraming;
+  return szTargetFound;
+
+error:
+  pnd->bEasyFraming = bEasyFraming;
+  pnd->last_error = res;
+  return pnd->last_error;
+}
+
+// Max number of PCALL16 rounds done while at least one collision remains
+#define PN53X_ISO14443B2SR_ANTICOL_MAX_ROUNDS 8
+
+static int
+pn53x_initiator_list_iso14443b2sr_targets(struct nfc_device *pnd, nfc_target ant[], const size_t szTargets)
+{
+  int res = 0;
+  size_t szTargetFound = 0;
+
+  // No anticollision support in InListPassiveTarget so we do it by hand
+  const bool bEasyFraming = pnd->bEasyFraming;
+  if ((res = pn53x_initiator_init_iso14443b_raw(pnd)) < 0) {
+    return res;
+  }
+  pn53x_current_target_free(pnd);
+
+  // INITIATE: every tag in the field enters Inventory state, answers may collide
+  const uint8_t abtInitiate[] = { 0x06, 0x00 };
+  uint8_t abtRx[PN53x_EXTENDED_FRAME__DATA_MAX_LEN];
+  if ((res = pn53x_initiator_transceive_bytes(pnd, abtInitiate, sizeof(abtInitiate), abtRx, sizeof(abtRx), -1)) < 0) {
+    if (res != NFC_ERFTRANS)
+      goto error;
+    if (CHIP_DATA(pnd)->last_status_byte == ETIMEOUT) {
+      // No tag in the field
+      pnd->bEasyFraming = bEasyFraming;
+      return 0;
+    }
+  }
+
+  for (uint8_t ui8Round = 0; (ui8Round < PN53X_ISO14443B2SR_ANTICOL_MAX_ROUNDS) && (szTargetFound < szTargets); ui8Round++) {
+    bool bCollision = false;
+    uint8_t abtChipIds[16];
+    size_t szChipIds = 0;
+    // PCALL16 opens slot 0 and makes each tag draw a new Chip_slot_number, SLOT_MARKER(n) opens the other slots
+    for (uint8_t ui8Slot = 0; ui8Slot < 16; ui8Slot++) {
+      uint8_t abtCmd[2] = { 0x06, 0x04 };
+      size_t szCmd = 2;
+      if (ui8Slot > 0) {
+        abtCmd[0] = (ui8Slot << 4) | 0x06;
+        szCmd = 1;
+      }
+      if ((res = pn53x_initiator_transceive_bytes(pnd, abtCmd, szCmd, abtRx, sizeof(abtRx), -1)) < 0) {
+        if (res != NFC_ERFTRANS)
+          goto error;
+        // No answer means an empty slot, any other RF error means several tags answered in this slot
+        if (CHIP_DATA(pnd)->last_status_byte != ETIMEOUT)
+          bCollision = true;
+        continue;
+      }
+      if (res != 1) {
+        bCollision = true;
+        continue;
+      }
+      abtChipIds[szChipIds++] = abtRx[0];
+    }
+
+    for (size_t n = 0; (n < szChipIds) && (szTargetFound < szTargets); n++) {
+      // SELECT(Chip_ID) then GET_UID
+      const uint8_t abtSelect[] = { 0x0e, abtChipIds[n] };
+      if ((res = pn53x_initiator_transceive_bytes(pnd, abtSelect, sizeof(abtSelect), abtRx, sizeof(abtRx), -1)) < 0) {
+        if (res != NFC_ERFTRANS)
+          goto error;
+        continue;
+      }
+      const uint8_t abtGetUid[] = { 0x0b };
+      if ((res = pn53x_initiator_transceive_bytes(pnd, abtGetUid, sizeof(abtGetUid), abtRx, sizeof(abtRx), -1)) < 0) {
+        if (res != NFC_ERFTRANS)
+          goto error;
+        continue;
+      }
+      if (res != 8) {
+        continue;
+      }
+      nfc_target nt;
+      memset(&nt, 0x00, sizeof(nfc_target));
+      nt.nm.nmt = NMT_ISO14443B2SR;
+      nt.nm.nbr = NBR_106;
+      if ((res = pn53x_decode_target_data(abtRx, 8, CHIP_DATA(pnd)->type, NMT_ISO14443B2SR, &(nt.nti))) < 0) {
+        goto error;
+      }
+      // COMPLETION: the tag is deactivated and stays silent until the next field reset, there is no answer to wait for
+      const uint8_t abtCompletion[] = { 0x0f };
+      if (((res = pn53x_initiator_transceive_bytes(pnd, abtCompletion, sizeof(abtCompletion), NULL, 0, -1)) < 0) && (res != NFC_ERFTRANS)) {
+        goto error;
+      }
+
+      bool seen = false;
+      for (size_t i = 0; i < szTargetFound; i++) {
+        if (memcmp(ant[i].nti.nsi.abtUID, nt.nti.nsi.abtUID, 8) == 0) {
+          seen = true;
+        }
+      }
+      if (!seen) {
+        memcpy(&(ant[szTargetFound]), &nt, sizeof(nfc_target));
+        szTargetFound++;
+      }
+    }
+    if (!bCollision) {
+      // Every tag in the field has answered in its own slot
+      break;
+    }
+  }
+  pnd->bEasyFraming = bEasyFraming;
+
+  // Deactivated tags need a field reset to be reachable again
+  if (szTargetFound) {
+    if ((res = nfc_device_set_property_bool(pnd, NP_ACTIVATE_FIELD, false)) < 0) {
+      return res;
+    }
+    if ((res = nfc_device_set_property_bool(pnd, NP_ACTIVATE_FIELD, true)) < 0) {
+      return res;
+    }
+  }
+  return szTargetFound;
+
+error:
+  pnd->bEasyFraming = bEasyFraming;
+  pnd->last_error = res;
+  return pnd->last_error;
+}
+
+int
+pn53x_initiator_list_passive_targets(struct nfc_device *pnd,
+                                     const nfc_modulation nm,
+                                     const uint8_t *pbtInitData, const size_t szInitData,
+                                     nfc_target ant[], const size_t szTargets)
 {
-  return pn53x_initiator_select_passive_target_ext(pnd, nm, pbtInitData, szInitData, pnt, 0);
+  if ((nm.nmt == NMT_ISO14443B) && (nm.nbr == NBR_106)) {
+    return pn53x_initiator_list_iso14443b_targets(pnd, pbtInitData, szInitData, ant, szTargets);
+  }
+  if (nm.nmt == NMT_ISO14443B2SR) {
+    return pn53x_initiator_list_iso14443b2sr_targets(pnd, ant, szTargets);
+  }
+  // Other modulations are listed using the generic select/deselect loop
+  pnd->last_error = NFC_ENOTIMPL;
+  return pnd->last_error;
 }
 
 int
 pn53x_initiator_poll_target(struct nfc_device *pnd,
                             const nfc_modulation *pnmModulations, const size_t szModulations,
                             const uint8_t uiPollNr, const uint8_t uiPeriod,
-                            nfc_target *pnt)
+                            nfc_target *pnt, const int flags)
 {
   int res = 0;
 
   if (CHIP_DATA(pnd)->type == PN532) {
+    if ((res = pn53x_initiator_set_discovery_parameters(pnd, flags)) < 0)
+      return res;
     size_t szTargetTypes = 0;
     pn53x_target_type apttTargetTypes[32];
     for (size_t n = 0; n < szModulations; n++) {
@@ -1161,7 +1869,7 @@ pn53x_initiator_poll_target(struct nfc_device *pnd,
         return pnd->last_error;
       }
       apttTargetTypes[szTargetTypes] = ptt;
-      if ((pnd->bAutoIso14443_4) && (ptt == PTT_MIFARE)) { // Hack to have ATS
+      if ((pnd->bAutoIso14443_4) && !(flags & NDF_UID_ONLY) && (ptt == PTT_MIFARE)) { // Hack to have ATS
         apttTargetTypes[szTargetTypes] = PTT_ISO14443_4A_106;
         szTargetTypes++;
         apttTargetTypes[szTargetTypes] = PTT_MIFARE;
@@ -1172,19 +1880,22 @@ pn53x_initiator_poll_target(struct nfc_device *pnd,
     if ((res = pn53x_InAutoPoll(pnd, apttTargetTypes, szTargetTypes, uiPollNr, uiPeriod, ntTargets, 0)) < 0)
       return res;
     switch (res) {
+      case 0:
+        // No target found during polling
+        return res;
+        break;
       case 1:
         *pnt = ntTargets[0];
-        return res;
         break;
       case 2:
         *pnt = ntTargets[1]; // We keep the selected one
-        return res;
         break;
       default:
         return NFC_ECHIP;
         break;
     }
     pn53x_current_target_new(pnd, pnt);
+    return res;
   } else {
     pn53x_set_property_bool(pnd, NP_INFINITE_SELECT, true);
     // FIXME It does not support DEP targets
@@ -1196,7 +1907,7 @@ pn53x_initiator_poll_target(struct nfc_device *pnd,
           prepare_initiator_data(pnmModulations[n], &pbtInitiatorData, &szInitiatorData);
           const int timeout_ms = uiPeriod * 150;
 
-          if ((res = pn53x_initiator_select_passive_target_ext(pnd, pnmModulations[n], pbtInitiatorData, szInitiatorData, pnt, timeout_ms)) < 0) {
+          if ((res = pn53x_initiator_select_passive_target_ext(pnd, pnmModulations[n], pbtInitiatorData, szInitiatorData, pnt, timeout_ms, flags)) < 0) {
             if (pnd->last_error != NFC_ETIMEOUT) {
               return pnd->last_error;
             }
@@ -1212,6 +1923,37 @@ pn53x_initiator_poll_target(struct nfc_device *pnd,
   return NFC_ECHIP;
 }
 
+// Raise the bit rate of a D.E.P. link to the highest one supported by the chip and both ways by the target (BSt/BRt of ATR_RES)
+static int
+pn53x_initiator_dep_psl(struct nfc_device *pnd, nfc_target *pnt)
+{
+  const nfc_baud_rate *pnbr;
+  int res;
+
+  if ((res = pn53x_get_supported_baud_rate(pnd, NMT_DEP, &pnbr)) < 0)
+    return res;
+  // Supported bit rates are listed from the highest one
+  for (; *pnbr && (*pnbr > pnt->nm.nbr); pnbr++) {
+    // BSt, BRt: b1 for 212 kbps, b2 for 424 kbps
+    const uint8_t btBit = 0x01 << (*pnbr - NBR_212);
+    if (!(pnt->nti.ndi.btBS & btBit) || !(pnt->nti.ndi.btBR & btBit))
+      continue;
+    // BRit, BRti: 0x00 for 106 kbps up to 0x02 for 424 kbps
+    const uint8_t btBr = *pnbr - NBR_106;
+    const uint8_t abtCmd[] = { InPSL, 0x01, btBr, btBr };
+    if ((res = pn53x_transceive(pnd, abtCmd, sizeof(abtCmd), NULL, 0, -1)) < 0) {
+      if (res != NFC_ERFTRANS)
+        return res;
+      // Target did not accept PSL_REQ, link keeps on at its current bit rate
+      log_put(LOG_CATEGORY, NFC_PRIORITY_INFO, "%s", "PSL failed, keeping current bit rate");
+      return NFC_SUCCESS;
+    }
+    pnt->nm.nbr = *pnbr;
+    return NFC_SUCCESS;
+  }
+  return NFC_SUCCESS;
+}
+
 int
 pn53x_initiator_select_dep_target(struct nfc_device *pnd,
                                   const nfc_dep_mode ndm, const nfc_baud_rate nbr,
@@ -1245,6 +1987,11 @@ pn53x_initiator_select_dep_target(struct nfc_device *pnd,
   } else {
     res = pn53x_InJumpForDEP(pnd, ndm, nbr, pbtPassiveInitiatorData, NULL, NULL, 0, pnt, timeout);
   }
+  if ((res > 0) && pnt && pnd->bAutoPsl) {
+    int res2;
+    if ((res2 = pn53x_initiator_dep_psl(pnd, pnt)) < 0)
+      return res2;
+  }
   if (res >= 0)
     pn53x_current_target_new(pnd, pnt);
   return res;
@@ -1693,8 +2440,6 @@ pn53x_initiator_target_is_present(struct nfc_device *pnd, const nfc_target nt)
   return NFC_ETGRELEASED;
 }
 
-#define SAK_ISO14443_4_COMPLIANT 0x20
-#define SAK_ISO18092_COMPLIANT   0x40
 int
 pn53x_target_init(struct nfc_device *pnd, nfc_target *pnt, uint8_t *pbtRx, const size_t szRxLen, int timeout)
 {
@@ -2168,49 +2913,66 @@ pn53x_strerror(const struct nfc_device *pnd)
   return pcRes;
 }
 
+int
+pn53x_RFConfiguration(struct nfc_device *pnd, const uint8_t ui8Item, const uint8_t *pbtData, const size_t szData)
+{
+  if ((ui8Item >= PN53X_RFCI_CACHE_SIZE) || (szData == 0) || (szData > PN53X_RFCI_DATA_MAX_LEN))
+    return NFC_EINVARG;
+
+  // Skip the command when the item is already configured with the same data
+  if ((CHIP_DATA(pnd)->rfci_len[ui8Item] == szData) && (0 == memcmp(CHIP_DATA(pnd)->rfci_data[ui8Item], pbtData, szData)))
+    return NFC_SUCCESS;
+
+  uint8_t  abtCmd[2 + PN53X_RFCI_DATA_MAX_LEN] = { RFConfiguration, ui8Item };
+  memcpy(abtCmd + 2, pbtData, szData);
+
+  // Item state is unknown until the chip acknowledges the new value
+  CHIP_DATA(pnd)->rfci_len[ui8Item] = 0;
+  int res;
+  if ((res = pn53x_transceive(pnd, abtCmd, 2 + szData, NULL, 0, -1)) < 0)
+    return res;
+  memcpy(CHIP_DATA(pnd)->rfci_data[ui8Item], pbtData, szData);
+  CHIP_DATA(pnd)->rfci_len[ui8Item] = szData;
+  return res;
+}
+
 int
 pn53x_RFConfiguration__RF_field(struct nfc_device *pnd, bool bEnable)
 {
-  uint8_t  abtCmd[] = { RFConfiguration, RFCI_FIELD, (bEnable) ? 0x01 : 0x00 };
-  return pn53x_transceive(pnd, abtCmd, sizeof(abtCmd), NULL, 0, -1);
+  uint8_t  abtData[] = { (bEnable) ? 0x01 : 0x00 };
+  return pn53x_RFConfiguration(pnd, RFCI_FIELD, abtData, sizeof(abtData));
 }
 
 int
 pn53x_RFConfiguration__Various_timings(struct nfc_device *pnd, const uint8_t fATR_RES_Timeout, const uint8_t fRetryTimeout)
 {
-  uint8_t  abtCmd[] = {
-    RFConfiguration,
-    RFCI_TIMING,
+  uint8_t  abtData[] = {
     0x00,		 // RFU
     fATR_RES_Timeout,	 // ATR_RES timeout (default: 0x0B 102.4 ms)
     fRetryTimeout	 // TimeOut during non-DEP communications (default: 0x0A 51.2 ms)
   };
-  return pn53x_transceive(pnd, abtCmd, sizeof(abtCmd), NULL, 0, -1);
+  return pn53x_RFConfiguration(pnd, RFCI_TIMING, abtData, sizeof(abtData));
 }
 
 int
 pn53x_RFConfiguration__MaxRtyCOM(struct nfc_device *pnd, const uint8_t MaxRtyCOM)
 {
-  uint8_t  abtCmd[] = {
-    RFConfiguration,
-    RFCI_RETRY_DATA,
+  uint8_t  abtData[] = {
     MaxRtyCOM         // MaxRtyCOM, default: 0x00 (no retry, only one try), inifite: 0xff
   };
-  return pn53x_transceive(pnd, abtCmd, sizeof(abtCmd), NULL, 0, -1);
+  return pn53x_RFConfiguration(pnd, RFCI_RETRY_DATA, abtData, sizeof(abtData));
 }
 
 int
 pn53x_RFConfiguration__MaxRetries(struct nfc_device *pnd, const uint8_t MxRtyATR, const uint8_t MxRtyPSL, const uint8_t MxRtyPassiveActivation)
 {
   // Retry format: 0x00 means only 1 try, 0xff means infinite
-  uint8_t  abtCmd[] = {
-    RFConfiguration,
-    RFCI_RETRY_SELECT,
+  uint8_t  abtData[] = {
     MxRtyATR,        // MxRtyATR, default: active = 0xff, passive = 0x02
     MxRtyPSL,        // MxRtyPSL, default: 0x01
     MxRtyPassiveActivation         // MxRtyPassiveActivation, default: 0xff (0x00 leads to problems with PN531)
   };
-  return pn53x_transceive(pnd, abtCmd, sizeof(abtCmd), NULL, 0, -1);
+  return pn53x_RFConfiguration(pnd, RFCI_RETRY_SELECT, abtData, sizeof(abtData));
 }
 
 int
@@ -2537,6 +3299,8 @@ pn53x_InJumpForDEP(struct nfc_device *pnd,
       pnt->nti.ndi.btBR = abtRx[14];
       pnt->nti.ndi.btTO = abtRx[15];
       pnt->nti.ndi.btPP = abtRx[16];
+      // LR: 64, 128, 192 or 254 bytes
+      pnt->nti.ndi.szLR = (((abtRx[16] >> 4) & 0x03) == 0x03) ? 254 : 64 * (((abtRx[16] >> 4) & 0x03) + 1);
       if (szRx > 17) {
         pnt->nti.ndi.szGB = szRx - 17;
         memcpy(pnt->nti.ndi.abtGB, abtRx + 17, pnt->nti.ndi.szGB);
@@ -2897,7 +3661,14 @@ pn53x_get_supported_baud_rate(nfc_device *pnd, const nfc_modulation_type nmt, co
       *supported_br = (nfc_baud_rate *)pn53x_felica_supported_baud_rates;
       break;
     case NMT_ISO14443A:
-      *supported_br = (nfc_baud_rate *)pn53x_iso14443a_supported_baud_rates;
+      // Bit rates above 106 kbps are reached by PPS once the target is activated in ISO14443-4
+      if (CHIP_DATA(pnd)->type == PN533) {
+        *supported_br = (nfc_baud_rate *)pn533_iso14443a_supported_baud_rates;
+      } else if (CHIP_DATA(pnd)->type == PN532) {
+        *supported_br = (nfc_baud_rate *)pn532_iso14443a_supported_baud_rates;
+      } else {
+        *supported_br = (nfc_baud_rate *)pn531_iso14443a_supported_baud_rates;
+      }
       break;
     case NMT_ISO14443B:
     case NMT_ISO14443BI:
@@ -3116,6 +3887,20 @@ pn53x_data_new(struct nfc_device *pnd, const struct pn53x_io *io)
   CHIP_DATA(pnd)->wb_trigged = false;
   memset(CHIP_DATA(pnd)->wb_mask, 0x00, PN53X_CACHE_REGISTER_SIZE);
 
+  // RFConfiguration, framing, speed and register states are unknown
+  pn53x_settings_cache_invalidate(pnd, PowerDown);
+
+  // ISO14443-4A targets stay at 106 kbps unless asked at selection
+  CHIP_DATA(pnd)->pps_nbr_max = NBR_106;
+  CHIP_DATA(pnd)->modwidth_changed = false;
+
+  // SetParameters value is unknown until pn53x_init() applies its default one
+  CHIP_DATA(pnd)->ui8Parameters = 0x00;
+
+  // Link is in sync
+  CHIP_DATA(pnd)->wedge_count = 0;
+  CHIP_DATA(pnd)->recovering = false;
+
   // Set default command timeout (350 ms)
   CHIP_DATA(pnd)->timeout_command = 350;
 
@@ -3124,6 +3909,7 @@ pn53x_data_new(struct nfc_device *pnd, const struct pn53x_io *io)
 
   // Set default communication timeout (52 ms)
   CHIP_DATA(pnd)->timeout_communication = 52;
+  pnd->iTimeoutCom = CHIP_DATA(pnd)->timeout_communication;
 
   CHIP_DATA(pnd)->supported_modulation_as_initiator = NULL;
 
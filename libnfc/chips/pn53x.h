@@ -54,6 +54,12 @@
 // RX_FRAMING follow same scheme than TX_FRAMING
 #  define SYMBOL_RX_FRAMING         0x03
 
+//   PN53X_REG_CIU_ModWidth: Miller pause width (in carrier periods) of ISO/IEC 14443A at each bit rate
+#  define PN53X_MODWIDTH_106        0x26
+#  define PN53X_MODWIDTH_212        0x15
+#  define PN53X_MODWIDTH_424        0x0a
+#  define PN53X_MODWIDTH_848        0x05
+
 //   PN53X_REG_CIU_TxAuto
 #  define SYMBOL_FORCE_100_ASK      0x40
 #  define SYMBOL_AUTO_WAKE_UP       0x20
@@ -114,6 +120,10 @@
 #  define RFCI_ANALOG_TYPE_B          0x0C      //  3
 #  define RFCI_ANALOG_TYPE_14443_4    0x0D      //  9
 
+// RFConfiguration cache: indexed by item, sized for the longest configuration data
+#  define PN53X_RFCI_CACHE_SIZE       (RFCI_ANALOG_TYPE_14443_4 + 1)
+#  define PN53X_RFCI_DATA_MAX_LEN     11
+
 /**
  * @enum pn53x_power_mode
  * @brief PN53x power mode enumeration
@@ -153,9 +163,14 @@ typedef enum {
 struct pn53x_io {
   int (*send)(struct nfc_device *pnd, const uint8_t *pbtData, const size_t szData, int timeout);
   int (*receive)(struct nfc_device *pnd, uint8_t *pbtData, const size_t szDataLen, int timeout);
+  /** Optional: bring the link back in sync with a wedged chip (ie. flush, abort running command, wake up) */
+  int (*resync)(struct nfc_device *pnd);
 };
 
 /* defines */
+// Consecutive transport failures (NFC_ETIMEOUT, NFC_EIO) after which the chip is considered wedged and recovered
+#define PN53X_WEDGE_THRESHOLD 2
+
 #define PN53X_CACHE_REGISTER_MIN_ADDRESS 	PN53X_REG_CIU_Mode
 #define PN53X_CACHE_REGISTER_MAX_ADDRESS 	PN53X_REG_CIU_Coll
 #define PN53X_CACHE_REGISTER_SIZE 		((PN53X_CACHE_REGISTER_MAX_ADDRESS - PN53X_CACHE_REGISTER_MIN_ADDRESS) + 1)
@@ -196,6 +211,24 @@ struct pn53x_data {
   uint8_t wb_data[PN53X_CACHE_REGISTER_SIZE];
   uint8_t wb_mask[PN53X_CACHE_REGISTER_SIZE];
   bool wb_trigged;
+  /** Known chip configuration: register values as they are (or will be once written back) in the chip */
+  uint8_t kn_data[PN53X_CACHE_REGISTER_SIZE];
+  uint8_t kn_mask[PN53X_CACHE_REGISTER_SIZE];
+  /** RFConfiguration cache: last applied configuration data of each item, a zero length means unknown */
+  uint8_t rfci_data[PN53X_RFCI_CACHE_SIZE][PN53X_RFCI_DATA_MAX_LEN];
+  uint8_t rfci_len[PN53X_RFCI_CACHE_SIZE];
+  /** Forced framing cache: last framing applied by NP_FORCE_ISO14443_A/B, 0 means unknown */
+  nfc_modulation_type forced_nmt;
+  /** Forced speed cache: true when NP_FORCE_SPEED_106 is known to be applied */
+  bool forced_speed_106;
+  /** Highest ISO14443-4A bit rate requested at selection, negotiated by PPS once the target is activated */
+  nfc_baud_rate pps_nbr_max;
+  /** Miller pause width has been shortened for a bit rate above 106 kbps */
+  bool modwidth_changed;
+  /** Consecutive transport failures (see PN53X_WEDGE_THRESHOLD) */
+  uint8_t wedge_count;
+  /** True while the supervisor recovers a wedged chip, nested failures are not supervised */
+  bool recovering;
   /** Command timeout */
   int timeout_command;
   /** ATR timeout */
@@ -318,11 +351,16 @@ int    pn532_initiator_init_secure_element(struct nfc_device *pnd);
 int    pn53x_initiator_select_passive_target(struct nfc_device *pnd,
                                              const nfc_modulation nm,
                                              const uint8_t *pbtInitData, const size_t szInitData,
-                                             nfc_target *pnt);
+                                             nfc_target *pnt, const int flags);
+int    pn53x_initiator_list_passive_targets(struct nfc_device *pnd,
+                                            const nfc_modulation nm,
+                                            const uint8_t *pbtInitData, const size_t szInitData,
+                                            nfc_target ant[], const size_t szTargets);
+int    pn53x_initiator_activate_iso14443_4(struct nfc_device *pnd, nfc_target *pnt);
 int    pn53x_initiator_poll_target(struct nfc_device *pnd,
                                    const nfc_modulation *pnmModulations, const size_t szModulations,
                                    const uint8_t uiPollNr, const uint8_t uiPeriod,
-                                   nfc_target *pnt);
+                                   nfc_target *pnt, const int flags);
 int    pn53x_initiator_select_dep_target(struct nfc_device *pnd,
                                          const nfc_dep_mode ndm, const nfc_baud_rate nbr,
                                          const nfc_dep_info *pndiInitiator,
@@ -377,6 +415,7 @@ int    pn53x_TgInitAsTarget(struct nfc_device *pnd, pn53x_target_mode ptm,
                             uint8_t *pbtRx, const size_t szRxLen, uint8_t *pbtModeByte, int timeout);
 
 // RFConfiguration
+int    pn53x_RFConfiguration(struct nfc_device *pnd, const uint8_t ui8Item, const uint8_t *pbtData, const size_t szData);
 int    pn53x_RFConfiguration__RF_field(struct nfc_device *pnd, bool bEnable);
 int    pn53x_RFConfiguration__Various_timings(struct nfc_device *pnd, const uint8_t fATR_RES_Timeout, const uint8_t fRetryTimeout);
 int    pn53x_RFConfiguration__MaxRtyCOM(struct nfc_device *pnd, const uint8_t MaxRtyCOM);
@@ -215,6 +215,7 @@ static int
 acr122_usb_bulk_read(struct acr122_usb_data *data, uint8_t abtRx[], const size_t szRx, const int timeout)
 {
   int res = usb_bulk_read(data->pudh, data->uiEndPointIn, (char *) abtRx, szRx, timeout);
+  NFC_PROBE3(usb_bulk_read__return, data->uiEndPointIn, szRx, res);
   if (res > 0) {
     LOG_HEX("RX", abtRx, res);
   } else if (res < 0) {
@@ -870,6 +871,8 @@ const struct nfc_driver acr122_usb_driver = {
   .initiator_init                   = pn53x_initiator_init,
   .initiator_init_secure_element    = NULL, // No secure-element support
   .initiator_select_passive_target  = pn53x_initiator_select_passive_target,
+  .initiator_list_passive_targets   = pn53x_initiator_list_passive_targets,
+  .initiator_activate_iso14443_4    = pn53x_initiator_activate_iso14443_4,
   .initiator_poll_target            = pn53x_initiator_poll_target,
   .initiator_select_dep_target      = pn53x_initiator_select_dep_target,
   .initiator_deselect_target        = pn53x_initiator_deselect_target,
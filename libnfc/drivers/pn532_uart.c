@@ -474,6 +474,24 @@ pn532_uart_ack(nfc_device *pnd)
   return (uart_send(DRIVER_DATA(pnd)->port, pn53x_ack_frame, sizeof(pn53x_ack_frame),  0));
 }
 
+static int
+pn532_uart_resync(nfc_device *pnd)
+{
+  int res = 0;
+  // Drop any partial frame, then abort whatever the chip may still be running
+  uart_flush_input(DRIVER_DATA(pnd)->port);
+  if ((res = pn532_uart_wakeup(pnd)) < 0) {
+    return res;
+  }
+  if ((res = pn532_uart_ack(pnd)) < 0) {
+    return res;
+  }
+  uart_flush_input(DRIVER_DATA(pnd)->port);
+  // Chip may have been reset in LowVBat mode: next command wakes it up and sends a SAMConfiguration
+  CHIP_DATA(pnd)->power_mode = LOWVBAT;
+  return NFC_SUCCESS;
+}
+
 static int
 pn532_uart_abort_command(nfc_device *pnd)
 {
@@ -491,6 +509,7 @@ pn532_uart_abort_command(nfc_device *pnd)
 const struct pn53x_io pn532_uart_io = {
   .send       = pn532_uart_send,
   .receive    = pn532_uart_receive,
+  .resync     = pn532_uart_resync,
 };
 
 const struct nfc_driver pn532_uart_driver = {
@@ -504,6 +523,8 @@ const struct nfc_driver pn532_uart_driver = {
   .initiator_init                   = pn53x_initiator_init,
   .initiator_init_secure_element    = pn532_initiator_init_secure_element,
   .initiator_select_passive_target  = pn53x_initiator_select_passive_target,
+  .initiator_list_passive_targets   = pn53x_initiator_list_passive_targets,
+  .initiator_activate_iso14443_4    = pn53x_initiator_activate_iso14443_4,
   .initiator_poll_target            = pn53x_initiator_poll_target,
   .initiator_select_dep_target      = pn53x_initiator_select_dep_target,
   .initiator_deselect_target        = pn53x_initiator_deselect_target,
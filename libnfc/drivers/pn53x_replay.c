@@ -0,0 +1,557 @@
+/*-
+ * Public platform independent Near Field Communication (NFC) library
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/**
+ * @file pn53x_replay.c
+ * @brief Driver replaying PN53x frames previously recorded
+ *
+ * Connection string is "pn53x_replay:FILE" or "pn53x_replay:FILE:realtime".
+ * FILE holds either a pcapng capture (see nfc_device_set_capture()) whose
+ * PN53x interface has every frame in full, nfc_frame_record structs, as
+ * returned by nfc_device_get_frame_records() (ie. saved with
+ * pn53x-frame-recorder -w), or a text trace with one frame per line:
+ *
+ *   # comment
+ *   TX 1000 02                          <- GetFirmwareVersion sent at 1000 us
+ *   RX 1850 32 01 06 07                 <- chip reply, without D5 and command code
+ *   TX 2000 4a 01 00
+ *   RX 7000 error -6                    <- libnfc's error code (ie. timeout)
+ *
+ * A "??" byte of a command matches any value, for bytes which are random
+ * (ie. NFCID3). A trailing "..." marks a truncated frame: frame records only
+ * keep the first bytes of each frame, so prefer captures to replay long
+ * replies. Replay starts at the first
+ * GetFirmwareVersion command, sent by pn53x_init(): every command the library
+ * sends is checked to be byte-identical to the recorded one, and recorded
+ * replies are returned. With "realtime", each reply is delayed to reproduce the
+ * recorded round-trip latency, so host overhead can be measured on its own.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include "pn53x_replay.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef WIN32
+#  include <windows.h>
+#endif
+
+#include <nfc/nfc.h>
+
+#include "drivers.h"
+#include "nfc-internal.h"
+#include "capture.h"
+#include "chips/pn53x.h"
+#include "chips/pn53x-internal.h"
+
+#define PN53X_REPLAY_DRIVER_NAME "pn53x_replay"
+#define LOG_CATEGORY "libnfc.driver.pn53x_replay"
+
+// Internal data structs
+const struct pn53x_io pn53x_replay_io;
+
+struct pn53x_replay_frame {
+  int64_t i64Timestamp;
+  nfc_frame_direction nfd;
+  int iResult;
+  // Only the first szData bytes of the frame have been recorded
+  bool bTruncated;
+  size_t szData;
+  uint8_t abtData[PN53x_EXTENDED_FRAME__DATA_MAX_LEN];
+  // Bytes of a command which are not checked (one bit per byte), ie. random ones
+  uint8_t abtAny[(PN53x_EXTENDED_FRAME__DATA_MAX_LEN + 7) / 8];
+};
+
+struct pn53x_replay_data {
+  struct pn53x_replay_frame *frames;
+  size_t szFrames;
+  size_t szNext;
+  bool bRealtime;
+  // Host and recorded time of the last command, to reproduce round-trip latencies
+  int64_t i64SentAt;
+  int64_t i64RecordedSentAt;
+};
+
+#define DRIVER_DATA(pnd) ((struct pn53x_replay_data*)(pnd->driver_data))
+
+static void
+pn53x_replay_sleep_us(const int64_t i64Delay)
+{
+#ifndef WIN32
+  struct timespec ts = { .tv_sec = i64Delay / 1000000, .tv_nsec = (i64Delay % 1000000) * 1000 };
+  nanosleep(&ts, NULL);
+#else
+  Sleep(i64Delay / 1000);
+#endif
+}
+
+static int
+pn53x_replay_parse_line(const char *pcLine, struct pn53x_replay_frame *pf)
+{
+  char acDirection[3];
+  long long llTimestamp;
+  int n;
+
+  if (sscanf(pcLine, "%2s %lld%n", acDirection, &llTimestamp, &n) != 2)
+    return -1;
+  if (0 == strcmp(acDirection, "TX")) {
+    pf->nfd = NFD_TX;
+  } else if (0 == strcmp(acDirection, "RX")) {
+    pf->nfd = NFD_RX;
+  } else {
+    return -1;
+  }
+  pcLine += n;
+  pf->i64Timestamp = llTimestamp;
+  pf->bTruncated = false;
+  pf->szData = 0;
+  memset(pf->abtAny, 0x00, sizeof(pf->abtAny));
+
+  if (sscanf(pcLine, " error %d", &pf->iResult) == 1)
+    return 0;
+
+  unsigned int uiByte;
+  for (;;) {
+    pcLine += strspn(pcLine, " \t");
+    const bool bAny = (0 == strncmp(pcLine, "??", 2));
+    if (bAny) {
+      uiByte = 0x00;
+      n = 2;
+    } else if (sscanf(pcLine, "%2x%n", &uiByte, &n) != 1) {
+      break;
+    }
+    if (pf->szData == sizeof(pf->abtData))
+      return -1;
+    if (bAny)
+      pf->abtAny[pf->szData / 8] |= 1 << (pf->szData % 8);
+    pf->abtData[pf->szData++] = uiByte;
+    pcLine += n;
+  }
+  pcLine += strspn(pcLine, " \t\r");
+  if (0 == strncmp(pcLine, "...", 3)) {
+    pf->bTruncated = true;
+    pcLine += 3 + strspn(pcLine + 3, " \t\r");
+  }
+  if (*pcLine != '\0')
+    return -1;
+  pf->iResult = (pf->nfd == NFD_RX) ? (int) pf->szData : 0;
+  return 0;
+}
+
+static int
+pn53x_replay_add_frame(struct pn53x_replay_data *data, size_t *pszAllocated, struct pn53x_replay_frame **ppf)
+{
+  if (data->szFrames == *pszAllocated) {
+    const size_t szAllocated = *pszAllocated ? *pszAllocated * 2 : 64;
+    struct pn53x_replay_frame *frames = realloc(data->frames, szAllocated * sizeof(*frames));
+    if (!frames)
+      return NFC_ESOFT;
+    data->frames = frames;
+    *pszAllocated = szAllocated;
+  }
+  *ppf = &data->frames[data->szFrames];
+  return NFC_SUCCESS;
+}
+
+static uint32_t
+pcapng_get_u32(const uint8_t *pbt)
+{
+  uint32_t ui32;
+  memcpy(&ui32, pbt, sizeof(ui32));
+  return ui32;
+}
+
+static uint16_t
+pcapng_get_u16(const uint8_t *pbt)
+{
+  uint16_t ui16;
+  memcpy(&ui16, pbt, sizeof(ui16));
+  return ui16;
+}
+
+// Keep frames of the PN53x (LINKTYPE_USER0) interface of a pcapng capture written by this library
+static int
+pn53x_replay_load_pcapng(struct pn53x_replay_data *data, const uint8_t *pbtBuffer, const size_t szBuffer, const char *pcFilename)
+{
+  // Link type and timestamp units per second of each interface, in their order of description
+  uint16_t aui16LinkType[8];
+  uint64_t aui64TsUnits[8];
+  size_t szInterfaces = 0;
+  size_t szAllocated = 0;
+  size_t szOffset = 0;
+  (void) pcFilename;
+
+  while (szOffset + 12 <= szBuffer) {
+    const uint8_t *pbtBlock = pbtBuffer + szOffset;
+    const uint32_t ui32Type = pcapng_get_u32(pbtBlock);
+    const uint32_t ui32Len = pcapng_get_u32(pbtBlock + 4);
+    if ((ui32Len < 12) || (ui32Len % 4) || (ui32Len > szBuffer - szOffset)) {
+      log_put(LOG_CATEGORY, NFC_PRIORITY_ERROR, "\"%s\": invalid pcapng block at offset %lu", pcFilename, (unsigned long) szOffset);
+      return NFC_EINVARG;
+    }
+    // Options start after the block fixed part, the last 4 bytes repeat its length
+    size_t szOptions = ui32Len - 4;
+    const uint8_t *pbtOptions = NULL;
+    const char *pcComment = NULL;
+    uint16_t ui16CommentLen = 0;
+    uint32_t ui32Flags = 0;
+    uint8_t ui8TsResol = 6;
+
+    switch (ui32Type) {
+      case PCAPNG_SHB:
+        if ((ui32Len < 28) || (pcapng_get_u32(pbtBlock + 8) != PCAPNG_BYTE_ORDER_MAGIC)) {
+          log_put(LOG_CATEGORY, NFC_PRIORITY_ERROR, "\"%s\": unsupported pcapng section (byte order)", pcFilename);
+          return NFC_EINVARG;
+        }
+        // Interfaces are described again by each section
+        szInterfaces = 0;
+        break;
+      case PCAPNG_IDB:
+        if ((ui32Len < 20) || (szInterfaces == sizeof(aui16LinkType) / sizeof(aui16LinkType[0]))) {
+          log_put(LOG_CATEGORY, NFC_PRIORITY_ERROR, "\"%s\": unsupported pcapng interface", pcFilename);
+          return NFC_EINVARG;
+        }
+        pbtOptions = pbtBlock + 16;
+        break;
+      case PCAPNG_EPB:
+        if ((ui32Len < 32) || (pcapng_get_u32(pbtBlock + 20) > ui32Len - 32)) {
+          log_put(LOG_CATEGORY, NFC_PRIORITY_ERROR, "\"%s\": invalid pcapng packet at offset %lu", pcFilename, (unsigned long) szOffset);
+          return NFC_EINVARG;
+        }
+        pbtOptions = pbtBlock + 28 + PCAPNG_PAD(pcapng_get_u32(pbtBlock + 20));
+        break;
+      default:
+        // Other blocks are not produced by libnfc's captures
+        break;
+    }
+
+    while (pbtOptions && (pbtOptions + 4 <= pbtBlock + szOptions)) {
+      const uint16_t ui16Code = pcapng_get_u16(pbtOptions);
+      const uint16_t ui16Len = pcapng_get_u16(pbtOptions + 2);
+      if ((ui16Code == PCAPNG_OPT_ENDOFOPT) || (pbtOptions + 4 + ui16Len > pbtBlock + szOptions))
+        break;
+      if ((ui32Type == PCAPNG_IDB) && (ui16Code == PCAPNG_OPT_IF_TSRESOL) && (ui16Len == 1))
+        ui8TsResol = pbtOptions[4];
+      if ((ui32Type == PCAPNG_EPB) && (ui16Code == PCAPNG_OPT_EPB_FLAGS) && (ui16Len == 4))
+        ui32Flags = pcapng_get_u32(pbtOptions + 4);
+      if ((ui32Type == PCAPNG_EPB) && (ui16Code == PCAPNG_OPT_COMMENT)) {
+        pcComment = (const char *) pbtOptions + 4;
+        ui16CommentLen = ui16Len;
+      }
+      pbtOptions += 4 + PCAPNG_PAD(ui16Len);
+    }
+
+    if (ui32Type == PCAPNG_IDB) {
+      // Timestamp resolution is a power of 10 (or of 2 when MSB is set) of seconds
+      uint64_t ui64Units = 1;
+      for (int n = 0; n < (ui8TsResol & 0x7f) && (n < 63); n++)
+        ui64Units *= (ui8TsResol & 0x80) ? 2 : 10;
+      aui16LinkType[szInterfaces] = pcapng_get_u16(pbtBlock + 8);
+      aui64TsUnits[szInterfaces++] = ui64Units;
+    } else if (ui32Type == PCAPNG_EPB) {
+      const uint32_t ui32Interface = pcapng_get_u32(pbtBlock + 8);
+      const uint32_t ui32CapLen = pcapng_get_u32(pbtBlock + 20);
+      const uint32_t ui32OrigLen = pcapng_get_u32(pbtBlock + 24);
+      if ((ui32Interface < szInterfaces) && (aui16LinkType[ui32Interface] == LINKTYPE_USER0)) {
+        struct pn53x_replay_frame *pf;
+        if (pn53x_replay_add_frame(data, &szAllocated, &pf) < 0)
+          return NFC_ESOFT;
+        const uint64_t ui64Timestamp = ((uint64_t) pcapng_get_u32(pbtBlock + 12) << 32) | pcapng_get_u32(pbtBlock + 16);
+        const uint64_t ui64Units = aui64TsUnits[ui32Interface];
+        pf->i64Timestamp = (ui64Units >= 1000000) ? (int64_t)(ui64Timestamp / (ui64Units / 1000000)) : (int64_t)(ui64Timestamp * (1000000 / ui64Units));
+        pf->nfd = (ui32Flags & PCAPNG_EPB_FLAGS_OUTBOUND) ? NFD_TX : NFD_RX;
+        pf->szData = (ui32CapLen < sizeof(pf->abtData)) ? ui32CapLen : sizeof(pf->abtData);
+        pf->bTruncated = (pf->szData < ui32OrigLen);
+        memcpy(pf->abtData, pbtBlock + 28, pf->szData);
+        memset(pf->abtAny, 0x00, sizeof(pf->abtAny));
+        pf->iResult = (pf->nfd == NFD_RX) ? (int) pf->szData : 0;
+        // Failed transfers are commented with libnfc's error code
+        const size_t szErrorPrefix = strlen(PCAPNG_COMMENT_ERROR);
+        if (pcComment && (ui16CommentLen > szErrorPrefix) && (ui16CommentLen < 16) && !memcmp(pcComment, PCAPNG_COMMENT_ERROR, szErrorPrefix)) {
+          char acError[16];
+          memcpy(acError, pcComment + szErrorPrefix, ui16CommentLen - szErrorPrefix);
+          acError[ui16CommentLen - szErrorPrefix] = '\0';
+          pf->iResult = atoi(acError);
+        }
+        data->szFrames++;
+      }
+    }
+    szOffset += ui32Len;
+  }
+  return NFC_SUCCESS;
+}
+
+static int
+pn53x_replay_load(struct pn53x_replay_data *data, const char *pcFilename)
+{
+  FILE *fp = fopen(pcFilename, "rb");
+  if (!fp) {
+    log_put(LOG_CATEGORY, NFC_PRIORITY_ERROR, "Unable to open trace \"%s\"", pcFilename);
+    return NFC_EINVARG;
+  }
+  fseek(fp, 0, SEEK_END);
+  long lSize = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  char *pcBuffer = malloc(lSize + 1);
+  if (!pcBuffer || (lSize < 0) || (fread(pcBuffer, 1, lSize, fp) != (size_t) lSize)) {
+    free(pcBuffer);
+    fclose(fp);
+    return NFC_ESOFT;
+  }
+  fclose(fp);
+  pcBuffer[lSize] = '\0';
+
+  int res = NFC_SUCCESS;
+  size_t szAllocated = 0;
+  data->frames = NULL;
+  data->szFrames = 0;
+  if ((lSize >= 4) && (pcapng_get_u32((const uint8_t *) pcBuffer) == PCAPNG_SHB)) {
+    // pcapng capture
+    res = pn53x_replay_load_pcapng(data, (const uint8_t *) pcBuffer, lSize, pcFilename);
+  } else if (memchr(pcBuffer, '\0', lSize)) {
+    // Binary nfc_frame_record dump
+    if (lSize % sizeof(nfc_frame_record)) {
+      log_put(LOG_CATEGORY, NFC_PRIORITY_ERROR, "\"%s\" is neither a capture, a frame records dump nor a text trace", pcFilename);
+      res = NFC_EINVARG;
+    } else if ((szAllocated = lSize / sizeof(nfc_frame_record)) && !(data->frames = malloc(szAllocated * sizeof(*data->frames)))) {
+      res = NFC_ESOFT;
+    }
+    for (size_t n = 0; (res == NFC_SUCCESS) && (n < szAllocated); n++) {
+      nfc_frame_record nfr;
+      memcpy(&nfr, pcBuffer + (n * sizeof(nfr)), sizeof(nfr));
+      struct pn53x_replay_frame *pf = &data->frames[data->szFrames++];
+      pf->i64Timestamp = nfr.i64Timestamp;
+      pf->nfd = nfr.nfd;
+      pf->iResult = nfr.iResult;
+      pf->bTruncated = (nfr.szData > NFC_FRAME_RECORD_DATA_LEN);
+      pf->szData = pf->bTruncated ? NFC_FRAME_RECORD_DATA_LEN : nfr.szData;
+      memcpy(pf->abtData, nfr.abtData, pf->szData);
+      memset(pf->abtAny, 0x00, sizeof(pf->abtAny));
+    }
+  } else {
+    // Text trace
+    size_t szLine = 0;
+    for (char *pcLine = pcBuffer; (res == NFC_SUCCESS) && pcLine; szLine++) {
+      char *pcEnd = strchr(pcLine, '\n');
+      if (pcEnd)
+        *pcEnd++ = '\0';
+      pcLine += strspn(pcLine, " \t\r");
+      if ((*pcLine != '\0') && (*pcLine != '#')) {
+        struct pn53x_replay_frame *pf;
+        if ((res = pn53x_replay_add_frame(data, &szAllocated, &pf)) < 0)
+          break;
+        if (pn53x_replay_parse_line(pcLine, pf) < 0) {
+          log_put(LOG_CATEGORY, NFC_PRIORITY_ERROR, "%s:%lu: Invalid trace line", pcFilename, (unsigned long)(szLine + 1));
+          res = NFC_EINVARG;
+        } else {
+          data->szFrames++;
+        }
+      }
+      pcLine = pcEnd;
+    }
+  }
+  free(pcBuffer);
+
+  // Skip frames sent by the recording driver before pn53x_init()
+  data->szNext = 0;
+  while ((data->szNext < data->szFrames) &&
+         !((data->frames[data->szNext].nfd == NFD_TX) && data->frames[data->szNext].szData && (data->frames[data->szNext].abtData[0] == GetFirmwareVersion)))
+    data->szNext++;
+  if ((res == NFC_SUCCESS) && (data->szNext == data->szFrames)) {
+    log_put(LOG_CATEGORY, NFC_PRIORITY_ERROR, "No GetFirmwareVersion command in \"%s\"", pcFilename);
+    res = NFC_EINVARG;
+  }
+  if (res < 0) {
+    free(data->frames);
+    data->frames = NULL;
+  }
+  return res;
+}
+
+static void
+pn53x_replay_close(nfc_device *pnd)
+{
+  free(DRIVER_DATA(pnd)->frames);
+  pn53x_data_free(pnd);
+  nfc_device_free(pnd);
+}
+
+static nfc_device *
+pn53x_replay_open(const nfc_connstring connstring)
+{
+  const size_t szPrefix = strlen(PN53X_REPLAY_DRIVER_NAME ":");
+  if ((0 != strncmp(connstring, PN53X_REPLAY_DRIVER_NAME ":", szPrefix)) || (connstring[szPrefix] == '\0'))
+    return NULL;
+
+  char acFilename[sizeof(nfc_connstring)];
+  strncpy(acFilename, connstring + szPrefix, sizeof(acFilename) - 1);
+  acFilename[sizeof(acFilename) - 1] = '\0';
+  bool bRealtime = false;
+  char *pcOption = strrchr(acFilename, ':');
+  if (pcOption && (0 == strcmp(pcOption, ":realtime"))) {
+    *pcOption = '\0';
+    bRealtime = true;
+  }
+
+  nfc_device *pnd = nfc_device_new(connstring);
+  snprintf(pnd->name, sizeof(pnd->name), "%s:%.*s", PN53X_REPLAY_DRIVER_NAME, (int)(sizeof(pnd->name) - szPrefix - 1), acFilename);
+  pnd->driver_data = malloc(sizeof(struct pn53x_replay_data));
+  DRIVER_DATA(pnd)->bRealtime = bRealtime;
+  DRIVER_DATA(pnd)->i64SentAt = 0;
+  DRIVER_DATA(pnd)->i64RecordedSentAt = 0;
+  if (pn53x_replay_load(DRIVER_DATA(pnd), acFilename) < 0) {
+    nfc_device_free(pnd);
+    return NULL;
+  }
+  log_put(LOG_CATEGORY, NFC_PRIORITY_TRACE, "%lu frames loaded from \"%s\"", (unsigned long) DRIVER_DATA(pnd)->szFrames, acFilename);
+
+  // Alloc and init chip's data
+  pn53x_data_new(pnd, &pn53x_replay_io);
+  pnd->driver = &pn53x_replay_driver;
+
+  if (pn53x_init(pnd) < 0) {
+    pn53x_replay_close(pnd);
+    return NULL;
+  }
+  return pnd;
+}
+
+static int
+pn53x_replay_send(nfc_device *pnd, const uint8_t *pbtData, const size_t szData, int timeout)
+{
+  (void) timeout;
+  struct pn53x_replay_data *data = DRIVER_DATA(pnd);
+
+  if ((data->szNext == data->szFrames) || (data->frames[data->szNext].nfd != NFD_TX)) {
+    log_put(LOG_CATEGORY, NFC_PRIORITY_ERROR, "Unexpected command (frame #%lu)", (unsigned long) data->szNext);
+    LOG_HEX("TX", pbtData, szData);
+    pnd->last_error = NFC_EIO;
+    return pnd->last_error;
+  }
+  const struct pn53x_replay_frame *pf = &data->frames[data->szNext];
+  bool bMismatch = pf->bTruncated ? (szData < pf->szData) : (szData != pf->szData);
+  for (size_t n = 0; (n < pf->szData) && !bMismatch; n++)
+    bMismatch = !(pf->abtAny[n / 8] & (1 << (n % 8))) && (pbtData[n] != pf->abtData[n]);
+  if (bMismatch) {
+    log_put(LOG_CATEGORY, NFC_PRIORITY_ERROR, "Command mismatch (frame #%lu)", (unsigned long) data->szNext);
+    LOG_HEX("Recorded", pf->abtData, pf->szData);
+    LOG_HEX("TX", pbtData, szData);
+    pnd->last_error = NFC_EIO;
+    return pnd->last_error;
+  }
+  data->szNext++;
+  data->i64SentAt = monotonic_time_us();
+  data->i64RecordedSentAt = pf->i64Timestamp;
+
+  if (pf->iResult < 0) {
+    pnd->last_error = pf->iResult;
+    return pnd->last_error;
+  }
+  return NFC_SUCCESS;
+}
+
+static int
+pn53x_replay_receive(nfc_device *pnd, uint8_t *pbtData, const size_t szDataLen, int timeout)
+{
+  (void) timeout;
+  struct pn53x_replay_data *data = DRIVER_DATA(pnd);
+
+  if ((data->szNext == data->szFrames) || (data->frames[data->szNext].nfd != NFD_RX)) {
+    log_put(LOG_CATEGORY, NFC_PRIORITY_ERROR, "No recorded reply (frame #%lu)", (unsigned long) data->szNext);
+    pnd->last_error = NFC_EIO;
+    return pnd->last_error;
+  }
+  const struct pn53x_replay_frame *pf = &data->frames[data->szNext++];
+
+  if (data->bRealtime) {
+    const int64_t i64Delay = (data->i64SentAt + (pf->i64Timestamp - data->i64RecordedSentAt)) - monotonic_time_us();
+    if (i64Delay > 0)
+      pn53x_replay_sleep_us(i64Delay);
+  }
+
+  if (pf->iResult < 0) {
+    pnd->last_error = pf->iResult;
+    return pnd->last_error;
+  }
+  if (pf->bTruncated) {
+    log_put(LOG_CATEGORY, NFC_PRIORITY_ERROR, "Recorded reply is truncated (frame #%lu)", (unsigned long)(data->szNext - 1));
+    pnd->last_error = NFC_EIO;
+    return pnd->last_error;
+  }
+  if (pf->szData > szDataLen) {
+    log_put(LOG_CATEGORY, NFC_PRIORITY_ERROR, "Unable to receive data: buffer too small. (szDataLen: %zu, len: %zu)", szDataLen, pf->szData);
+    pnd->last_error = NFC_EOVFLOW;
+    return pnd->last_error;
+  }
+  memcpy(pbtData, pf->abtData, pf->szData);
+  return pf->szData;
+}
+
+static int
+pn53x_replay_abort_command(nfc_device *pnd)
+{
+  (void) pnd;
+  return NFC_SUCCESS;
+}
+
+const struct pn53x_io pn53x_replay_io = {
+  .send       = pn53x_replay_send,
+  .receive    = pn53x_replay_receive,
+};
+
+const struct nfc_driver pn53x_replay_driver = {
+  .name                             = PN53X_REPLAY_DRIVER_NAME,
+  .scan_type                        = NOT_AVAILABLE,
+  .scan                             = NULL,
+  .open                             = pn53x_replay_open,
+  .close                            = pn53x_replay_close,
+  .strerror                         = pn53x_strerror,
+
+  .initiator_init                   = pn53x_initiator_init,
+  .initiator_init_secure_element    = pn532_initiator_init_secure_element,
+  .initiator_select_passive_target  = pn53x_initiator_select_passive_target,
+  .initiator_list_passive_targets   = pn53x_initiator_list_passive_targets,
+  .initiator_activate_iso14443_4    = pn53x_initiator_activate_iso14443_4,
+  .initiator_poll_target            = pn53x_initiator_poll_target,
+  .initiator_select_dep_target      = pn53x_initiator_select_dep_target,
+  .initiator_deselect_target        = pn53x_initiator_deselect_target,
+  .initiator_transceive_bytes       = pn53x_initiator_transceive_bytes,
+  .initiator_transceive_bits        = pn53x_initiator_transceive_bits,
+  .initiator_transceive_bytes_timed = pn53x_initiator_transceive_bytes_timed,
+  .initiator_transceive_bits_timed  = pn53x_initiator_transceive_bits_timed,
+  .initiator_target_is_present      = pn53x_initiator_target_is_present,
+
+  .target_init           = pn53x_target_init,
+  .target_send_bytes     = pn53x_target_send_bytes,
+  .target_receive_bytes  = pn53x_target_receive_bytes,
+  .target_send_bits      = pn53x_target_send_bits,
+  .target_receive_bits   = pn53x_target_receive_bits,
+
+  .device_set_property_bool     = pn53x_set_property_bool,
+  .device_set_property_int      = pn53x_set_property_int,
+  .get_supported_modulation     = pn53x_get_supported_modulation,
+  .get_supported_baud_rate      = pn53x_get_supported_baud_rate,
+  .device_get_information_about = pn53x_get_information_about,
+
+  .abort_command  = pn53x_replay_abort_command,
+  .idle  = pn53x_idle,
+};
@@ -0,0 +1,30 @@
+/*-
+ * Public platform independent Near Field Communication (NFC) library
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/**
+ * @file pn53x_replay.h
+ * @brief Driver replaying PN53x frames previously recorded
+ */
+
+#ifndef __NFC_DRIVER_PN53X_REPLAY_H__
+#define __NFC_DRIVER_PN53X_REPLAY_H__
+
+#include <nfc/nfc-types.h>
+
+extern const struct nfc_driver pn53x_replay_driver;
+
+#endif // ! __NFC_DRIVER_PN53X_REPLAY_H__
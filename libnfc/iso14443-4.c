@@ -0,0 +1,307 @@
+/*-
+ * Public platform independent Near Field Communication (NFC) library
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/**
+* @file iso14443-4.c
+* @brief Host side ISO/IEC 14443-4 (T=CL) half-duplex block transmission protocol
+*/
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <string.h>
+
+#include <nfc/nfc.h>
+#include "nfc-internal.h"
+
+/*
+ * Blocks are exchanged in raw mode (NP_EASY_FRAMING disabled), CRC_A being
+ * handled by the device. Neither CID nor NAD are sent: a target supporting CID
+ * answers blocks without CID when it has been activated with CID 0. Block
+ * numbers are only tracked here, so the firmware's own ISO14443-4 layer
+ * (NP_EASY_FRAMING) must not exchange blocks with the same target meanwhile.
+ */
+
+// Protocol Control Byte
+#define ISO14443_4_PCB_I             0x02
+#define ISO14443_4_PCB_R_ACK         0xa2
+#define ISO14443_4_PCB_R_NAK         0xb2
+#define ISO14443_4_PCB_S_DESELECT    0xc2
+#define ISO14443_4_PCB_S_WTX         0xf2
+#define ISO14443_4_PCB_BLOCK_NUMBER  0x01
+#define ISO14443_4_PCB_NAD           0x04
+#define ISO14443_4_PCB_CID           0x08
+#define ISO14443_4_PCB_CHAINING      0x10
+
+#define ISO14443_4_IS_I_BLOCK(pcb)   (((pcb) & 0xe2) == ISO14443_4_PCB_I)
+#define ISO14443_4_IS_R_ACK(pcb)     (((pcb) & 0xf6) == ISO14443_4_PCB_R_ACK)
+#define ISO14443_4_IS_S_WTX(pcb)     (((pcb) & 0xf7) == ISO14443_4_PCB_S_WTX)
+#define ISO14443_4_IS_S_DESELECT(pcb) (((pcb) & 0xf7) == ISO14443_4_PCB_S_DESELECT)
+
+// Largest frame (FSD, CRC included) the host accepts, also the largest frame sent whatever FSC is
+#define ISO14443_4_FSD 256
+// Retransmissions of a block after a transmission error or a timeout
+#define ISO14443_4_MAX_RETRIES 2
+// Extra time (ms) given to the device on top of the frame waiting time
+#define ISO14443_4_DEVICE_TIMEOUT_MARGIN 100
+
+// FSCI to FSC (frame size for proximity card), larger values are RFU
+static const size_t iso14443_4_fsc[] = { 16, 24, 32, 40, 48, 64, 96, 128, 256 };
+
+void
+iso14443_4_session_start(nfc_device *pnd, const nfc_target *pnt, const bool bHostActivated)
+{
+  struct iso14443_4_session *pts = &pnd->tcl;
+
+  memset(pts, 0x00, sizeof(*pts));
+  if ((pnt->nm.nmt != NMT_ISO14443A) || (pnt->nti.nai.szAtsLen == 0))
+    return;
+
+  // ATS (without TL): T0, optional TA(1), TB(1), TC(1), then historical bytes
+  const uint8_t *pbtAts = pnt->nti.nai.abtAts;
+  const uint8_t btT0 = pbtAts[0];
+  uint8_t ui8Fsci = btT0 & 0x0f;
+  uint8_t ui8Fwi = 4;
+  size_t szOffset = 1;
+  if (btT0 & 0x10)
+    szOffset++;
+  if ((btT0 & 0x20) && (szOffset < pnt->nti.nai.szAtsLen))
+    ui8Fwi = pbtAts[szOffset] >> 4;
+  // Values 15 (FWI) and above 8 (FSCI) are RFU, fall back to defaults
+  if (ui8Fwi > 14)
+    ui8Fwi = 4;
+  if (ui8Fsci >= sizeof(iso14443_4_fsc) / sizeof(iso14443_4_fsc[0]))
+    ui8Fsci = 8;
+
+  pts->bActive = true;
+  pts->bHostActivated = bHostActivated;
+  pts->ui8BlockNumber = 0;
+  pts->szFsc = iso14443_4_fsc[ui8Fsci];
+  // FWT = (256 * 16 / fc) * 2^FWI, about 302 us * 2^FWI
+  pts->iFwt = (int)(((302UL << ui8Fwi) + 999) / 1000);
+}
+
+void
+iso14443_4_session_stop(nfc_device *pnd)
+{
+  memset(&pnd->tcl, 0x00, sizeof(pnd->tcl));
+}
+
+// Send a frame and wait for the answer during the frame waiting time, extended by WTXM
+static int
+iso14443_4_exchange_frame(nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx, uint8_t *pbtRx, const size_t szRx, const int iWtxm)
+{
+  const int iFwt = pnd->tcl.iFwt * iWtxm;
+  int res;
+
+  if ((pnd->iTimeoutCom != iFwt) && ((res = nfc_device_set_property_int(pnd, NP_TIMEOUT_COM, iFwt)) < 0))
+    return res;
+  return nfc_initiator_transceive_bytes(pnd, pbtTx, szTx, pbtRx, szRx, iFwt + ISO14443_4_DEVICE_TIMEOUT_MARGIN);
+}
+
+// Send a block and return the target's answer: S(WTX) requests and error recovery are handled here
+static int
+iso14443_4_exchange_block(nfc_device *pnd, const uint8_t *pbtBlock, const size_t szBlock, uint8_t *pbtRx, const size_t szRx)
+{
+  const bool bIBlock = ISO14443_4_IS_I_BLOCK(pbtBlock[0]);
+  const uint8_t ui8BlockNumber = pbtBlock[0] & ISO14443_4_PCB_BLOCK_NUMBER;
+  const uint8_t *pbtSend = pbtBlock;
+  size_t szSend = szBlock;
+  uint8_t abtControl[2];
+  int iWtxm = 1;
+  int iRetries = 0;
+  int res;
+
+  for (;;) {
+    res = iso14443_4_exchange_frame(pnd, pbtSend, szSend, pbtRx, szRx, iWtxm);
+    iWtxm = 1;
+    if ((res == NFC_ERFTRANS) || (res == NFC_ETIMEOUT) || (res == 0)) {
+      // Transmission error or timeout: ask the target where it stands after an I-block, otherwise send the block again
+      if (++iRetries > ISO14443_4_MAX_RETRIES)
+        return (res == 0) ? NFC_ERFTRANS : res;
+      if (bIBlock) {
+        abtControl[0] = ISO14443_4_PCB_R_NAK | ui8BlockNumber;
+        pbtSend = abtControl;
+        szSend = 1;
+      } else {
+        pbtSend = pbtBlock;
+        szSend = szBlock;
+      }
+      continue;
+    }
+    if (res < 0)
+      return res;
+
+    if (ISO14443_4_IS_S_WTX(pbtRx[0]) && (res >= 2)) {
+      // Target needs more time: acknowledge with the same WTXM and wait FWT * WTXM
+      iWtxm = pbtRx[res - 1] & 0x3f;
+      if ((iWtxm == 0) || (iWtxm > 59)) {
+        pnd->last_error = NFC_ERFTRANS;
+        return pnd->last_error;
+      }
+      abtControl[0] = ISO14443_4_PCB_S_WTX;
+      abtControl[1] = (uint8_t) iWtxm;
+      pbtSend = abtControl;
+      szSend = 2;
+      continue;
+    }
+    if (bIBlock && ISO14443_4_IS_R_ACK(pbtRx[0]) && ((pbtRx[0] & ISO14443_4_PCB_BLOCK_NUMBER) != ui8BlockNumber)) {
+      // Target acknowledges its previous block: our I-block has been lost, send it again
+      if (++iRetries > ISO14443_4_MAX_RETRIES) {
+        pnd->last_error = NFC_ERFTRANS;
+        return pnd->last_error;
+      }
+      pbtSend = pbtBlock;
+      szSend = szBlock;
+      continue;
+    }
+    return res;
+  }
+}
+
+static int
+iso14443_4_transceive_blocks(nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx, uint8_t *pbtRx, const size_t szRx)
+{
+  struct iso14443_4_session *pts = &pnd->tcl;
+  uint8_t abtBlock[ISO14443_4_FSD];
+  uint8_t abtRes[ISO14443_4_FSD];
+  // PCB and CRC_A take 3 bytes of each frame
+  const size_t szInfMax = MIN(pts->szFsc, sizeof(abtBlock)) - 3;
+  size_t szSent = 0;
+  size_t szReceived = 0;
+  int res;
+
+  // Command is chained in several I-blocks when it does not fit in FSC
+  for (;;) {
+    const size_t szInf = MIN(szTx - szSent, szInfMax);
+    const bool bChaining = (szSent + szInf) < szTx;
+    abtBlock[0] = ISO14443_4_PCB_I | pts->ui8BlockNumber | (bChaining ? ISO14443_4_PCB_CHAINING : 0);
+    memcpy(abtBlock + 1, pbtTx + szSent, szInf);
+    if ((res = iso14443_4_exchange_block(pnd, abtBlock, 1 + szInf, abtRes, sizeof(abtRes))) < 0)
+      return res;
+    if (!bChaining)
+      break;
+    // Each chained block is acknowledged by R(ACK) with the same block number
+    if (!ISO14443_4_IS_R_ACK(abtRes[0]) || ((abtRes[0] & ISO14443_4_PCB_BLOCK_NUMBER) != pts->ui8BlockNumber)) {
+      pnd->last_error = NFC_ERFTRANS;
+      return pnd->last_error;
+    }
+    pts->ui8BlockNumber ^= ISO14443_4_PCB_BLOCK_NUMBER;
+    szSent += szInf;
+  }
+
+  // Response may be chained too, each block is acknowledged by R(ACK)
+  for (;;) {
+    if (!ISO14443_4_IS_I_BLOCK(abtRes[0]) || ((abtRes[0] & ISO14443_4_PCB_BLOCK_NUMBER) != pts->ui8BlockNumber)) {
+      pnd->last_error = NFC_ERFTRANS;
+      return pnd->last_error;
+    }
+    pts->ui8BlockNumber ^= ISO14443_4_PCB_BLOCK_NUMBER;
+    size_t szOffset = 1;
+    if (abtRes[0] & ISO14443_4_PCB_CID)
+      szOffset++;
+    if (abtRes[0] & ISO14443_4_PCB_NAD)
+      szOffset++;
+    if ((size_t) res < szOffset) {
+      pnd->last_error = NFC_ERFTRANS;
+      return pnd->last_error;
+    }
+    const size_t szInf = (size_t) res - szOffset;
+    if (szReceived + szInf > szRx) {
+      pnd->last_error = NFC_EOVFLOW;
+      return pnd->last_error;
+    }
+    memcpy(pbtRx + szReceived, abtRes + szOffset, szInf);
+    szReceived += szInf;
+    if (!(abtRes[0] & ISO14443_4_PCB_CHAINING))
+      break;
+    abtBlock[0] = ISO14443_4_PCB_R_ACK | pts->ui8BlockNumber;
+    if ((res = iso14443_4_exchange_block(pnd, abtBlock, 1, abtRes, sizeof(abtRes))) < 0)
+      return res;
+  }
+  return (int) szReceived;
+}
+
+static int
+iso14443_4_deselect_block(nfc_device *pnd)
+{
+  const uint8_t abtDeselect[] = { ISO14443_4_PCB_S_DESELECT };
+  uint8_t abtRes[ISO14443_4_FSD];
+  int res;
+
+  if ((res = iso14443_4_exchange_block(pnd, abtDeselect, sizeof(abtDeselect), abtRes, sizeof(abtRes))) < 0)
+    return res;
+  if (!ISO14443_4_IS_S_DESELECT(abtRes[0])) {
+    pnd->last_error = NFC_ERFTRANS;
+    return pnd->last_error;
+  }
+  return NFC_SUCCESS;
+}
+
+// Restore settings changed while blocks were exchanged: framing, CRC handling and communication timeout
+static int
+iso14443_4_restore(nfc_device *pnd, const bool bEasyFraming, const bool bCrc, const int iTimeoutCom)
+{
+  int res = nfc_device_set_raw_mode(pnd, bEasyFraming, bCrc);
+  if (pnd->iTimeoutCom != iTimeoutCom) {
+    const int res2 = nfc_device_set_property_int(pnd, NP_TIMEOUT_COM, iTimeoutCom);
+    if (res >= 0)
+      res = res2;
+  }
+  return res;
+}
+
+// Blocks are exchanged in raw mode with CRC handled by the device, previous settings are restored afterwards
+int
+iso14443_4_transceive(nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx, uint8_t *pbtRx, const size_t szRx)
+{
+  const bool bEasyFraming = pnd->bEasyFraming;
+  const bool bCrc = pnd->bCrc;
+  const int iTimeoutCom = pnd->iTimeoutCom;
+  int res;
+
+  if (!pnd->tcl.bActive) {
+    pnd->last_error = NFC_EINVARG;
+    return pnd->last_error;
+  }
+  if ((res = nfc_device_set_raw_mode(pnd, false, true)) < 0)
+    return res;
+  res = iso14443_4_transceive_blocks(pnd, pbtTx, szTx, pbtRx, szRx);
+  const int res2 = iso14443_4_restore(pnd, bEasyFraming, bCrc, iTimeoutCom);
+  return (res < 0) ? res : ((res2 < 0) ? res2 : res);
+}
+
+int
+iso14443_4_deselect(nfc_device *pnd)
+{
+  const bool bEasyFraming = pnd->bEasyFraming;
+  const bool bCrc = pnd->bCrc;
+  const int iTimeoutCom = pnd->iTimeoutCom;
+  int res;
+
+  if (!pnd->tcl.bActive) {
+    pnd->last_error = NFC_EINVARG;
+    return pnd->last_error;
+  }
+  if ((res = nfc_device_set_raw_mode(pnd, false, true)) < 0)
+    return res;
+  res = iso14443_4_deselect_block(pnd);
+  iso14443_4_session_stop(pnd);
+  const int res2 = iso14443_4_restore(pnd, bEasyFraming, bCrc, iTimeoutCom);
+  return (res < 0) ? res : res2;
+}
@@ -20,12 +20,110 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <stdarg.h>
 #include <fcntl.h>
 
 #include "log.h"
 
+// Priority applied to categories without a specific rule
+#define LOG_DEFAULT_PRIORITY NFC_PRIORITY_ERROR
+#define LOG_RULES_MAX 16
+#define LOG_CATEGORY_MAX_LEN 64
+
+static const char *log_priority_names[] = {
+  "trace", "debug", "info", "notice", "warning", "error", "critical", "alert", "fatal"
+};
+
+struct log_rule {
+  char category[LOG_CATEGORY_MAX_LEN];
+  int priority;
+};
+
 static uint8_t __log_init_counter = 0;
+static struct log_rule log_rules[LOG_RULES_MAX];
+static size_t log_rules_count = 0;
+static int log_default_priority = LOG_DEFAULT_PRIORITY;
+int log_priority_min = LOG_DEFAULT_PRIORITY;
+
+static int
+log_priority_from_name(const char *name, size_t len)
+{
+  for (size_t i = 0; i < sizeof(log_priority_names) / sizeof(log_priority_names[0]); i++) {
+    if ((strlen(log_priority_names[i]) == len) && (0 == strncmp(log_priority_names[i], name, len)))
+      return (int) i;
+  }
+  return -1;
+}
+
+static void
+log_update_priority_min(void)
+{
+  log_priority_min = log_default_priority;
+  for (size_t i = 0; i < log_rules_count; i++) {
+    if (log_rules[i].priority < log_priority_min)
+      log_priority_min = log_rules[i].priority;
+  }
+}
+
+static int
+log_set_priority_n(const char *category, size_t szCategory, const char *priority, size_t szPriority)
+{
+  const int iPriority = log_priority_from_name(priority, szPriority);
+  if (iPriority < 0)
+    return -1;
+
+  if (szCategory == 0) {
+    log_default_priority = iPriority;
+  } else {
+    if (szCategory >= LOG_CATEGORY_MAX_LEN)
+      return -1;
+    size_t i;
+    for (i = 0; i < log_rules_count; i++) {
+      if ((strlen(log_rules[i].category) == szCategory) && (0 == strncmp(log_rules[i].category, category, szCategory)))
+        break;
+    }
+    if (i == log_rules_count) {
+      if (log_rules_count == LOG_RULES_MAX)
+        return -1;
+      memcpy(log_rules[i].category, category, szCategory);
+      log_rules[i].category[szCategory] = '\0';
+      log_rules_count++;
+    }
+    log_rules[i].priority = iPriority;
+  }
+  log_update_priority_min();
+  return 0;
+}
+
+// LIBNFC_LOG_LEVEL holds comma separated rules: "priority" sets the default,
+// "category=priority" applies to a category and its sub-categories,
+// ie. "error,libnfc.chip.pn53x=trace"
+static void
+log_load_environment(void)
+{
+  const char *envvar = getenv("LIBNFC_LOG_LEVEL");
+  if (!envvar)
+    return;
+
+  while (*envvar) {
+    const char *end = strchr(envvar, ',');
+    const size_t szRule = end ? (size_t)(end - envvar) : strlen(envvar);
+    const char *equal = memchr(envvar, '=', szRule);
+    int res;
+    if (equal) {
+      res = log_set_priority_n(envvar, equal - envvar, equal + 1, szRule - (equal + 1 - envvar));
+    } else {
+      res = log_set_priority_n(NULL, 0, envvar, szRule);
+    }
+    if (res < 0)
+      fprintf(stderr, "Invalid LIBNFC_LOG_LEVEL rule: %.*s\n", (int) szRule, envvar);
+    envvar += szRule;
+    if (*envvar == ',')
+      envvar++;
+  }
+}
 
 int
 log_init(void)
@@ -33,6 +131,10 @@ log_init(void)
   int res = 0;
 
   if (__log_init_counter == 0) {
+    log_rules_count = 0;
+    log_default_priority = LOG_DEFAULT_PRIORITY;
+    log_load_environment();
+    log_update_priority_min();
     res = 0;
   }
   if (!res) {
@@ -56,12 +158,38 @@ log_fini(void)
   return res;
 }
 
+int
+log_set_priority(const char *category, const char *priority)
+{
+  if (!priority)
+    return -1;
+  return log_set_priority_n(category, category ? strlen(category) : 0, priority, strlen(priority));
+}
+
+bool
+log_is_enabled(const char *category, const int priority)
+{
+  // The longest rule matching the category (or one of its parents) wins
+  int iPriority = log_default_priority;
+  size_t szBest = 0;
+  for (size_t i = 0; i < log_rules_count; i++) {
+    const size_t szRule = strlen(log_rules[i].category);
+    if ((szRule > szBest) &&
+        (0 == strncmp(log_rules[i].category, category, szRule)) &&
+        ((category[szRule] == '\0') || (category[szRule] == '.'))) {
+      iPriority = log_rules[i].priority;
+      szBest = szRule;
+    }
+  }
+  return priority >= iPriority;
+}
+
 void
-log_put(const char *category, const char *priority, const char *format, ...)
+log_emit(const char *category, const int priority, const char *format, ...)
 {
   va_list va;
   va_start(va, format);
-  fprintf(stderr, "%s\t%s\t", priority, category);
+  fprintf(stderr, "%s\t%s\t", log_priority_names[priority], category);
   vfprintf(stderr, format, va);
   fprintf(stderr, "\n");
   va_end(va);
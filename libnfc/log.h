@@ -23,6 +23,16 @@
 #  include "config.h"
 #endif // HAVE_CONFIG_H
 
+#define NFC_PRIORITY_FATAL  8
+#define NFC_PRIORITY_ALERT  7
+#define NFC_PRIORITY_CRIT   6
+#define NFC_PRIORITY_ERROR  5
+#define NFC_PRIORITY_WARN   4
+#define NFC_PRIORITY_NOTICE 3
+#define NFC_PRIORITY_INFO   2
+#define NFC_PRIORITY_DEBUG  1
+#define NFC_PRIORITY_TRACE  0
+
 #if defined DEBUG
 
 #  ifndef __has_attribute
@@ -35,24 +45,28 @@
 
 // User want debug features
 #define LOGGING 1
+
+#include <stdbool.h>
+
 int	 log_init(void);
 int	 log_fini(void);
-void log_put(const char *category, const char *priority, const char *format, ...)
+int	 log_set_priority(const char *category, const char *priority);
+bool	 log_is_enabled(const char *category, const int priority);
+void log_emit(const char *category, const int priority, const char *format, ...)
 #  if __has_attribute_format
 __attribute__((format(printf, 3, 4)))
 #  endif
 ;
 
+// Lowest priority enabled for at least one category, lets most messages be dropped with a single comparison
+extern int log_priority_min;
 
-#define NFC_PRIORITY_FATAL  "fatal"
-#define NFC_PRIORITY_ALERT  "alert"
-#define NFC_PRIORITY_CRIT   "critical"
-#define NFC_PRIORITY_ERROR  "error"
-#define NFC_PRIORITY_WARN   "warning"
-#define NFC_PRIORITY_NOTICE "notice"
-#define NFC_PRIORITY_INFO   "info"
-#define NFC_PRIORITY_DEBUG  "debug"
-#define NFC_PRIORITY_TRACE  "trace"
+// Messages are filtered before their arguments are evaluated or formatted
+#define log_enabled(category, priority) (((priority) >= log_priority_min) && log_is_enabled(category, priority))
+#define log_put(category, priority, ...) do { \
+    if (log_enabled(category, priority)) \
+      log_emit(category, priority, __VA_ARGS__); \
+  } while (0)
 #else
 // No logging
 #define log_init() ((void) 0)
@@ -60,16 +74,6 @@ __attribute__((format(printf, 3, 4)))
 #define log_msg(category, priority, message) do {} while (0)
 #define log_set_appender(category, appender) do {} while (0)
 #define log_put(category, priority, format, ...) do {} while (0)
-
-#define NFC_PRIORITY_FATAL  8
-#define NFC_PRIORITY_ALERT  7
-#define NFC_PRIORITY_CRIT   6
-#define NFC_PRIORITY_ERROR  5
-#define NFC_PRIORITY_WARN   4
-#define NFC_PRIORITY_NOTICE 3
-#define NFC_PRIORITY_INFO   2
-#define NFC_PRIORITY_DEBUG  1
-#define NFC_PRIORITY_TRACE  0
 #endif /* HAS_LOG4C, DEBUG */
 
 /**
@@ -78,6 +82,8 @@ __attribute__((format(printf, 3, 4)))
  */
 #  ifdef LOGGING
 #    define LOG_HEX(pcTag, pbtData, szBytes) do { \
+    if (!log_enabled(LOG_CATEGORY, NFC_PRIORITY_TRACE)) \
+      break; \
     size_t	 __szPos; \
     char	 __acBuf[1024]; \
     size_t	 __szBuf = 0; \
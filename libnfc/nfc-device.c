@@ -31,6 +31,7 @@
 #endif // HAVE_CONFIG_H
 
 #include "nfc-internal.h"
+#include "capture.h"
 
 nfc_device *
 nfc_device_new(const nfc_connstring connstring)
@@ -49,10 +50,22 @@ nfc_device_new(const nfc_connstring connstring)
   res->bPar = false;
   res->bEasyFraming    = false;
   res->bAutoIso14443_4 = false;
+  res->bAutoPsl = false;
+  res->iTimeoutCom = 0;
   res->last_error  = 0;
   memcpy(res->connstring, connstring, sizeof(res->connstring));
   res->driver_data = NULL;
   res->chip_data   = NULL;
+  res->frame_recorder.ui32Head = 0;
+  memset(&res->stats, 0x00, sizeof(res->stats));
+  res->capture = NULL;
+  res->tracer = NULL;
+  memset(&res->tcl, 0x00, sizeof(res->tcl));
+
+  // Capture starts before the driver initializes the chip
+  const char *pcCapture = getenv("LIBNFC_CAPTURE");
+  if (pcCapture && *pcCapture)
+    res->capture = capture_open(pcCapture);
 
   return res;
 }
@@ -61,6 +74,8 @@ void
 nfc_device_free(nfc_device *dev)
 {
   if (dev) {
+    capture_close(dev->capture);
+    tracer_close(dev->tracer);
     free(dev->driver_data);
     free(dev);
   }
@@ -0,0 +1,267 @@
+/*-
+ * Public platform independent Near Field Communication (NFC) library
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/**
+* @file nfc-felica.c
+* @brief Provide a small API to read and write FeliCa blocks (NFC Forum Type 3 tags)
+*/
+
+/*
+ * Based on NFC Forum Type 3 Tag Operation Specification
+ *  Technical Specification
+ *  NFCForum-TS-Type-3-Tag_1.1 - 2011-06-28
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <string.h>
+
+#include <nfc/nfc.h>
+#include <nfc/nfc-felica.h>
+
+#include "nfc-internal.h"
+#include "chips/pn53x-internal.h"
+
+#define LOG_CATEGORY "libnfc.felica"
+
+// Commands, responses codes are command codes + 1
+#define FELICA_CHECK   0x06
+#define FELICA_UPDATE  0x08
+
+// Command: LEN, command code, IDm, number of services, service code, number of blocks, then block list
+#define FELICA_CMD_HEADER_LEN  14
+// Response: LEN, response code, IDm, status flags 1 and 2 (then number of blocks and block data for Check)
+#define FELICA_RES_HEADER_LEN  12
+// Largest frame: LEN byte counts the whole frame, and PN53x InCommunicateThru data less command/response code and status
+#define FELICA_FRAME_MAX_LEN   (((PN53x_EXTENDED_FRAME__DATA_MAX_LEN - 2) < 0xff) ? (PN53x_EXTENDED_FRAME__DATA_MAX_LEN - 2) : 0xff)
+
+// Block list element: 2 bytes for blocks 0 to 255, 3 bytes (block number in little endian) otherwise
+static size_t
+felica_block_element(uint8_t *pbt, const uint16_t ui16Block)
+{
+  if (ui16Block < 0x100) {
+    pbt[0] = 0x80;
+    pbt[1] = ui16Block;
+    return 2;
+  }
+  pbt[0] = 0x00;
+  pbt[1] = ui16Block & 0xff;
+  pbt[2] = ui16Block >> 8;
+  return 3;
+}
+
+// Number of blocks from ui16FirstBlock a single command handles: up to szMaxBlocks (0 for no limit) and to frames size both ways
+static size_t
+felica_max_blocks(const uint8_t ui8Command, const uint16_t ui16FirstBlock, const size_t szBlocks, const size_t szMaxBlocks)
+{
+  size_t szCmdLen = FELICA_CMD_HEADER_LEN;
+  size_t szResLen = FELICA_RES_HEADER_LEN + ((ui8Command == FELICA_CHECK) ? 1 : 0);
+  size_t n = 0;
+
+  while ((n < szBlocks) && (!szMaxBlocks || (n < szMaxBlocks))) {
+    szCmdLen += ((ui16FirstBlock + n) < 0x100) ? 2 : 3;
+    if (ui8Command == FELICA_UPDATE)
+      szCmdLen += NFC_FELICA_BLOCK_LEN;
+    else
+      szResLen += NFC_FELICA_BLOCK_LEN;
+    if ((szCmdLen > FELICA_FRAME_MAX_LEN) || (szResLen > FELICA_FRAME_MAX_LEN))
+      break;
+    n++;
+  }
+  return n;
+}
+
+// Sends a command built in pbtCmd (LEN and IDm are filled here), checks response header
+static int
+felica_transceive(nfc_device *pnd, const nfc_target *pnt, uint8_t *pbtCmd, const size_t szCmd, uint8_t *pbtRx, const size_t szRx)
+{
+  const bool bEasyFraming = pnd->bEasyFraming;
+  const bool bCrc = pnd->bCrc;
+  int res;
+
+  pbtCmd[0] = szCmd;
+  memcpy(pbtCmd + 2, pnt->nti.nfi.abtId, 8);
+
+  if ((res = nfc_device_set_raw_mode(pnd, false, true)) < 0)
+    return res;
+  res = nfc_initiator_transceive_bytes(pnd, pbtCmd, szCmd, pbtRx, szRx, -1);
+  const int res2 = nfc_device_set_raw_mode(pnd, bEasyFraming, bCrc);
+  if (res < 0)
+    return res;
+  if (res2 < 0)
+    return res2;
+
+  if ((res < FELICA_RES_HEADER_LEN) || (pbtRx[0] != res) || (pbtRx[1] != pbtCmd[1] + 1) ||
+      memcmp(pbtRx + 2, pnt->nti.nfi.abtId, 8)) {
+    log_put(LOG_CATEGORY, NFC_PRIORITY_ERROR, "Invalid response to command 0x%02x", pbtCmd[1]);
+    pnd->last_error = NFC_ERFTRANS;
+    return pnd->last_error;
+  }
+  if (pbtRx[10] || pbtRx[11]) {
+    log_put(LOG_CATEGORY, NFC_PRIORITY_ERROR, "Command 0x%02x failed, status flags: %02x %02x", pbtCmd[1], pbtRx[10], pbtRx[11]);
+    pnd->last_error = NFC_ERFTRANS;
+    return pnd->last_error;
+  }
+  return res;
+}
+
+static int
+felica_check_target(nfc_device *pnd, const nfc_target *pnt)
+{
+  if (pnt->nm.nmt != NMT_FELICA) {
+    pnd->last_error = NFC_EINVARG;
+    return pnd->last_error;
+  }
+  return NFC_SUCCESS;
+}
+
+/** @ingroup initiator
+ * @brief Read blocks of a FeliCa service (Check command)
+ * @return Returns read bytes count on success, otherwise returns libnfc's error code (negative value)
+ *
+ * @param pnd \a nfc_device struct pointer that represent currently used device
+ * @param pnt selected FeliCa target
+ * @param ui16ServiceCode service code (ie. \a NFC_FELICA_SERVICE_NDEF_RO)
+ * @param ui16FirstBlock first block to read
+ * @param[out] pbtData buffer of \a szBlocks blocks
+ * @param szBlocks number of blocks to read
+ * @param szMaxBlocks largest number of blocks the card reads per command (Nbr of NFC Forum Type 3 tags), 0 if unknown
+ *
+ * Each Check command reads as many blocks as both the card and the frames
+ * (FeliCa LEN byte and PN53x frame) allow: up to 15 blocks.
+ */
+int
+nfc_felica_check(nfc_device *pnd, const nfc_target *pnt, const uint16_t ui16ServiceCode, const uint16_t ui16FirstBlock,
+                 uint8_t *pbtData, const size_t szBlocks, const size_t szMaxBlocks)
+{
+  uint8_t abtCmd[FELICA_FRAME_MAX_LEN] = { 0x00, FELICA_CHECK };
+  uint8_t abtRx[FELICA_FRAME_MAX_LEN];
+  size_t szDone = 0;
+  int res;
+
+  if ((res = felica_check_target(pnd, pnt)) < 0)
+    return res;
+
+  while (szDone < szBlocks) {
+    const uint16_t ui16Block = ui16FirstBlock + szDone;
+    const size_t n = felica_max_blocks(FELICA_CHECK, ui16Block, szBlocks - szDone, szMaxBlocks);
+    size_t szCmd = 10;
+    abtCmd[szCmd++] = 1;
+    abtCmd[szCmd++] = ui16ServiceCode & 0xff;
+    abtCmd[szCmd++] = ui16ServiceCode >> 8;
+    abtCmd[szCmd++] = n;
+    for (size_t b = 0; b < n; b++)
+      szCmd += felica_block_element(abtCmd + szCmd, ui16Block + b);
+
+    if ((res = felica_transceive(pnd, pnt, abtCmd, szCmd, abtRx, sizeof(abtRx))) < 0)
+      return res;
+    // Blocks data follow the number of blocks
+    if ((abtRx[FELICA_RES_HEADER_LEN] != n) || ((size_t) res != FELICA_RES_HEADER_LEN + 1 + n * NFC_FELICA_BLOCK_LEN)) {
+      pnd->last_error = NFC_ERFTRANS;
+      return pnd->last_error;
+    }
+    memcpy(pbtData + szDone * NFC_FELICA_BLOCK_LEN, abtRx + FELICA_RES_HEADER_LEN + 1, n * NFC_FELICA_BLOCK_LEN);
+    szDone += n;
+  }
+  return szBlocks * NFC_FELICA_BLOCK_LEN;
+}
+
+/** @ingroup initiator
+ * @brief Write blocks of a FeliCa service (Update command)
+ * @return Returns written bytes count on success, otherwise returns libnfc's error code (negative value)
+ *
+ * @param pnd \a nfc_device struct pointer that represent currently used device
+ * @param pnt selected FeliCa target
+ * @param ui16ServiceCode service code (ie. \a NFC_FELICA_SERVICE_NDEF_RW)
+ * @param ui16FirstBlock first block to write
+ * @param pbtData \a szBlocks blocks to write
+ * @param szBlocks number of blocks to write
+ * @param szMaxBlocks largest number of blocks the card writes per command (Nbw of NFC Forum Type 3 tags), 0 if unknown
+ *
+ * Each Update command writes as many blocks as both the card and the frames
+ * allow: up to 13 blocks.
+ */
+int
+nfc_felica_update(nfc_device *pnd, const nfc_target *pnt, const uint16_t ui16ServiceCode, const uint16_t ui16FirstBlock,
+                  const uint8_t *pbtData, const size_t szBlocks, const size_t szMaxBlocks)
+{
+  uint8_t abtCmd[FELICA_FRAME_MAX_LEN] = { 0x00, FELICA_UPDATE };
+  uint8_t abtRx[FELICA_FRAME_MAX_LEN];
+  size_t szDone = 0;
+  int res;
+
+  if ((res = felica_check_target(pnd, pnt)) < 0)
+    return res;
+
+  while (szDone < szBlocks) {
+    const uint16_t ui16Block = ui16FirstBlock + szDone;
+    const size_t n = felica_max_blocks(FELICA_UPDATE, ui16Block, szBlocks - szDone, szMaxBlocks);
+    size_t szCmd = 10;
+    abtCmd[szCmd++] = 1;
+    abtCmd[szCmd++] = ui16ServiceCode & 0xff;
+    abtCmd[szCmd++] = ui16ServiceCode >> 8;
+    abtCmd[szCmd++] = n;
+    for (size_t b = 0; b < n; b++)
+      szCmd += felica_block_element(abtCmd + szCmd, ui16Block + b);
+    memcpy(abtCmd + szCmd, pbtData + szDone * NFC_FELICA_BLOCK_LEN, n * NFC_FELICA_BLOCK_LEN);
+    szCmd += n * NFC_FELICA_BLOCK_LEN;
+
+    if ((res = felica_transceive(pnd, pnt, abtCmd, szCmd, abtRx, sizeof(abtRx))) < 0)
+      return res;
+    szDone += n;
+  }
+  return szBlocks * NFC_FELICA_BLOCK_LEN;
+}
+
+/** @ingroup initiator
+ * @brief Read the attribute information block of a NFC Forum Type 3 tag
+ * @return Returns 0 on success, otherwise returns libnfc's error code (negative value)
+ *
+ * @param pnd \a nfc_device struct pointer that represent currently used device
+ * @param pnt selected FeliCa target, with NFC Forum system code (0x12fc)
+ * @param[out] pnfai attribute information, whose Nbr and Nbw size nfc_felica_check() and nfc_felica_update() commands
+ *
+ * \a NFC_ERFTRANS is returned when the block checksum does not match.
+ */
+int
+nfc_felica_read_attribute_info(nfc_device *pnd, const nfc_target *pnt, nfc_felica_attribute_info *pnfai)
+{
+  uint8_t abtBlock[NFC_FELICA_BLOCK_LEN];
+  uint16_t ui16Checksum = 0;
+  int res;
+
+  if ((res = nfc_felica_check(pnd, pnt, NFC_FELICA_SERVICE_NDEF_RO, 0, abtBlock, 1, 1)) < 0)
+    return res;
+  for (size_t n = 0; n < 14; n++)
+    ui16Checksum += abtBlock[n];
+  if (ui16Checksum != ((abtBlock[14] << 8) | abtBlock[15])) {
+    log_put(LOG_CATEGORY, NFC_PRIORITY_ERROR, "%s", "Attribute information checksum does not match");
+    pnd->last_error = NFC_ERFTRANS;
+    return pnd->last_error;
+  }
+
+  pnfai->ui8Version = abtBlock[0];
+  pnfai->ui8Nbr = abtBlock[1];
+  pnfai->ui8Nbw = abtBlock[2];
+  pnfai->ui16Nmaxb = (abtBlock[3] << 8) | abtBlock[4];
+  pnfai->ui8WriteFlag = abtBlock[9];
+  pnfai->ui8RwFlag = abtBlock[10];
+  pnfai->ui32Ln = (abtBlock[11] << 16) | (abtBlock[12] << 8) | abtBlock[13];
+  return NFC_SUCCESS;
+}
@@ -22,11 +22,20 @@
 * @brief Provide some useful internal functions
 */
 
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif // HAVE_CONFIG_H
+
 #include <nfc/nfc.h>
 #include "nfc-internal.h"
+#include "capture.h"
 
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#ifdef WIN32
+#  include <windows.h>
+#endif
 
 static bool
 string_as_boolean(const char* s)
@@ -105,3 +114,113 @@ prepare_initiator_data(const nfc_modulation nm, uint8_t **ppbtInitiatorData, siz
       break;
   }
 }
+
+int64_t
+monotonic_time_us(void)
+{
+#if defined(CLOCK_MONOTONIC) && !defined(WIN32)
+  struct timespec ts;
+  if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) {
+    return ((int64_t) ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+  }
+#endif
+  // Fallback on wall clock
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return ((int64_t) tv.tv_sec * 1000000) + tv.tv_usec;
+}
+
+int64_t
+monotonic_time_ms(void)
+{
+  return monotonic_time_us() / 1000;
+}
+
+void
+monotonic_sleep_us(const int64_t i64Delay)
+{
+  if (i64Delay <= 0)
+    return;
+#ifndef WIN32
+  const struct timespec ts = { .tv_sec = i64Delay / 1000000, .tv_nsec = (i64Delay % 1000000) * 1000 };
+  nanosleep(&ts, NULL);
+#else
+  Sleep(i64Delay / 1000);
+#endif
+}
+
+void
+nfc_device_update_stats(nfc_device *pnd, const uint8_t ui8Command, const size_t szOut, const size_t szIn, const int iResult,
+                        const int64_t i64Latency)
+{
+  nfc_command_stats *pncs = &pnd->stats.ancs[ui8Command];
+
+  pncs->ui32Calls++;
+  pncs->ui64BytesOut += szOut;
+  pncs->ui64BytesIn += szIn;
+  switch (iResult) {
+    case NFC_ETIMEOUT:
+      pncs->ui32Timeouts++;
+      break;
+    case NFC_ERFTRANS:
+      pncs->ui32RfErrors++;
+      break;
+    case NFC_ECHIP:
+      pncs->ui32ChipErrors++;
+      break;
+    default:
+      if (iResult < 0)
+        pncs->ui32OtherErrors++;
+      break;
+  }
+
+  size_t szBucket = 0;
+  for (uint64_t ui64Latency = (i64Latency > 0) ? ((uint64_t) i64Latency >> 7) : 0; ui64Latency && (szBucket < NFC_STATS_LATENCY_BUCKETS - 1); ui64Latency >>= 1)
+    szBucket++;
+  pncs->aui32Latency[szBucket]++;
+}
+
+void
+nfc_device_update_recovery_stats(nfc_device *pnd, const int iResult, const int64_t i64Duration)
+{
+  const uint32_t ui32Duration = (i64Duration > 0) ? ((i64Duration < UINT32_MAX) ? (uint32_t) i64Duration : UINT32_MAX) : 0;
+
+  if (iResult < 0)
+    pnd->stats.ui32FailedRecoveries++;
+  else
+    pnd->stats.ui32Recoveries++;
+  pnd->stats.ui64RecoveryTime += ui32Duration;
+  if (ui32Duration > pnd->stats.ui32MaxRecoveryTime)
+    pnd->stats.ui32MaxRecoveryTime = ui32Duration;
+}
+
+int
+nfc_device_set_raw_mode(nfc_device *pnd, const bool bEasyFraming, const bool bCrc)
+{
+  int res;
+  if ((res = nfc_device_set_property_bool(pnd, NP_EASY_FRAMING, bEasyFraming)) < 0)
+    return res;
+  return nfc_device_set_property_bool(pnd, NP_HANDLE_CRC, bCrc);
+}
+
+void
+nfc_device_record_frame(nfc_device *pnd, const nfc_frame_direction nfd, const uint8_t ui8Command, const int iResult,
+                        const uint8_t *pbtData, const size_t szData)
+{
+  struct nfc_frame_recorder *pnfr = &pnd->frame_recorder;
+  // Only the device thread writes the head
+  const uint32_t ui32Head = __atomic_load_n(&pnfr->ui32Head, __ATOMIC_RELAXED);
+  nfc_frame_record *pnfrRecord = &pnfr->records[ui32Head % NFC_FRAME_RECORDER_SIZE];
+
+  pnfrRecord->i64Timestamp = monotonic_time_us();
+  pnfrRecord->nfd = nfd;
+  pnfrRecord->ui8Command = ui8Command;
+  pnfrRecord->iResult = iResult;
+  pnfrRecord->szData = szData;
+  memcpy(pnfrRecord->abtData, pbtData, (szData < NFC_FRAME_RECORD_DATA_LEN) ? szData : NFC_FRAME_RECORD_DATA_LEN);
+  // Publish the record only once it is complete
+  __atomic_store_n(&pnfr->ui32Head, ui32Head + 1, __ATOMIC_RELEASE);
+
+  if (pnd->capture)
+    capture_pn53x(pnd->capture, nfd == NFD_TX, iResult, pbtData, szData);
+}
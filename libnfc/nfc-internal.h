@@ -33,18 +33,42 @@
 #include "nfc/nfc.h"
 
 #include "log.h"
+#include "tracer.h"
+#include "probes.h"
+
+/**
+ * @macro TRACE_SPAN
+ * @brief Evaluate CALL into RES within a span named after the calling function.
+ */
+#define TRACE_SPAN( RES, CALL ) do { \
+    TRACE_BEGIN(pnd, "nfc", __func__); \
+    RES = CALL; \
+    TRACE_END(pnd, "nfc", __func__, RES); \
+  } while (0)
+
+/**
+ * @macro HAL_RES
+ * @brief Execute corresponding driver function if exists, and store its result in RES.
+ */
+#define HAL_RES( RES, FUNCTION, ... ) do { \
+    pnd->last_error = 0; \
+    if (pnd->driver->FUNCTION) { \
+      TRACE_SPAN(RES, pnd->driver->FUNCTION( __VA_ARGS__ )); \
+    } else { \
+      pnd->last_error = NFC_EDEVNOTSUPP; \
+      RES = false; \
+    } \
+  } while (0)
 
 /**
  * @macro HAL
  * @brief Execute corresponding driver function if exists.
  */
-#define HAL( FUNCTION, ... ) pnd->last_error = 0; \
-  if (pnd->driver->FUNCTION) { \
-    return pnd->driver->FUNCTION( __VA_ARGS__ ); \
-  } else { \
-    pnd->last_error = NFC_EDEVNOTSUPP; \
-    return false; \
-  }
+#define HAL( FUNCTION, ... ) do { \
+    int hal_res; \
+    HAL_RES(hal_res, FUNCTION, __VA_ARGS__); \
+    return hal_res; \
+  } while (0)
 
 #ifndef MIN
 #define MIN(a,b) (((a) < (b)) ? (a) : (b))
@@ -123,8 +147,10 @@ struct nfc_driver {
 
   int (*initiator_init)(struct nfc_device *pnd);
   int (*initiator_init_secure_element)(struct nfc_device *pnd);
-  int (*initiator_select_passive_target)(struct nfc_device *pnd,  const nfc_modulation nm, const uint8_t *pbtInitData, const size_t szInitData, nfc_target *pnt);
-  int (*initiator_poll_target)(struct nfc_device *pnd, const nfc_modulation *pnmModulations, const size_t szModulations, const uint8_t uiPollNr, const uint8_t btPeriod, nfc_target *pnt);
+  int (*initiator_select_passive_target)(struct nfc_device *pnd,  const nfc_modulation nm, const uint8_t *pbtInitData, const size_t szInitData, nfc_target *pnt, const int flags);
+  int (*initiator_list_passive_targets)(struct nfc_device *pnd, const nfc_modulation nm, const uint8_t *pbtInitData, const size_t szInitData, nfc_target ant[], const size_t szTargets);
+  int (*initiator_activate_iso14443_4)(struct nfc_device *pnd, nfc_target *pnt);
+  int (*initiator_poll_target)(struct nfc_device *pnd, const nfc_modulation *pnmModulations, const size_t szModulations, const uint8_t uiPollNr, const uint8_t btPeriod, nfc_target *pnt, const int flags);
   int (*initiator_select_dep_target)(struct nfc_device *pnd, const nfc_dep_mode ndm, const nfc_baud_rate nbr, const nfc_dep_info *pndiInitiator, nfc_target *pnt, const int timeout);
   int (*initiator_deselect_target)(struct nfc_device *pnd);
   int (*initiator_transceive_bytes)(struct nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx, uint8_t *pbtRx, const size_t szRx, int timeout);
@@ -168,6 +194,29 @@ void nfc_context_free(nfc_context *context);
  * @struct nfc_device
  * @brief NFC device information
  */
+// Ring buffer of the last frames exchanged with the chip, always on
+#define NFC_FRAME_RECORDER_SIZE 64
+struct nfc_frame_recorder {
+  nfc_frame_record records[NFC_FRAME_RECORDER_SIZE];
+  // Number of records written since the device was opened, only the last NFC_FRAME_RECORDER_SIZE are kept.
+  // Published with a release store once the record is complete, read with acquire loads
+  uint32_t ui32Head;
+};
+
+// Host side ISO14443-4 (T=CL) session with the selected target, see iso14443-4.c
+struct iso14443_4_session {
+  // A target is activated in ISO14443-4 mode
+  bool    bActive;
+  // Target has been activated by nfc_initiator_activate_iso14443_4(): the device is not aware of its ISO14443-4 layer
+  bool    bHostActivated;
+  // PCD block number
+  uint8_t ui8BlockNumber;
+  // Max frame size the target accepts (FSC), CRC included
+  size_t  szFsc;
+  // Frame waiting time (FWT) in milliseconds
+  int     iFwt;
+};
+
 struct nfc_device {
   const struct nfc_driver *driver;
   void *driver_data;
@@ -186,10 +235,24 @@ struct nfc_device {
   /** Should the chip switch automatically activate ISO14443-4 when
       selecting tags supporting it? */
   bool    bAutoIso14443_4;
+  /** Should the chip raise the D.E.P. bit rate with PSL right after ATR? */
+  bool    bAutoPsl;
+  /** Communication timeout (NP_TIMEOUT_COM) in ms, host side layers changing it restore it */
+  int     iTimeoutCom;
   /** Supported modulation encoded in a byte */
   uint8_t  btSupportByte;
   /** Last reported error */
   int     last_error;
+  /** Last frames exchanged with the chip */
+  struct nfc_frame_recorder frame_recorder;
+  /** Per command counters */
+  nfc_device_stats stats;
+  /** pcapng traffic capture, NULL when disabled */
+  struct capture *capture;
+  /** Chrome trace-event spans, NULL when disabled */
+  struct tracer *tracer;
+  /** Host side ISO14443-4 session */
+  struct iso14443_4_session tcl;
 };
 
 nfc_device *nfc_device_new(const nfc_connstring connstring);
@@ -197,6 +260,32 @@ void        nfc_device_free(nfc_device *dev);
 
 void iso14443_cascade_uid(const uint8_t abtUID[], const size_t szUID, uint8_t *pbtCascadedUID, size_t *pszCascadedUID);
 
+// Host side ISO14443-4 (T=CL): a session starts when a target is selected with its ATS
+void iso14443_4_session_start(nfc_device *pnd, const nfc_target *pnt, const bool bHostActivated);
+void iso14443_4_session_stop(nfc_device *pnd);
+int  iso14443_4_transceive(nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx, uint8_t *pbtRx, const size_t szRx);
+int  iso14443_4_deselect(nfc_device *pnd);
+
 void prepare_initiator_data(const nfc_modulation nm, uint8_t **ppbtInitiatorData, size_t *pszInitiatorData);
 
+// Milliseconds (resp. microseconds) from a monotonic clock, to measure elapsed time and compute deadlines
+int64_t monotonic_time_ms(void);
+int64_t monotonic_time_us(void);
+// Sleep for a number of microseconds
+void monotonic_sleep_us(const int64_t i64Delay);
+
+// Account a chip command round-trip in the device's counters
+void nfc_device_update_stats(nfc_device *pnd, const uint8_t ui8Command, const size_t szOut, const size_t szIn, const int iResult,
+                             const int64_t i64Latency);
+
+// Account an automatic recovery of a wedged device in the device's counters
+void nfc_device_update_recovery_stats(nfc_device *pnd, const int iResult, const int64_t i64Duration);
+
+// Set framing and CRC handling of a host side protocol layer exchanging raw frames (callers restore theirs afterwards)
+int  nfc_device_set_raw_mode(nfc_device *pnd, const bool bEasyFraming, const bool bCrc);
+
+// Store a frame in the device's frame recorder (and capture, when enabled): a memcpy, no formatting, safe to call on every frame
+void nfc_device_record_frame(nfc_device *pnd, const nfc_frame_direction nfd, const uint8_t ui8Command, const int iResult,
+                             const uint8_t *pbtData, const size_t szData);
+
 #endif // __NFC_INTERNAL_H__
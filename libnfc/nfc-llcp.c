@@ -0,0 +1,1217 @@
+/*-
+ * Public platform independent Near Field Communication (NFC) library
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/**
+* @file nfc-llcp.c
+* @brief Provide NFC Forum Logical Link Control Protocol (LLCP) over D.E.P.
+*/
+
+/**
+ * @defgroup llcp  LLCP link and connections
+ * @brief Connection-oriented LLCP transport over a D.E.P. link
+ *
+ * The link runs in the caller's thread: every blocking call exchanges frames
+ * with the remote LLC (SYMM when there is nothing else to send) until it is
+ * done, so the link stays up as long as the application keeps on calling
+ * them, nfc_llcp_link_service() when it has nothing else to do.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <nfc/nfc.h>
+#include <nfc/nfc-llcp.h>
+
+#include "nfc-internal.h"
+
+#define LOG_CATEGORY "libnfc.llcp"
+
+// PDU types
+#define LLCP_PTYPE_SYMM     0x0
+#define LLCP_PTYPE_PAX      0x1
+#define LLCP_PTYPE_AGF      0x2
+#define LLCP_PTYPE_UI       0x3
+#define LLCP_PTYPE_CONNECT  0x4
+#define LLCP_PTYPE_DISC     0x5
+#define LLCP_PTYPE_CC       0x6
+#define LLCP_PTYPE_DM       0x7
+#define LLCP_PTYPE_FRMR     0x8
+#define LLCP_PTYPE_SNL      0x9
+#define LLCP_PTYPE_I        0xc
+#define LLCP_PTYPE_RR       0xd
+#define LLCP_PTYPE_RNR      0xe
+
+// Parameters, encoded as TLV
+#define LLCP_PARAM_VERSION  0x01
+#define LLCP_PARAM_MIUX     0x02
+#define LLCP_PARAM_WKS      0x03
+#define LLCP_PARAM_LTO      0x04
+#define LLCP_PARAM_RW       0x05
+#define LLCP_PARAM_SN       0x06
+#define LLCP_PARAM_OPT      0x07
+
+// DM reasons
+#define LLCP_DM_DISCONNECTED   0x00
+#define LLCP_DM_NO_CONNECTION  0x01
+#define LLCP_DM_NO_SERVICE     0x02
+#define LLCP_DM_REJECTED       0x03
+
+// FRMR flags
+#define LLCP_FRMR_I  0x40
+#define LLCP_FRMR_R  0x20
+#define LLCP_FRMR_S  0x10
+
+// Version 1.1, only the major version has to match
+#define LLCP_VERSION        0x11
+// OPT: link service class 2, connection-oriented transport only
+#define LLCP_OPT_LSC_CO     0x02
+// Values in use when the matching parameter is not sent
+#define LLCP_MIU_DEFAULT    128
+#define LLCP_RW_DEFAULT     1
+#define LLCP_LTO_DEFAULT    100
+// Local parameters when none are given
+#define LLCP_LOCAL_RW_DEFAULT   4
+#define LLCP_LOCAL_LTO_DEFAULT  500
+
+// Largest frame sent: an I PDU carrying a full MIU
+#define LLCP_FRAME_MAX_LEN     (NFC_LLCP_MIU_MAX + 3)
+// Largest frame received
+#define LLCP_RX_FRAME_MAX_LEN  264
+// SDUs queued per direction of a connection (more than the largest window), also the room for pending control PDUs
+#define LLCP_QUEUE_LEN         (NFC_LLCP_RW_MAX + 1)
+#define LLCP_MAX_CONNECTIONS   8
+#define LLCP_MAX_LISTENERS     8
+#define LLCP_SN_MAX_LEN        63
+// SAPs given to outgoing connections
+#define LLCP_SAP_DYNAMIC_FIRST 0x20
+#define LLCP_SAP_DYNAMIC_LAST  0x3f
+// Extra time (ms) given to the device on top of the remote link timeout
+#define LLCP_DEVICE_TIMEOUT_MARGIN 100
+
+static const uint8_t llcp_magic[] = { 0x46, 0x66, 0x6d };
+
+struct llcp_pdu {
+  size_t  szLen;
+  uint8_t abtData[LLCP_FRAME_MAX_LEN];
+};
+
+// Ring of PDUs, or of SDUs for connections
+struct llcp_queue {
+  struct llcp_pdu apdu[LLCP_QUEUE_LEN];
+  size_t  szHead;
+  size_t  szCount;
+};
+
+typedef enum {
+  LLCP_CONNECTION_FREE = 0,
+  LLCP_CONNECTION_CONNECTING,
+  LLCP_CONNECTION_CONNECTED,
+  LLCP_CONNECTION_DISCONNECTING,
+  LLCP_CONNECTION_DISCONNECTED,
+} llcp_connection_state;
+
+struct llcp_connection {
+  llcp_connection_state state;
+  uint8_t ui8LocalSap;
+  uint8_t ui8RemoteSap;
+  size_t  szRemoteMiu;
+  uint8_t ui8RemoteRw;
+  bool    bRemoteBusy;
+  // Returned to the application by nfc_llcp_connect() or nfc_llcp_accept()
+  bool    bAccepted;
+  // Send state V(S), acknowledged V(SA), receive state V(R) and last N(R) sent V(RA)
+  uint8_t ui8Vs;
+  uint8_t ui8Vsa;
+  uint8_t ui8Vr;
+  uint8_t ui8Vra;
+  // DM reason when the connection has been refused
+  uint8_t ui8Reason;
+  struct llcp_queue tx;
+  struct llcp_queue rx;
+};
+
+struct llcp_listener {
+  // 0 when unused
+  uint8_t ui8Sap;
+  char    acServiceName[LLCP_SN_MAX_LEN + 1];
+};
+
+struct nfc_llcp_link {
+  nfc_device *pnd;
+  bool    bInitiator;
+  bool    bActive;
+  // Last exchange was SYMM both ways
+  bool    bIdle;
+  nfc_llcp_params local;
+  nfc_llcp_params remote;
+  struct llcp_queue control;
+  struct llcp_connection connections[LLCP_MAX_CONNECTIONS];
+  struct llcp_listener listeners[LLCP_MAX_LISTENERS];
+};
+
+typedef bool (*llcp_condition)(const nfc_llcp_link *link, const void *arg);
+
+static struct llcp_pdu *
+llcp_queue_head(struct llcp_queue *pq)
+{
+  return (pq->szCount) ? &pq->apdu[pq->szHead] : NULL;
+}
+
+// Free slot at the end of the queue, NULL when full; llcp_queue_push() commits it
+static struct llcp_pdu *
+llcp_queue_tail(struct llcp_queue *pq)
+{
+  return (pq->szCount < LLCP_QUEUE_LEN) ? &pq->apdu[(pq->szHead + pq->szCount) % LLCP_QUEUE_LEN] : NULL;
+}
+
+static void
+llcp_queue_push(struct llcp_queue *pq)
+{
+  pq->szCount++;
+}
+
+static void
+llcp_queue_pop(struct llcp_queue *pq)
+{
+  pq->szHead = (pq->szHead + 1) % LLCP_QUEUE_LEN;
+  pq->szCount--;
+}
+
+static size_t
+llcp_pdu_header(uint8_t *pbt, const uint8_t ui8Dsap, const uint8_t ui8Ptype, const uint8_t ui8Ssap)
+{
+  pbt[0] = (ui8Dsap << 2) | (ui8Ptype >> 2);
+  pbt[1] = ((ui8Ptype & 0x03) << 6) | ui8Ssap;
+  return 2;
+}
+
+static size_t
+llcp_param_put(uint8_t *pbt, const uint8_t ui8Type, const uint16_t ui16Value, const size_t szLen)
+{
+  pbt[0] = ui8Type;
+  pbt[1] = szLen;
+  if (szLen == 2) {
+    pbt[2] = ui16Value >> 8;
+    pbt[3] = ui16Value & 0xff;
+  } else {
+    pbt[2] = ui16Value & 0xff;
+  }
+  return 2 + szLen;
+}
+
+// Reads known parameters into pnlp, VERSION into pui8Version and SN into pcServiceName (when not NULL)
+static void
+llcp_params_decode(const uint8_t *pbt, size_t szLen, nfc_llcp_params *pnlp, uint8_t *pui8Version, char *pcServiceName)
+{
+  while (szLen >= 2) {
+    const uint8_t ui8Type = pbt[0];
+    const size_t szValue = pbt[1];
+    const uint8_t *pbtValue = pbt + 2;
+    if (szValue + 2 > szLen)
+      break;
+    switch (ui8Type) {
+      case LLCP_PARAM_VERSION:
+        if ((szValue == 1) && pui8Version)
+          *pui8Version = pbtValue[0];
+        break;
+      case LLCP_PARAM_MIUX:
+        if (szValue == 2)
+          pnlp->szMiu = LLCP_MIU_DEFAULT + (((pbtValue[0] & 0x07) << 8) | pbtValue[1]);
+        break;
+      case LLCP_PARAM_WKS:
+        if (szValue == 2)
+          pnlp->ui16Wks = (pbtValue[0] << 8) | pbtValue[1];
+        break;
+      case LLCP_PARAM_LTO:
+        // LTO is given in 10 ms units, 0 stands for the default value
+        if ((szValue == 1) && pbtValue[0])
+          pnlp->iLto = pbtValue[0] * 10;
+        break;
+      case LLCP_PARAM_RW:
+        if (szValue == 1)
+          pnlp->ui8Rw = pbtValue[0] & 0x0f;
+        break;
+      case LLCP_PARAM_SN:
+        if (pcServiceName && (szValue <= LLCP_SN_MAX_LEN)) {
+          memcpy(pcServiceName, pbtValue, szValue);
+          pcServiceName[szValue] = '\0';
+        }
+        break;
+    }
+    pbt += 2 + szValue;
+    szLen -= 2 + szValue;
+  }
+}
+
+// Connection parameters sent in CONNECT and CC
+static size_t
+llcp_connection_params(const nfc_llcp_link *link, uint8_t *pbt, const char *pcServiceName)
+{
+  size_t sz = 0;
+  if (link->local.szMiu > LLCP_MIU_DEFAULT)
+    sz += llcp_param_put(pbt + sz, LLCP_PARAM_MIUX, link->local.szMiu - LLCP_MIU_DEFAULT, 2);
+  sz += llcp_param_put(pbt + sz, LLCP_PARAM_RW, link->local.ui8Rw, 1);
+  if (pcServiceName) {
+    const size_t szServiceName = strlen(pcServiceName);
+    pbt[sz++] = LLCP_PARAM_SN;
+    pbt[sz++] = szServiceName;
+    memcpy(pbt + sz, pcServiceName, szServiceName);
+    sz += szServiceName;
+  }
+  return sz;
+}
+
+static int
+llcp_link_queue_pdu(nfc_llcp_link *link, const uint8_t ui8Dsap, const uint8_t ui8Ptype, const uint8_t ui8Ssap,
+                    const uint8_t *pbtInfo, const size_t szInfo)
+{
+  struct llcp_pdu *ppdu = llcp_queue_tail(&link->control);
+  if (!ppdu || (2 + szInfo > sizeof(ppdu->abtData))) {
+    log_put(LOG_CATEGORY, NFC_PRIORITY_ERROR, "Unable to queue PDU type 0x%x", ui8Ptype);
+    return NFC_EOVFLOW;
+  }
+  llcp_pdu_header(ppdu->abtData, ui8Dsap, ui8Ptype, ui8Ssap);
+  if (szInfo)
+    memcpy(ppdu->abtData + 2, pbtInfo, szInfo);
+  ppdu->szLen = 2 + szInfo;
+  llcp_queue_push(&link->control);
+  return NFC_SUCCESS;
+}
+
+static void
+llcp_link_queue_dm(nfc_llcp_link *link, const uint8_t ui8Dsap, const uint8_t ui8Ssap, const uint8_t ui8Reason)
+{
+  llcp_link_queue_pdu(link, ui8Dsap, LLCP_PTYPE_DM, ui8Ssap, &ui8Reason, 1);
+}
+
+static struct llcp_connection *
+llcp_link_new_connection(nfc_llcp_link *link)
+{
+  for (size_t n = 0; n < LLCP_MAX_CONNECTIONS; n++) {
+    struct llcp_connection *pc = &link->connections[n];
+    if (pc->state == LLCP_CONNECTION_FREE) {
+      memset(pc, 0x00, sizeof(*pc));
+      pc->szRemoteMiu = LLCP_MIU_DEFAULT;
+      pc->ui8RemoteRw = LLCP_RW_DEFAULT;
+      return pc;
+    }
+  }
+  return NULL;
+}
+
+// Connection PDUs from ui8RemoteSap to ui8LocalSap are for; the remote SAP is not known yet while connecting
+static struct llcp_connection *
+llcp_link_find_connection(nfc_llcp_link *link, const uint8_t ui8LocalSap, const uint8_t ui8RemoteSap)
+{
+  for (size_t n = 0; n < LLCP_MAX_CONNECTIONS; n++) {
+    struct llcp_connection *pc = &link->connections[n];
+    if ((pc->state == LLCP_CONNECTION_FREE) || (pc->ui8LocalSap != ui8LocalSap))
+      continue;
+    if ((pc->state == LLCP_CONNECTION_CONNECTING) || (pc->ui8RemoteSap == ui8RemoteSap))
+      return pc;
+  }
+  return NULL;
+}
+
+// Connection handle given to the application
+static struct llcp_connection *
+llcp_link_connection(nfc_llcp_link *link, const int connection)
+{
+  if ((connection < 0) || (connection >= LLCP_MAX_CONNECTIONS))
+    return NULL;
+  struct llcp_connection *pc = &link->connections[connection];
+  if ((pc->state == LLCP_CONNECTION_FREE) || !pc->bAccepted)
+    return NULL;
+  return pc;
+}
+
+// N(R) to send: SDUs are acknowledged once read by the application, so the receive queue never holds more than the window
+static uint8_t
+llcp_connection_nr(const struct llcp_connection *pc)
+{
+  return (pc->ui8Vr - pc->rx.szCount) & 0x0f;
+}
+
+static bool
+llcp_connection_ack(struct llcp_connection *pc, const uint8_t ui8Nr)
+{
+  if (((ui8Nr - pc->ui8Vsa) & 0x0f) > ((pc->ui8Vs - pc->ui8Vsa) & 0x0f))
+    return false;
+  pc->ui8Vsa = ui8Nr;
+  return true;
+}
+
+// Rejects an invalid PDU (FRMR), which terminates the connection
+static void
+llcp_connection_reject(nfc_llcp_link *link, struct llcp_connection *pc, const uint8_t btFlags, const uint8_t ui8Ptype,
+                       const uint8_t btSequence)
+{
+  const uint8_t abtInfo[] = {
+    btFlags | ui8Ptype,
+    btSequence,
+    (pc->ui8Vs << 4) | pc->ui8Vr,
+    (pc->ui8Vsa << 4) | pc->ui8Vra
+  };
+  log_put(LOG_CATEGORY, NFC_PRIORITY_DEBUG, "Connection %d:%d rejected a PDU type 0x%x (flags 0x%02x)",
+          pc->ui8LocalSap, pc->ui8RemoteSap, ui8Ptype, btFlags);
+  llcp_link_queue_pdu(link, pc->ui8RemoteSap, LLCP_PTYPE_FRMR, pc->ui8LocalSap, abtInfo, sizeof(abtInfo));
+  pc->state = LLCP_CONNECTION_DISCONNECTED;
+}
+
+static void
+llcp_link_connect_received(nfc_llcp_link *link, const uint8_t ui8Dsap, const uint8_t ui8Ssap, const uint8_t *pbtInfo,
+                           const size_t szInfo)
+{
+  char acServiceName[LLCP_SN_MAX_LEN + 1] = "";
+  nfc_llcp_params params = { .szMiu = LLCP_MIU_DEFAULT, .ui8Rw = LLCP_RW_DEFAULT };
+  llcp_params_decode(pbtInfo, szInfo, &params, NULL, acServiceName);
+
+  // CONNECT to the SDP SAP is resolved by service name
+  struct llcp_listener *pl = NULL;
+  for (size_t n = 0; (n < LLCP_MAX_LISTENERS) && !pl; n++) {
+    struct llcp_listener *plCandidate = &link->listeners[n];
+    if (!plCandidate->ui8Sap)
+      continue;
+    if (ui8Dsap == NFC_LLCP_SAP_SDP) {
+      if (acServiceName[0] && !strcmp(plCandidate->acServiceName, acServiceName))
+        pl = plCandidate;
+    } else if (plCandidate->ui8Sap == ui8Dsap) {
+      pl = plCandidate;
+    }
+  }
+  if (!pl) {
+    log_put(LOG_CATEGORY, NFC_PRIORITY_DEBUG, "CONNECT to %d (\"%s\") from %d: no such service", ui8Dsap, acServiceName, ui8Ssap);
+    llcp_link_queue_dm(link, ui8Ssap, ui8Dsap, LLCP_DM_NO_SERVICE);
+    return;
+  }
+  struct llcp_connection *pc = llcp_link_new_connection(link);
+  if (!pc) {
+    llcp_link_queue_dm(link, ui8Ssap, ui8Dsap, LLCP_DM_REJECTED);
+    return;
+  }
+  pc->state = LLCP_CONNECTION_CONNECTED;
+  pc->ui8LocalSap = pl->ui8Sap;
+  pc->ui8RemoteSap = ui8Ssap;
+  pc->szRemoteMiu = (params.szMiu < NFC_LLCP_MIU_MAX) ? params.szMiu : NFC_LLCP_MIU_MAX;
+  pc->ui8RemoteRw = params.ui8Rw;
+
+  uint8_t abtParams[8];
+  llcp_link_queue_pdu(link, pc->ui8RemoteSap, LLCP_PTYPE_CC, pc->ui8LocalSap, abtParams, llcp_connection_params(link, abtParams, NULL));
+  log_put(LOG_CATEGORY, NFC_PRIORITY_DEBUG, "Connection %d:%d accepted (remote MIU %d, RW %d)",
+          pc->ui8LocalSap, pc->ui8RemoteSap, (int) pc->szRemoteMiu, pc->ui8RemoteRw);
+}
+
+static int
+llcp_link_process_pdu(nfc_llcp_link *link, const uint8_t *pbtPdu, const size_t szPdu)
+{
+  if (szPdu < 2)
+    return NFC_SUCCESS;
+
+  const uint8_t ui8Dsap = pbtPdu[0] >> 2;
+  const uint8_t ui8Ptype = ((pbtPdu[0] & 0x03) << 2) | (pbtPdu[1] >> 6);
+  const uint8_t ui8Ssap = pbtPdu[1] & 0x3f;
+  const uint8_t *pbtInfo = pbtPdu + 2;
+  size_t szInfo = szPdu - 2;
+  struct llcp_connection *pc;
+  struct llcp_pdu *psdu;
+  int res;
+
+  switch (ui8Ptype) {
+    case LLCP_PTYPE_SYMM:
+      break;
+
+    case LLCP_PTYPE_AGF:
+      // Aggregated PDUs, each one preceded by its length
+      while (szInfo >= 2) {
+        const size_t szLen = (pbtInfo[0] << 8) | pbtInfo[1];
+        if (szLen + 2 > szInfo)
+          break;
+        if ((res = llcp_link_process_pdu(link, pbtInfo + 2, szLen)) < 0)
+          return res;
+        pbtInfo += 2 + szLen;
+        szInfo -= 2 + szLen;
+      }
+      break;
+
+    case LLCP_PTYPE_CONNECT:
+      llcp_link_connect_received(link, ui8Dsap, ui8Ssap, pbtInfo, szInfo);
+      break;
+
+    case LLCP_PTYPE_DISC:
+      if ((ui8Dsap == 0) && (ui8Ssap == 0)) {
+        log_put(LOG_CATEGORY, NFC_PRIORITY_INFO, "%s", "Link deactivated by remote LLC");
+        link->bActive = false;
+        return NFC_ETGRELEASED;
+      }
+      if ((pc = llcp_link_find_connection(link, ui8Dsap, ui8Ssap)) && (pc->state != LLCP_CONNECTION_CONNECTING)) {
+        llcp_link_queue_dm(link, ui8Ssap, ui8Dsap, LLCP_DM_DISCONNECTED);
+        pc->state = LLCP_CONNECTION_DISCONNECTED;
+      } else {
+        llcp_link_queue_dm(link, ui8Ssap, ui8Dsap, LLCP_DM_NO_CONNECTION);
+      }
+      break;
+
+    case LLCP_PTYPE_CC:
+      if ((pc = llcp_link_find_connection(link, ui8Dsap, ui8Ssap)) && (pc->state == LLCP_CONNECTION_CONNECTING)) {
+        nfc_llcp_params params = { .szMiu = LLCP_MIU_DEFAULT, .ui8Rw = LLCP_RW_DEFAULT };
+        llcp_params_decode(pbtInfo, szInfo, &params, NULL, NULL);
+        pc->ui8RemoteSap = ui8Ssap;
+        pc->szRemoteMiu = (params.szMiu < NFC_LLCP_MIU_MAX) ? params.szMiu : NFC_LLCP_MIU_MAX;
+        pc->ui8RemoteRw = params.ui8Rw;
+        pc->state = LLCP_CONNECTION_CONNECTED;
+      }
+      break;
+
+    case LLCP_PTYPE_DM:
+      if ((pc = llcp_link_find_connection(link, ui8Dsap, ui8Ssap))) {
+        pc->ui8Reason = (szInfo) ? pbtInfo[0] : LLCP_DM_DISCONNECTED;
+        pc->state = LLCP_CONNECTION_DISCONNECTED;
+      }
+      break;
+
+    case LLCP_PTYPE_FRMR:
+      if ((pc = llcp_link_find_connection(link, ui8Dsap, ui8Ssap)))
+        pc->state = LLCP_CONNECTION_DISCONNECTED;
+      break;
+
+    case LLCP_PTYPE_I:
+      pc = llcp_link_find_connection(link, ui8Dsap, ui8Ssap);
+      if (!pc || (pc->state == LLCP_CONNECTION_DISCONNECTED)) {
+        llcp_link_queue_dm(link, ui8Ssap, ui8Dsap, LLCP_DM_NO_CONNECTION);
+        break;
+      }
+      if ((pc->state != LLCP_CONNECTION_CONNECTED) || (szInfo < 1))
+        break;
+      if (szInfo - 1 > link->local.szMiu) {
+        llcp_connection_reject(link, pc, LLCP_FRMR_I, ui8Ptype, pbtInfo[0]);
+        break;
+      }
+      // Unread SDUs are not acknowledged yet: one more would exceed the receive window we advertised
+      if (((pbtInfo[0] >> 4) != pc->ui8Vr) || (pc->rx.szCount >= link->local.ui8Rw)) {
+        llcp_connection_reject(link, pc, LLCP_FRMR_S, ui8Ptype, pbtInfo[0]);
+        break;
+      }
+      if (!llcp_connection_ack(pc, pbtInfo[0] & 0x0f)) {
+        llcp_connection_reject(link, pc, LLCP_FRMR_R, ui8Ptype, pbtInfo[0]);
+        break;
+      }
+      psdu = llcp_queue_tail(&pc->rx);
+      psdu->szLen = szInfo - 1;
+      memcpy(psdu->abtData, pbtInfo + 1, psdu->szLen);
+      llcp_queue_push(&pc->rx);
+      pc->ui8Vr = (pc->ui8Vr + 1) & 0x0f;
+      break;
+
+    case LLCP_PTYPE_RR:
+    case LLCP_PTYPE_RNR:
+      pc = llcp_link_find_connection(link, ui8Dsap, ui8Ssap);
+      if (!pc || (pc->state == LLCP_CONNECTION_DISCONNECTED)) {
+        llcp_link_queue_dm(link, ui8Ssap, ui8Dsap, LLCP_DM_NO_CONNECTION);
+        break;
+      }
+      if ((pc->state == LLCP_CONNECTION_CONNECTING) || (szInfo < 1))
+        break;
+      if (!llcp_connection_ack(pc, pbtInfo[0] & 0x0f)) {
+        llcp_connection_reject(link, pc, LLCP_FRMR_R, ui8Ptype, pbtInfo[0]);
+        break;
+      }
+      pc->bRemoteBusy = (ui8Ptype == LLCP_PTYPE_RNR);
+      break;
+
+    default:
+      // Connection-less transport (UI), parameter exchange (PAX) and service discovery (SNL) are not supported
+      log_put(LOG_CATEGORY, NFC_PRIORITY_DEBUG, "Ignoring PDU type 0x%x from %d to %d", ui8Ptype, ui8Ssap, ui8Dsap);
+      break;
+  }
+  return NFC_SUCCESS;
+}
+
+// PDUs of a frame are laid out as AGF entries; a single one is unwrapped once the frame is complete.
+// AGF information field is bounded by the remote link MIU
+static bool
+llcp_frame_fits(const nfc_llcp_link *link, const size_t szUsed, const size_t szCount, const size_t szPdu)
+{
+  const size_t szMax = (link->remote.szMiu + 2 < LLCP_FRAME_MAX_LEN) ? link->remote.szMiu + 2 : LLCP_FRAME_MAX_LEN;
+  return (szCount == 0) || (szUsed + 2 + szPdu <= szMax);
+}
+
+static uint8_t *
+llcp_frame_append(uint8_t *pbtFrame, size_t *pszUsed, size_t *pszCount, const size_t szPdu)
+{
+  uint8_t *pbt = pbtFrame + *pszUsed;
+  pbt[0] = szPdu >> 8;
+  pbt[1] = szPdu & 0xff;
+  *pszUsed += 2 + szPdu;
+  (*pszCount)++;
+  return pbt + 2;
+}
+
+// Next frame to send: control PDUs, I PDUs allowed by the remote windows and acknowledgements, aggregated when there are several of them, SYMM otherwise
+static size_t
+llcp_link_build_frame(nfc_llcp_link *link, uint8_t *pbtFrame)
+{
+  size_t szUsed = 2;
+  size_t szCount = 0;
+  struct llcp_pdu *ppdu;
+
+  while ((ppdu = llcp_queue_head(&link->control)) && llcp_frame_fits(link, szUsed, szCount, ppdu->szLen)) {
+    memcpy(llcp_frame_append(pbtFrame, &szUsed, &szCount, ppdu->szLen), ppdu->abtData, ppdu->szLen);
+    llcp_queue_pop(&link->control);
+  }
+
+  // One I PDU per connection and per round, as long as windows and frame room allow
+  bool bProgress = true;
+  while (bProgress) {
+    bProgress = false;
+    for (size_t n = 0; n < LLCP_MAX_CONNECTIONS; n++) {
+      struct llcp_connection *pc = &link->connections[n];
+      if ((pc->state != LLCP_CONNECTION_CONNECTED) || pc->bRemoteBusy ||
+          (((pc->ui8Vs - pc->ui8Vsa) & 0x0f) >= pc->ui8RemoteRw) || !(ppdu = llcp_queue_head(&pc->tx)) ||
+          !llcp_frame_fits(link, szUsed, szCount, 3 + ppdu->szLen))
+        continue;
+      const uint8_t ui8Nr = llcp_connection_nr(pc);
+      uint8_t *pbt = llcp_frame_append(pbtFrame, &szUsed, &szCount, 3 + ppdu->szLen);
+      llcp_pdu_header(pbt, pc->ui8RemoteSap, LLCP_PTYPE_I, pc->ui8LocalSap);
+      pbt[2] = (pc->ui8Vs << 4) | ui8Nr;
+      memcpy(pbt + 3, ppdu->abtData, ppdu->szLen);
+      pc->ui8Vs = (pc->ui8Vs + 1) & 0x0f;
+      pc->ui8Vra = ui8Nr;
+      llcp_queue_pop(&pc->tx);
+      bProgress = true;
+    }
+  }
+
+  // Acknowledge SDUs read since the last N(R) sent
+  for (size_t n = 0; n < LLCP_MAX_CONNECTIONS; n++) {
+    struct llcp_connection *pc = &link->connections[n];
+    const uint8_t ui8Nr = llcp_connection_nr(pc);
+    if ((pc->state != LLCP_CONNECTION_CONNECTED) || (ui8Nr == pc->ui8Vra) || !llcp_frame_fits(link, szUsed, szCount, 3))
+      continue;
+    uint8_t *pbt = llcp_frame_append(pbtFrame, &szUsed, &szCount, 3);
+    llcp_pdu_header(pbt, pc->ui8RemoteSap, LLCP_PTYPE_RR, pc->ui8LocalSap);
+    pbt[2] = ui8Nr;
+    pc->ui8Vra = ui8Nr;
+  }
+
+  switch (szCount) {
+    case 0:
+      return llcp_pdu_header(pbtFrame, 0, LLCP_PTYPE_SYMM, 0);
+    case 1:
+      memmove(pbtFrame, pbtFrame + 4, szUsed - 4);
+      return szUsed - 4;
+    default:
+      llcp_pdu_header(pbtFrame, 0, LLCP_PTYPE_AGF, 0);
+      return szUsed;
+  }
+}
+
+static bool
+llcp_frame_is_symm(const uint8_t *pbtFrame, const size_t szFrame)
+{
+  return (szFrame == 2) && (pbtFrame[0] == 0x00) && (pbtFrame[1] == 0x00);
+}
+
+// Symmetry timer: while the link is idle the initiator holds its SYMM back, well within the local link timeout the target waits for it
+static void
+llcp_link_symm_delay(const nfc_llcp_link *link)
+{
+  const int iDelay = link->local.iLto / 4;
+  const struct timespec ts = { .tv_sec = iDelay / 1000, .tv_nsec = (iDelay % 1000) * 1000000L };
+  nanosleep(&ts, NULL);
+}
+
+// One frame each way: the initiator sends first, the target answers
+static int
+llcp_link_exchange(nfc_llcp_link *link)
+{
+  uint8_t abtTx[LLCP_FRAME_MAX_LEN + 4];
+  uint8_t abtRx[LLCP_RX_FRAME_MAX_LEN];
+  const int timeout = link->remote.iLto + LLCP_DEVICE_TIMEOUT_MARGIN;
+  size_t szTx;
+  int res;
+
+  if (!link->bActive)
+    return NFC_ETGRELEASED;
+
+  if (link->bInitiator) {
+    szTx = llcp_link_build_frame(link, abtTx);
+    if (link->bIdle && llcp_frame_is_symm(abtTx, szTx))
+      llcp_link_symm_delay(link);
+    if ((res = nfc_initiator_transceive_bytes(link->pnd, abtTx, szTx, abtRx, sizeof(abtRx), timeout)) < 0)
+      goto error;
+    link->bIdle = llcp_frame_is_symm(abtTx, szTx) && llcp_frame_is_symm(abtRx, res);
+    return llcp_link_process_pdu(link, abtRx, res);
+  }
+
+  if ((res = nfc_target_receive_bytes(link->pnd, abtRx, sizeof(abtRx), timeout)) < 0)
+    goto error;
+  if ((res = llcp_link_process_pdu(link, abtRx, res)) < 0)
+    return res;
+  szTx = llcp_link_build_frame(link, abtTx);
+  if ((res = nfc_target_send_bytes(link->pnd, abtTx, szTx, timeout)) < 0)
+    goto error;
+  return NFC_SUCCESS;
+
+error:
+  log_put(LOG_CATEGORY, NFC_PRIORITY_INFO, "Link lost (%s)", nfc_strerror(link->pnd));
+  link->bActive = false;
+  return res;
+}
+
+// Exchanges frames until condition is met; timeout in milliseconds, 0 to wait forever
+static int
+llcp_link_wait(nfc_llcp_link *link, llcp_condition condition, const void *arg, const int timeout)
+{
+  const int64_t deadline = monotonic_time_ms() + timeout;
+  int res;
+
+  while (!condition(link, arg)) {
+    if ((timeout > 0) && (monotonic_time_ms() >= deadline))
+      return NFC_ETIMEOUT;
+    if ((res = llcp_link_exchange(link)) < 0)
+      return res;
+  }
+  return NFC_SUCCESS;
+}
+
+// NFCID3 is random, from the system entropy source when there is one
+static void
+llcp_random_nfcid3(uint8_t *pbtNFCID3, const size_t szNFCID3)
+{
+  FILE *pf = fopen("/dev/urandom", "rb");
+  size_t szRead = 0;
+
+  if (pf) {
+    szRead = fread(pbtNFCID3, 1, szNFCID3, pf);
+    fclose(pf);
+  }
+  if (szRead == szNFCID3)
+    return;
+  // Otherwise a xorshift seeded with the clocks, which differs from one process to another
+  uint64_t ui64State = ((uint64_t) time(NULL) << 20) ^ (uint64_t) monotonic_time_us() ^ (uintptr_t) pbtNFCID3;
+  for (size_t n = 0; n < szNFCID3; n++) {
+    ui64State ^= ui64State << 13;
+    ui64State ^= ui64State >> 7;
+    ui64State ^= ui64State << 17;
+    pbtNFCID3[n] = ui64State >> 24;
+  }
+}
+
+static size_t
+llcp_link_general_bytes(const nfc_llcp_link *link, uint8_t *pbt)
+{
+  // LLC link management, and SDP which resolves CONNECT by service name
+  uint16_t ui16Wks = link->local.ui16Wks | 0x0001 | (1 << NFC_LLCP_SAP_SDP);
+  for (size_t n = 0; n < LLCP_MAX_LISTENERS; n++) {
+    if (link->listeners[n].ui8Sap && (link->listeners[n].ui8Sap < 16))
+      ui16Wks |= 1 << link->listeners[n].ui8Sap;
+  }
+
+  size_t sz = sizeof(llcp_magic);
+  memcpy(pbt, llcp_magic, sz);
+  sz += llcp_param_put(pbt + sz, LLCP_PARAM_VERSION, LLCP_VERSION, 1);
+  if (link->local.szMiu > LLCP_MIU_DEFAULT)
+    sz += llcp_param_put(pbt + sz, LLCP_PARAM_MIUX, link->local.szMiu - LLCP_MIU_DEFAULT, 2);
+  sz += llcp_param_put(pbt + sz, LLCP_PARAM_WKS, ui16Wks, 2);
+  sz += llcp_param_put(pbt + sz, LLCP_PARAM_LTO, link->local.iLto / 10, 1);
+  sz += llcp_param_put(pbt + sz, LLCP_PARAM_OPT, LLCP_OPT_LSC_CO, 1);
+  return sz;
+}
+
+// Link activation: the remote general bytes hold the LLCP magic number and link parameters
+static int
+llcp_link_activated(nfc_llcp_link *link, const uint8_t *pbtGB, const size_t szGB)
+{
+  uint8_t ui8Version = 0;
+
+  if ((szGB < sizeof(llcp_magic)) || memcmp(pbtGB, llcp_magic, sizeof(llcp_magic))) {
+    log_put(LOG_CATEGORY, NFC_PRIORITY_INFO, "%s", "Remote device does not support LLCP");
+    return NFC_ENOTSUCHDEV;
+  }
+  link->remote.szMiu = LLCP_MIU_DEFAULT;
+  link->remote.ui8Rw = LLCP_RW_DEFAULT;
+  link->remote.iLto = LLCP_LTO_DEFAULT;
+  link->remote.ui16Wks = 0;
+  llcp_params_decode(pbtGB + sizeof(llcp_magic), szGB - sizeof(llcp_magic), &link->remote, &ui8Version, NULL);
+  if ((ui8Version >> 4) != (LLCP_VERSION >> 4)) {
+    log_put(LOG_CATEGORY, NFC_PRIORITY_INFO, "Unsupported LLCP version %d.%d", ui8Version >> 4, ui8Version & 0x0f);
+    return NFC_EDEVNOTSUPP;
+  }
+
+  memset(&link->control, 0x00, sizeof(link->control));
+  memset(link->connections, 0x00, sizeof(link->connections));
+  link->bActive = true;
+  link->bIdle = false;
+  log_put(LOG_CATEGORY, NFC_PRIORITY_INFO, "Link activated as %s (version %d.%d, remote MIU %d, LTO %d ms)",
+          (link->bInitiator) ? "initiator" : "target", ui8Version >> 4, ui8Version & 0x0f,
+          (int) link->remote.szMiu, link->remote.iLto);
+  return NFC_SUCCESS;
+}
+
+static bool
+llcp_link_idle(const nfc_llcp_link *link, const void *arg)
+{
+  (void) arg;
+  return !link->control.szCount;
+}
+
+static bool
+llcp_connection_opened(const nfc_llcp_link *link, const void *arg)
+{
+  (void) link;
+  return ((const struct llcp_connection *) arg)->state != LLCP_CONNECTION_CONNECTING;
+}
+
+static bool
+llcp_connection_writable(const nfc_llcp_link *link, const void *arg)
+{
+  const struct llcp_connection *pc = arg;
+  (void) link;
+  return (pc->tx.szCount < LLCP_QUEUE_LEN) || (pc->state != LLCP_CONNECTION_CONNECTED);
+}
+
+static bool
+llcp_connection_readable(const nfc_llcp_link *link, const void *arg)
+{
+  const struct llcp_connection *pc = arg;
+  (void) link;
+  return pc->rx.szCount || (pc->state != LLCP_CONNECTION_CONNECTED);
+}
+
+static bool
+llcp_connection_flushed(const nfc_llcp_link *link, const void *arg)
+{
+  const struct llcp_connection *pc = arg;
+  (void) link;
+  return (!pc->tx.szCount && (pc->ui8Vsa == pc->ui8Vs)) || (pc->state != LLCP_CONNECTION_CONNECTED);
+}
+
+static bool
+llcp_connection_closed(const nfc_llcp_link *link, const void *arg)
+{
+  (void) link;
+  return ((const struct llcp_connection *) arg)->state != LLCP_CONNECTION_DISCONNECTING;
+}
+
+// Incoming connection to sap not returned yet by nfc_llcp_accept(), -1 if none
+static int
+llcp_link_pending_connection(const nfc_llcp_link *link, const uint8_t ui8Sap)
+{
+  for (int n = 0; n < LLCP_MAX_CONNECTIONS; n++) {
+    const struct llcp_connection *pc = &link->connections[n];
+    if ((pc->state != LLCP_CONNECTION_FREE) && (pc->state != LLCP_CONNECTION_CONNECTING) &&
+        !pc->bAccepted && (pc->ui8LocalSap == ui8Sap))
+      return n;
+  }
+  return -1;
+}
+
+static bool
+llcp_link_has_pending_connection(const nfc_llcp_link *link, const void *arg)
+{
+  return llcp_link_pending_connection(link, *(const uint8_t *) arg) >= 0;
+}
+
+/** @ingroup llcp
+ * @brief Allocate a LLCP link over a NFC device
+ * @return Returns a new link, or \e NULL when parameters are invalid or on allocation failure
+ *
+ * @param pnd \a nfc_device struct pointer that represent currently used device
+ * @param pnlpLocal local parameters, \e NULL for a MIU of \a NFC_LLCP_MIU_MAX, a receive window of 4 and a 500 ms link timeout
+ *
+ * The link is not active until nfc_llcp_link_activate_initiator() or
+ * nfc_llcp_link_activate_target() succeeds.
+ */
+nfc_llcp_link *
+nfc_llcp_link_new(nfc_device *pnd, const nfc_llcp_params *pnlpLocal)
+{
+  const nfc_llcp_params defaults = {
+    .szMiu = NFC_LLCP_MIU_MAX,
+    .ui8Rw = LLCP_LOCAL_RW_DEFAULT,
+    .iLto = LLCP_LOCAL_LTO_DEFAULT,
+    .ui16Wks = 0,
+  };
+  if (!pnlpLocal)
+    pnlpLocal = &defaults;
+  if ((pnlpLocal->szMiu < LLCP_MIU_DEFAULT) || (pnlpLocal->szMiu > NFC_LLCP_MIU_MAX) ||
+      (pnlpLocal->ui8Rw < 1) || (pnlpLocal->ui8Rw > NFC_LLCP_RW_MAX) ||
+      (pnlpLocal->iLto < 10) || (pnlpLocal->iLto > 2550))
+    return NULL;
+
+  nfc_llcp_link *link = calloc(1, sizeof(*link));
+  if (!link)
+    return NULL;
+  link->pnd = pnd;
+  link->local = *pnlpLocal;
+  return link;
+}
+
+/** @ingroup llcp
+ * @brief Free a LLCP link
+ *
+ * @param link \a nfc_llcp_link struct pointer, deactivate it first to let the remote LLC know
+ */
+void
+nfc_llcp_link_free(nfc_llcp_link *link)
+{
+  free(link);
+}
+
+/** @ingroup llcp
+ * @brief Activate a LLCP link as initiator
+ * @return Returns 0 on success, otherwise returns libnfc's error code (negative value)
+ *
+ * @param link \a nfc_llcp_link struct pointer, its device has to be initialised with nfc_initiator_init()
+ * @param ndm desired D.E.P. mode (\a NDM_ACTIVE or \a NDM_PASSIVE)
+ * @param nbr desired baud rate
+ * @param timeout in milliseconds
+ *
+ * The LLCP magic number and link parameters are exchanged in the general
+ * bytes of ATR_REQ and ATR_RES: \a NFC_ENOTSUCHDEV is returned when the
+ * selected D.E.P. target does not speak LLCP.
+ */
+int
+nfc_llcp_link_activate_initiator(nfc_llcp_link *link, const nfc_dep_mode ndm, const nfc_baud_rate nbr, const int timeout)
+{
+  nfc_dep_info ndi;
+  nfc_target nt;
+  int res;
+
+  memset(&ndi, 0x00, sizeof(ndi));
+  llcp_random_nfcid3(ndi.abtNFCID3, sizeof(ndi.abtNFCID3));
+  ndi.szGB = llcp_link_general_bytes(link, ndi.abtGB);
+
+  if ((res = nfc_initiator_select_dep_target(link->pnd, ndm, nbr, &ndi, &nt, timeout)) < 0)
+    return res;
+  if (res == 0)
+    return NFC_ENOTSUCHDEV;
+  link->bInitiator = true;
+  if ((res = llcp_link_activated(link, nt.nti.ndi.abtGB, nt.nti.ndi.szGB)) < 0) {
+    nfc_initiator_deselect_target(link->pnd);
+    return res;
+  }
+  return NFC_SUCCESS;
+}
+
+/** @ingroup llcp
+ * @brief Activate a LLCP link as target
+ * @return Returns 0 on success, otherwise returns libnfc's error code (negative value)
+ *
+ * @param link \a nfc_llcp_link struct pointer
+ * @param timeout in milliseconds, 0 to wait for an initiator forever
+ *
+ * Services the remote LLC may connect to have to be registered with
+ * nfc_llcp_listen() before activation, so that well-known ones are advertised.
+ */
+int
+nfc_llcp_link_activate_target(nfc_llcp_link *link, const int timeout)
+{
+  nfc_target nt;
+  uint8_t abtRx[LLCP_RX_FRAME_MAX_LEN];
+  int res;
+
+  memset(&nt, 0x00, sizeof(nt));
+  nt.nm.nmt = NMT_DEP;
+  nt.nm.nbr = NBR_UNDEFINED;
+  nt.nti.ndi.ndm = NDM_UNDEFINED;
+  llcp_random_nfcid3(nt.nti.ndi.abtNFCID3, sizeof(nt.nti.ndi.abtNFCID3));
+  nt.nti.ndi.szGB = llcp_link_general_bytes(link, nt.nti.ndi.abtGB);
+
+  if ((res = nfc_target_init(link->pnd, &nt, abtRx, sizeof(abtRx), timeout)) < 0)
+    return res;
+
+  // ATR_REQ, with or without its length byte: CMD0 CMD1 NFCID3i DIDi BSi BRi PPi Gi
+  const size_t szOffset = ((res > 0) && (abtRx[0] == 0xd4)) ? 0 : 1;
+  if (((size_t) res < szOffset + 16) || (abtRx[szOffset] != 0xd4) || (abtRx[szOffset + 1] != 0x00))
+    return NFC_ENOTSUCHDEV;
+  link->bInitiator = false;
+  return llcp_link_activated(link, abtRx + szOffset + 16, res - szOffset - 16);
+}
+
+/** @ingroup llcp
+ * @brief Deactivate a LLCP link
+ * @return Returns 0 on success, otherwise returns libnfc's error code (negative value)
+ *
+ * @param link \a nfc_llcp_link struct pointer
+ *
+ * The remote LLC is told (DISC on SAP 0), connections are dropped.
+ */
+int
+nfc_llcp_link_deactivate(nfc_llcp_link *link)
+{
+  int res;
+
+  if (!link->bActive)
+    return NFC_SUCCESS;
+  if ((res = llcp_link_queue_pdu(link, 0, LLCP_PTYPE_DISC, 0, NULL, 0)) >= 0)
+    res = llcp_link_wait(link, llcp_link_idle, NULL, link->remote.iLto + LLCP_DEVICE_TIMEOUT_MARGIN);
+  link->bActive = false;
+  memset(link->connections, 0x00, sizeof(link->connections));
+  if (link->bInitiator)
+    nfc_initiator_deselect_target(link->pnd);
+  return (res == NFC_ETGRELEASED) ? NFC_SUCCESS : res;
+}
+
+/** @ingroup llcp
+ * @brief Get remote LLC's link parameters
+ * @return Returns 0 on success, otherwise returns libnfc's error code (negative value)
+ *
+ * @param link \a nfc_llcp_link struct pointer
+ * @param[out] pnlpRemote remote MIU, link timeout and well-known services (receive window is negotiated per connection)
+ */
+int
+nfc_llcp_link_get_remote_params(const nfc_llcp_link *link, nfc_llcp_params *pnlpRemote)
+{
+  if (!link->bActive)
+    return NFC_ETGRELEASED;
+  *pnlpRemote = link->remote;
+  return NFC_SUCCESS;
+}
+
+/** @ingroup llcp
+ * @brief Keep the link up
+ * @return Returns 0 on success, otherwise returns libnfc's error code (negative value)
+ *
+ * @param link \a nfc_llcp_link struct pointer
+ * @param timeout in milliseconds during which frames are exchanged, 0 for a single exchange
+ *
+ * Queued SDUs are sent, incoming connections and SDUs are queued. The remote
+ * LLC drops the link when it does not hear from this one within the local
+ * link timeout: this function has to be called when the application has
+ * nothing else to do on the link.
+ */
+int
+nfc_llcp_link_service(nfc_llcp_link *link, const int timeout)
+{
+  const int64_t deadline = monotonic_time_ms() + timeout;
+  int res;
+
+  do {
+    if ((res = llcp_link_exchange(link)) < 0)
+      return res;
+  } while (monotonic_time_ms() < deadline);
+  return NFC_SUCCESS;
+}
+
+/** @ingroup llcp
+ * @brief Accept connections on a local SAP
+ * @return Returns 0 on success, otherwise returns libnfc's error code (negative value)
+ *
+ * @param link \a nfc_llcp_link struct pointer
+ * @param sap local SAP: a well-known one (2 to 15) or 16 to 31 for a service reachable by name only
+ * @param service_name name of the service (ie. "urn:nfc:sn:snep") to resolve connections by name, \e NULL if none
+ *
+ * Incoming connections are confirmed as they arrive, nfc_llcp_accept() returns them.
+ */
+int
+nfc_llcp_listen(nfc_llcp_link *link, const uint8_t sap, const char *service_name)
+{
+  struct llcp_listener *pl = NULL;
+
+  if ((sap < 2) || (sap >= LLCP_SAP_DYNAMIC_FIRST) || (service_name && (strlen(service_name) > LLCP_SN_MAX_LEN)))
+    return NFC_EINVARG;
+  for (size_t n = 0; n < LLCP_MAX_LISTENERS; n++) {
+    if (link->listeners[n].ui8Sap == sap)
+      return NFC_EINVARG;
+    if (!link->listeners[n].ui8Sap && !pl)
+      pl = &link->listeners[n];
+  }
+  if (!pl)
+    return NFC_ESOFT;
+  pl->ui8Sap = sap;
+  strcpy(pl->acServiceName, (service_name) ? service_name : "");
+  return NFC_SUCCESS;
+}
+
+/** @ingroup llcp
+ * @brief Wait for an incoming connection
+ * @return Returns a connection handle (positive or null value), otherwise returns libnfc's error code (negative value)
+ *
+ * @param link \a nfc_llcp_link struct pointer
+ * @param sap local SAP given to nfc_llcp_listen()
+ * @param timeout in milliseconds, 0 to wait forever
+ */
+int
+nfc_llcp_accept(nfc_llcp_link *link, const uint8_t sap, const int timeout)
+{
+  int res;
+
+  if ((res = llcp_link_wait(link, llcp_link_has_pending_connection, &sap, timeout)) < 0)
+    return res;
+  const int connection = llcp_link_pending_connection(link, sap);
+  link->connections[connection].bAccepted = true;
+  return connection;
+}
+
+/** @ingroup llcp
+ * @brief Open a connection to a remote service
+ * @return Returns a connection handle (positive or null value), otherwise returns libnfc's error code (negative value)
+ *
+ * @param link \a nfc_llcp_link struct pointer
+ * @param sap remote SAP, ignored when \a service_name is given
+ * @param service_name name of the remote service (ie. "urn:nfc:sn:snep"), resolved by the remote LLC; \e NULL to connect by SAP
+ * @param timeout in milliseconds, 0 to wait forever
+ *
+ * MIU and receive window of both sides are exchanged in CONNECT and CC.
+ * \a NFC_ENOTSUCHDEV is returned when the remote LLC refuses the connection.
+ */
+int
+nfc_llcp_connect(nfc_llcp_link *link, const uint8_t sap, const char *service_name, const int timeout)
+{
+  uint8_t abtParams[10 + LLCP_SN_MAX_LEN];
+  uint8_t ui8LocalSap;
+  int res;
+
+  if (service_name ? (strlen(service_name) > LLCP_SN_MAX_LEN) : ((sap < 2) || (sap > LLCP_SAP_DYNAMIC_LAST)))
+    return NFC_EINVARG;
+  if (!link->bActive)
+    return NFC_ETGRELEASED;
+
+  for (ui8LocalSap = LLCP_SAP_DYNAMIC_FIRST; ui8LocalSap <= LLCP_SAP_DYNAMIC_LAST; ui8LocalSap++) {
+    size_t n;
+    for (n = 0; n < LLCP_MAX_CONNECTIONS; n++) {
+      if ((link->connections[n].state != LLCP_CONNECTION_FREE) && (link->connections[n].ui8LocalSap == ui8LocalSap))
+        break;
+    }
+    if (n == LLCP_MAX_CONNECTIONS)
+      break;
+  }
+  struct llcp_connection *pc = llcp_link_new_connection(link);
+  if (!pc || (ui8LocalSap > LLCP_SAP_DYNAMIC_LAST))
+    return NFC_ESOFT;
+  pc->state = LLCP_CONNECTION_CONNECTING;
+  pc->ui8LocalSap = ui8LocalSap;
+  pc->ui8RemoteSap = (service_name) ? NFC_LLCP_SAP_SDP : sap;
+
+  if ((res = llcp_link_queue_pdu(link, pc->ui8RemoteSap, LLCP_PTYPE_CONNECT, pc->ui8LocalSap,
+                                 abtParams, llcp_connection_params(link, abtParams, service_name))) < 0 ||
+      (res = llcp_link_wait(link, llcp_connection_opened, pc, timeout)) < 0) {
+    pc->state = LLCP_CONNECTION_FREE;
+    return res;
+  }
+  if (pc->state != LLCP_CONNECTION_CONNECTED) {
+    log_put(LOG_CATEGORY, NFC_PRIORITY_DEBUG, "Connection refused (reason 0x%02x)", pc->ui8Reason);
+    pc->state = LLCP_CONNECTION_FREE;
+    return NFC_ENOTSUCHDEV;
+  }
+  log_put(LOG_CATEGORY, NFC_PRIORITY_DEBUG, "Connection %d:%d opened (remote MIU %d, RW %d)",
+          pc->ui8LocalSap, pc->ui8RemoteSap, (int) pc->szRemoteMiu, pc->ui8RemoteRw);
+  pc->bAccepted = true;
+  return pc - link->connections;
+}
+
+/** @ingroup llcp
+ * @brief Send data over a connection
+ * @return Returns queued bytes count on success, otherwise returns libnfc's error code (negative value)
+ *
+ * @param link \a nfc_llcp_link struct pointer
+ * @param connection connection handle
+ * @param pbtTx data to send, split into SDUs of the remote MIU
+ * @param szTx data length
+ * @param timeout in milliseconds to wait for room in the send queue, 0 to wait forever
+ *
+ * SDUs are queued and sent, as many at once as the remote receive window
+ * allows, by the following exchanges on the link. \a NFC_ETGRELEASED is
+ * returned when the connection has been closed by the remote LLC.
+ */
+int
+nfc_llcp_send(nfc_llcp_link *link, const int connection, const uint8_t *pbtTx, const size_t szTx, const int timeout)
+{
+  struct llcp_connection *pc = llcp_link_connection(link, connection);
+  size_t szSent = 0;
+  int res;
+
+  if (!pc)
+    return NFC_EINVARG;
+  do {
+    if ((res = llcp_link_wait(link, llcp_connection_writable, pc, timeout)) < 0)
+      return res;
+    if (pc->state != LLCP_CONNECTION_CONNECTED)
+      return NFC_ETGRELEASED;
+    struct llcp_pdu *psdu = llcp_queue_tail(&pc->tx);
+    psdu->szLen = (szTx - szSent < pc->szRemoteMiu) ? szTx - szSent : pc->szRemoteMiu;
+    memcpy(psdu->abtData, pbtTx + szSent, psdu->szLen);
+    llcp_queue_push(&pc->tx);
+    szSent += psdu->szLen;
+  } while (szSent < szTx);
+  return szTx;
+}
+
+/** @ingroup llcp
+ * @brief Receive a SDU from a connection
+ * @return Returns received bytes count, 0 when the connection has been closed by the remote LLC, otherwise returns libnfc's error code (negative value)
+ *
+ * @param link \a nfc_llcp_link struct pointer
+ * @param connection connection handle
+ * @param[out] pbtRx buffer for the SDU
+ * @param szRx size of \a pbtRx, \a NFC_EOVFLOW is returned (and the SDU kept) when too small for the SDU
+ * @param timeout in milliseconds, 0 to wait forever
+ */
+int
+nfc_llcp_receive(nfc_llcp_link *link, const int connection, uint8_t *pbtRx, const size_t szRx, const int timeout)
+{
+  struct llcp_connection *pc = llcp_link_connection(link, connection);
+  struct llcp_pdu *psdu;
+  int res;
+
+  if (!pc)
+    return NFC_EINVARG;
+  if ((res = llcp_link_wait(link, llcp_connection_readable, pc, timeout)) < 0)
+    return res;
+  if (!(psdu = llcp_queue_head(&pc->rx)))
+    return 0;
+  if (psdu->szLen > szRx)
+    return NFC_EOVFLOW;
+  memcpy(pbtRx, psdu->abtData, psdu->szLen);
+  res = psdu->szLen;
+  llcp_queue_pop(&pc->rx);
+  return res;
+}
+
+/** @ingroup llcp
+ * @brief Close a connection
+ * @return Returns 0 on success, otherwise returns libnfc's error code (negative value)
+ *
+ * @param link \a nfc_llcp_link struct pointer
+ * @param connection connection handle, released whatever the result
+ * @param timeout in milliseconds to wait for queued SDUs to be acknowledged and for the remote LLC to confirm, 0 to wait forever
+ */
+int
+nfc_llcp_close(nfc_llcp_link *link, const int connection, const int timeout)
+{
+  struct llcp_connection *pc = llcp_link_connection(link, connection);
+  int res = NFC_SUCCESS;
+
+  if (!pc)
+    return NFC_EINVARG;
+  if (pc->state == LLCP_CONNECTION_CONNECTED)
+    res = llcp_link_wait(link, llcp_connection_flushed, pc, timeout);
+  if ((res >= 0) && (pc->state == LLCP_CONNECTION_CONNECTED)) {
+    if ((res = llcp_link_queue_pdu(link, pc->ui8RemoteSap, LLCP_PTYPE_DISC, pc->ui8LocalSap, NULL, 0)) >= 0) {
+      pc->state = LLCP_CONNECTION_DISCONNECTING;
+      res = llcp_link_wait(link, llcp_connection_closed, pc, timeout);
+    }
+  }
+  pc->state = LLCP_CONNECTION_FREE;
+  return (res < 0) ? res : NFC_SUCCESS;
+}
@@ -0,0 +1,239 @@
+/*-
+ * Public platform independent Near Field Communication (NFC) library
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/**
+* @file nfc-mfclassic.c
+* @brief Provide a small API to read MIFARE Classic tags sector by sector
+*/
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <string.h>
+
+#include <nfc/nfc.h>
+#include <nfc/nfc-mfclassic.h>
+
+#include "nfc-internal.h"
+
+#define LOG_CATEGORY "libnfc.mfclassic"
+
+// Commands
+#define MFCLASSIC_READ  0x30
+
+// Sectors 0 to 31 have 4 blocks, sectors 32 to 39 (4K) have 16 blocks
+#define MFCLASSIC_SMALL_SECTORS  32
+
+/** @ingroup initiator
+ * @brief Get the first block of a MIFARE Classic sector
+ * @return Returns the block number
+ *
+ * @param ui8Sector sector number
+ */
+size_t
+nfc_mfclassic_sector_first_block(const uint8_t ui8Sector)
+{
+  if (ui8Sector < MFCLASSIC_SMALL_SECTORS)
+    return ui8Sector * 4;
+  return MFCLASSIC_SMALL_SECTORS * 4 + (ui8Sector - MFCLASSIC_SMALL_SECTORS) * 16;
+}
+
+/** @ingroup initiator
+ * @brief Get the number of blocks of a MIFARE Classic sector, trailer included
+ * @return Returns the number of blocks
+ *
+ * @param ui8Sector sector number
+ */
+size_t
+nfc_mfclassic_sector_blocks(const uint8_t ui8Sector)
+{
+  return (ui8Sector < MFCLASSIC_SMALL_SECTORS) ? 4 : 16;
+}
+
+static bool
+mfclassic_key_equal(const nfc_mfclassic_key *pmk1, const nfc_mfclassic_key *pmk2)
+{
+  return (pmk1->mkt == pmk2->mkt) && !memcmp(pmk1->abtKey, pmk2->abtKey, NFC_MFCLASSIC_KEY_LEN);
+}
+
+// Entry of the card in cache, -1 when unknown
+static int
+mfclassic_key_cache_find(const nfc_mfclassic_key_cache *pmkc, const nfc_target *pnt)
+{
+  for (int n = 0; n < NFC_MFCLASSIC_KEY_CACHE_CARDS; n++) {
+    if (pmkc->acard[n].ui8UidLen && (pmkc->acard[n].ui8UidLen == pnt->nti.nai.szUidLen) &&
+        !memcmp(pmkc->acard[n].abtUid, pnt->nti.nai.abtUid, pnt->nti.nai.szUidLen))
+      return n;
+  }
+  return -1;
+}
+
+// Takes the oldest entry of cache for a new card
+static int
+mfclassic_key_cache_add(nfc_mfclassic_key_cache *pmkc, const nfc_target *pnt)
+{
+  const int n = pmkc->ui8Next % NFC_MFCLASSIC_KEY_CACHE_CARDS;
+  pmkc->ui8Next = (n + 1) % NFC_MFCLASSIC_KEY_CACHE_CARDS;
+  memset(&pmkc->acard[n], 0x00, sizeof(pmkc->acard[n]));
+  memcpy(pmkc->acard[n].abtUid, pnt->nti.nai.abtUid, pnt->nti.nai.szUidLen);
+  pmkc->acard[n].ui8UidLen = pnt->nti.nai.szUidLen;
+  return n;
+}
+
+// AUTH: key type, block, key then the 4 last bytes of UID. A failed AUTH halts the card (NFC_ETGRELEASED)
+static int
+mfclassic_auth(nfc_device *pnd, const nfc_target *pnt, const nfc_mfclassic_key *pmk, const size_t szBlock)
+{
+  uint8_t abtCmd[2 + NFC_MFCLASSIC_KEY_LEN + 4] = { pmk->mkt, szBlock };
+
+  memcpy(abtCmd + 2, pmk->abtKey, NFC_MFCLASSIC_KEY_LEN);
+  memcpy(abtCmd + 2 + NFC_MFCLASSIC_KEY_LEN, pnt->nti.nai.abtUid + pnt->nti.nai.szUidLen - 4, 4);
+  return nfc_initiator_transceive_bytes(pnd, abtCmd, sizeof(abtCmd), NULL, 0, -1);
+}
+
+// Opens a sector with the first key which works: cached one, sector ones, then dictionary
+static int
+mfclassic_open_sector(nfc_device *pnd, nfc_target *pnt, const nfc_mfclassic_keymap *pmkm, nfc_mfclassic_key *pmkCached,
+                      const uint8_t ui8Sector, bool *pbHalted, nfc_mfclassic_key *pmkOpened)
+{
+  const nfc_modulation nm = { .nmt = NMT_ISO14443A, .nbr = NBR_106 };
+  const size_t szBlock = nfc_mfclassic_sector_first_block(ui8Sector);
+  const size_t szKeys = 1 + 2 + pmkm->szDictionary;
+  int res;
+
+  for (size_t n = 0; n < szKeys; n++) {
+    const nfc_mfclassic_key *pmk;
+    if (n == 0)
+      pmk = pmkCached;
+    else if (n < 3)
+      pmk = &pmkm->amkSector[ui8Sector][n - 1];
+    else
+      pmk = &pmkm->pmkDictionary[n - 3];
+    if ((pmk->mkt == NFC_MFCLASSIC_KEY_NONE) || ((n > 0) && mfclassic_key_equal(pmk, pmkCached)))
+      continue;
+
+    // Card has to be selected again after a failed AUTH
+    if (*pbHalted) {
+      if ((res = nfc_initiator_select_passive_target(pnd, nm, pnt->nti.nai.abtUid, pnt->nti.nai.szUidLen, pnt)) < 0)
+        return res;
+      if (res == 0) {
+        pnd->last_error = NFC_ETGRELEASED;
+        return pnd->last_error;
+      }
+      *pbHalted = false;
+    }
+
+    if ((res = mfclassic_auth(pnd, pnt, pmk, szBlock)) >= 0) {
+      log_put(LOG_CATEGORY, NFC_PRIORITY_DEBUG, "Sector %d opened with key %c (%s)", ui8Sector,
+              (pmk->mkt == NFC_MFCLASSIC_KEY_A) ? 'A' : 'B', (n == 0) ? "cached" : ((n < 3) ? "sector" : "dictionary"));
+      *pmkOpened = *pmk;
+      return NFC_SUCCESS;
+    }
+    if ((res != NFC_ETGRELEASED) && (res != NFC_ERFTRANS))
+      return res;
+    *pbHalted = true;
+    // Cached key does not work anymore
+    if (n == 0)
+      pmkCached->mkt = NFC_MFCLASSIC_KEY_NONE;
+  }
+  log_put(LOG_CATEGORY, NFC_PRIORITY_ERROR, "No key opens sector %d", ui8Sector);
+  pnd->last_error = NFC_ETGRELEASED;
+  return pnd->last_error;
+}
+
+/** @ingroup initiator
+ * @brief Read sectors of a MIFARE Classic tag
+ * @return Returns read bytes count on success, otherwise returns libnfc's error code (negative value)
+ *
+ * @param pnd \a nfc_device struct pointer that represent currently used device
+ * @param pnt selected ISO14443-A target, updated when it has to be selected again
+ * @param pmkm keys to try on each sector, NULL to read without authentication (unlocked cards)
+ * @param pmkc cache of keys which opened sectors of a card, tried first and updated, may be NULL
+ * @param ui8FirstSector first sector to read
+ * @param szSectors number of sectors to read
+ * @param[out] pbtData buffer of all blocks of the sectors, from first block of \a ui8FirstSector
+ * @param[out] pmkOpened key which opened each sector, may be NULL
+ *
+ * Each sector is authenticated once then its blocks are read back to back: a
+ * 4K tag whose keys are known (or cached) is read in 40 AUTH and 256 READ
+ * commands. Since a failed AUTH halts the card, it is selected again before
+ * the next key is tried. \a NFC_ETGRELEASED is returned when no key opens a
+ * sector.
+ */
+int
+nfc_mfclassic_read_sectors(nfc_device *pnd, nfc_target *pnt, const nfc_mfclassic_keymap *pmkm, nfc_mfclassic_key_cache *pmkc,
+                           const uint8_t ui8FirstSector, const size_t szSectors, uint8_t *pbtData, nfc_mfclassic_key *pmkOpened)
+{
+  const bool bEasyFraming = pnd->bEasyFraming;
+  nfc_mfclassic_key mkNone = { .mkt = NFC_MFCLASSIC_KEY_NONE };
+  int iCard = -1;
+  bool bHalted = false;
+  size_t szRead = 0;
+  int res;
+
+  if ((pnt->nm.nmt != NMT_ISO14443A) || (pnt->nti.nai.szUidLen < 4) || (ui8FirstSector + szSectors > NFC_MFCLASSIC_MAX_SECTORS)) {
+    pnd->last_error = NFC_EINVARG;
+    return pnd->last_error;
+  }
+  if (pmkc)
+    iCard = mfclassic_key_cache_find(pmkc, pnt);
+
+  if ((res = nfc_device_set_property_bool(pnd, NP_EASY_FRAMING, true)) < 0)
+    return res;
+
+  for (uint8_t ui8Sector = ui8FirstSector; ui8Sector < ui8FirstSector + szSectors; ui8Sector++) {
+    const size_t szFirstBlock = nfc_mfclassic_sector_first_block(ui8Sector);
+    const size_t szBlocks = nfc_mfclassic_sector_blocks(ui8Sector);
+    nfc_mfclassic_key mkOpened = { .mkt = NFC_MFCLASSIC_KEY_NONE };
+
+    if (pmkm) {
+      nfc_mfclassic_key *pmkCached = (iCard >= 0) ? &pmkc->acard[iCard].amkSector[ui8Sector] : &mkNone;
+      if ((res = mfclassic_open_sector(pnd, pnt, pmkm, pmkCached, ui8Sector, &bHalted, &mkOpened)) < 0)
+        break;
+      if (pmkc && !mfclassic_key_equal(&mkOpened, pmkCached)) {
+        if (iCard < 0)
+          iCard = mfclassic_key_cache_add(pmkc, pnt);
+        pmkc->acard[iCard].amkSector[ui8Sector] = mkOpened;
+      }
+    }
+    if (pmkOpened)
+      pmkOpened[ui8Sector - ui8FirstSector] = mkOpened;
+
+    // READ returns a single block, received straight into caller's buffer
+    for (size_t szBlock = szFirstBlock; szBlock < szFirstBlock + szBlocks; szBlock++) {
+      const uint8_t abtCmd[] = { MFCLASSIC_READ, szBlock };
+      if ((res = nfc_initiator_transceive_bytes(pnd, abtCmd, sizeof(abtCmd), pbtData + szRead, NFC_MFCLASSIC_BLOCK_LEN, -1)) < 0)
+        break;
+      if (res != NFC_MFCLASSIC_BLOCK_LEN) {
+        pnd->last_error = NFC_ERFTRANS;
+        res = pnd->last_error;
+        break;
+      }
+      szRead += NFC_MFCLASSIC_BLOCK_LEN;
+    }
+    if (res < 0)
+      break;
+  }
+
+  const int res2 = nfc_device_set_property_bool(pnd, NP_EASY_FRAMING, bEasyFraming);
+  if (res < 0)
+    return res;
+  if (res2 < 0)
+    return res2;
+  return szRead;
+}
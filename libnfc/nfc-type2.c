@@ -0,0 +1,190 @@
+/*-
+ * Public platform independent Near Field Communication (NFC) library
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/**
+* @file nfc-type2.c
+* @brief Provide a small API to read NFC Forum Type 2 tags (MIFARE Ultralight, NTAG)
+*/
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <string.h>
+
+#include <nfc/nfc.h>
+#include <nfc/nfc-type2.h>
+
+#include "nfc-internal.h"
+#include "chips/pn53x-internal.h"
+
+#define LOG_CATEGORY "libnfc.type2"
+
+// Commands
+#define TYPE2_READ         0x30
+#define TYPE2_FAST_READ    0x3a
+#define TYPE2_GET_VERSION  0x60
+
+// READ returns 4 pages
+#define TYPE2_READ_PAGES   4
+// Largest FAST_READ response fitting in a PN53x normal frame (less response code and status), CRC being removed by the chip
+#define TYPE2_FAST_READ_MAX_PAGES  ((PN53x_NORMAL_FRAME__DATA_MAX_LEN - 2) / NFC_TYPE2_PAGE_LEN)
+// Tags without GET_VERSION are taken as original MIFARE Ultralight
+#define TYPE2_ULTRALIGHT_PAGES  16
+
+// GET_VERSION product types
+#define TYPE2_PRODUCT_ULTRALIGHT  0x03
+#define TYPE2_PRODUCT_NTAG        0x04
+
+// Pages of known products by GET_VERSION product type and storage size: MIFARE Ultralight EV1 and NTAG21x,
+// products of different types may share a storage size
+static const struct {
+  uint8_t ui8ProductType;
+  uint8_t ui8StorageSize;
+  size_t  szPages;
+} type2_storage_pages[] = {
+  { TYPE2_PRODUCT_ULTRALIGHT, 0x0b, 20 },   // MF0UL11
+  { TYPE2_PRODUCT_ULTRALIGHT, 0x0e, 41 },   // MF0UL21
+  { TYPE2_PRODUCT_NTAG, 0x0b, 20 },         // NTAG210
+  { TYPE2_PRODUCT_NTAG, 0x0e, 41 },         // NTAG212, CFG0 to PACK are pages 0x25 to 0x28
+  { TYPE2_PRODUCT_NTAG, 0x0f, 45 },         // NTAG213
+  { TYPE2_PRODUCT_NTAG, 0x11, 135 },        // NTAG215
+  { TYPE2_PRODUCT_NTAG, 0x13, 231 },        // NTAG216
+};
+
+static size_t
+type2_pages(const uint8_t ui8ProductType, const uint8_t ui8StorageSize)
+{
+  for (size_t n = 0; n < sizeof(type2_storage_pages) / sizeof(type2_storage_pages[0]); n++) {
+    if ((type2_storage_pages[n].ui8ProductType == ui8ProductType) && (type2_storage_pages[n].ui8StorageSize == ui8StorageSize))
+      return type2_storage_pages[n].szPages;
+  }
+  // Storage size: user memory is 2^(n/2) bytes, or between 2^(n/2) and 2^(n/2 + 1) when n is odd; 4 pages of header
+  size_t szPages = 4 + ((size_t) 1 << (ui8StorageSize >> 1)) / NFC_TYPE2_PAGE_LEN;
+  return (szPages > NFC_TYPE2_MAX_PAGES) ? NFC_TYPE2_MAX_PAGES : szPages;
+}
+
+// Commands are sent as raw frames, CRC_A being handled by the device
+static int
+type2_transceive(nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx, uint8_t *pbtRx, const size_t szRx)
+{
+  const bool bEasyFraming = pnd->bEasyFraming;
+  const bool bCrc = pnd->bCrc;
+  int res;
+
+  if ((res = nfc_device_set_raw_mode(pnd, false, true)) < 0)
+    return res;
+  res = nfc_initiator_transceive_bytes(pnd, pbtTx, szTx, pbtRx, szRx, -1);
+  const int res2 = nfc_device_set_raw_mode(pnd, bEasyFraming, bCrc);
+  return (res < 0) ? res : ((res2 < 0) ? res2 : res);
+}
+
+/** @ingroup initiator
+ * @brief Identify a Type 2 tag
+ * @return Returns 0 on success, otherwise returns libnfc's error code (negative value)
+ *
+ * @param pnd \a nfc_device struct pointer that represent currently used device
+ * @param pnt selected ISO14443-A target, updated when it has to be selected again
+ * @param[out] pnti tag identification
+ *
+ * Tags answering GET_VERSION (MIFARE Ultralight EV1, NTAG) are sized from
+ * their storage size and read with FAST_READ. Other ones (original MIFARE
+ * Ultralight) ignore the command and go back to idle state: they are
+ * selected again and taken as 16 pages tags, \e szPages may be raised by the
+ * caller for bigger ones (ie. 48 pages of MIFARE Ultralight C).
+ */
+int
+nfc_type2_identify(nfc_device *pnd, nfc_target *pnt, nfc_type2_info *pnti)
+{
+  const uint8_t abtCmd[] = { TYPE2_GET_VERSION };
+  const nfc_modulation nm = { .nmt = NMT_ISO14443A, .nbr = NBR_106 };
+  int res;
+
+  memset(pnti, 0x00, sizeof(*pnti));
+  if (pnt->nm.nmt != NMT_ISO14443A) {
+    pnd->last_error = NFC_EINVARG;
+    return pnd->last_error;
+  }
+
+  if ((res = type2_transceive(pnd, abtCmd, sizeof(abtCmd), pnti->abtVersion, sizeof(pnti->abtVersion))) == sizeof(pnti->abtVersion)) {
+    pnti->bFastRead = true;
+    pnti->szPages = type2_pages(pnti->abtVersion[2], pnti->abtVersion[6]);
+    log_put(LOG_CATEGORY, NFC_PRIORITY_DEBUG, "Product type 0x%02x, storage size 0x%02x: %d pages",
+            pnti->abtVersion[2], pnti->abtVersion[6], (int) pnti->szPages);
+    return NFC_SUCCESS;
+  }
+
+  memset(pnti->abtVersion, 0x00, sizeof(pnti->abtVersion));
+  if ((res = nfc_initiator_select_passive_target(pnd, nm, pnt->nti.nai.abtUid, pnt->nti.nai.szUidLen, pnt)) < 0)
+    return res;
+  if (res == 0) {
+    pnd->last_error = NFC_ETGRELEASED;
+    return pnd->last_error;
+  }
+  pnti->szPages = TYPE2_ULTRALIGHT_PAGES;
+  return NFC_SUCCESS;
+}
+
+/** @ingroup initiator
+ * @brief Read pages of a Type 2 tag
+ * @return Returns read bytes count on success, otherwise returns libnfc's error code (negative value)
+ *
+ * @param pnd \a nfc_device struct pointer that represent currently used device
+ * @param pnti tag identification from nfc_type2_identify()
+ * @param ui8FirstPage first page to read
+ * @param[out] pbtData buffer of \a szPages pages
+ * @param szPages number of pages to read, up to the end of the tag memory
+ *
+ * With FAST_READ, each command reads as many pages as a PN53x frame holds (63
+ * pages): a whole NTAG216 is read in 4 commands. Otherwise pages are read 4
+ * by 4 with READ.
+ */
+int
+nfc_type2_read(nfc_device *pnd, const nfc_type2_info *pnti, const uint8_t ui8FirstPage, uint8_t *pbtData, const size_t szPages)
+{
+  uint8_t abtRx[TYPE2_FAST_READ_MAX_PAGES * NFC_TYPE2_PAGE_LEN];
+  size_t szPage = ui8FirstPage;
+  const size_t szEnd = ui8FirstPage + szPages;
+  int res;
+
+  if (szEnd > pnti->szPages) {
+    pnd->last_error = NFC_EINVARG;
+    return pnd->last_error;
+  }
+
+  while (szPage < szEnd) {
+    size_t szChunk;
+    if (pnti->bFastRead) {
+      szChunk = ((szEnd - szPage) < TYPE2_FAST_READ_MAX_PAGES) ? (szEnd - szPage) : TYPE2_FAST_READ_MAX_PAGES;
+      const uint8_t abtCmd[] = { TYPE2_FAST_READ, szPage, szPage + szChunk - 1 };
+      res = type2_transceive(pnd, abtCmd, sizeof(abtCmd), abtRx, sizeof(abtRx));
+    } else {
+      szChunk = ((szEnd - szPage) < TYPE2_READ_PAGES) ? (szEnd - szPage) : TYPE2_READ_PAGES;
+      const uint8_t abtCmd[] = { TYPE2_READ, szPage };
+      res = type2_transceive(pnd, abtCmd, sizeof(abtCmd), abtRx, sizeof(abtRx));
+    }
+    if (res < 0)
+      return res;
+    if ((size_t) res < szChunk * NFC_TYPE2_PAGE_LEN) {
+      pnd->last_error = NFC_ERFTRANS;
+      return pnd->last_error;
+    }
+    memcpy(pbtData + (szPage - ui8FirstPage) * NFC_TYPE2_PAGE_LEN, abtRx, szChunk * NFC_TYPE2_PAGE_LEN);
+    szPage += szChunk;
+  }
+  return szPages * NFC_TYPE2_PAGE_LEN;
+}
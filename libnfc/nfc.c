@@ -78,11 +78,26 @@
 #include <nfc/nfc.h>
 
 #include "nfc-internal.h"
+#include "capture.h"
 #include "target-subr.h"
 #include "drivers.h"
 
 #define LOG_CATEGORY "libnfc.general"
 
+// Capture a frame exchanged with the remote device, if capture is enabled
+static void
+nfc_capture(nfc_device *pnd, const bool bFromPicc, const uint8_t *pbtData, const size_t szData)
+{
+  if (!pnd->capture)
+    return;
+  uint8_t ui8Event;
+  if (bFromPicc)
+    ui8Event = pnd->bCrc ? CAPTURE_EVT_PICC_TO_PCD_CRC_DROPPED : CAPTURE_EVT_PICC_TO_PCD;
+  else
+    ui8Event = pnd->bCrc ? CAPTURE_EVT_PCD_TO_PICC_CRC_DROPPED : CAPTURE_EVT_PCD_TO_PICC;
+  capture_iso14443(pnd->capture, ui8Event, pbtData, szData);
+}
+
 const struct nfc_driver *nfc_drivers[] = {
 #  if defined (DRIVER_PN53X_USB_ENABLED)
   &pn53x_usb_driver,
@@ -102,6 +117,9 @@ const struct nfc_driver *nfc_drivers[] = {
 #  if defined (DRIVER_ARYGON_ENABLED)
   &arygon_driver,
 #  endif /* DRIVER_ARYGON_ENABLED */
+#  if defined (DRIVER_PN53X_REPLAY_ENABLED)
+  &pn53x_replay_driver,
+#  endif /* DRIVER_PN53X_REPLAY_ENABLED */
   NULL
 };
 
@@ -129,6 +147,31 @@ nfc_exit(nfc_context *context)
   log_fini();
 }
 
+/** @ingroup lib
+ * @brief Set the lowest priority of log messages to print
+ * @return Returns 0 on success, otherwise returns libnfc's error code (negative value)
+ * @param category log category (ie. "libnfc.chip.pn53x"), sub-categories included, or \c NULL for the default priority
+ * @param priority one of "trace", "debug", "info", "notice", "warning", "error", "critical", "alert" or "fatal"
+ *
+ * Messages below the priority of their category are dropped before being formatted.
+ * Default rules come from the LIBNFC_LOG_LEVEL environment variable (ie. "error,libnfc.chip.pn53x=trace"),
+ * they are loaded by nfc_init() so this function should be called afterwards.
+ * @note Returns \c NFC_ENOTIMPL when libnfc is built without debug support
+ */
+int
+nfc_log_set_priority(const char *category, const char *priority)
+{
+#ifdef LOGGING
+  if (log_set_priority(category, priority) < 0)
+    return NFC_EINVARG;
+  return NFC_SUCCESS;
+#else
+  (void) category;
+  (void) priority;
+  return NFC_ENOTIMPL;
+#endif
+}
+
 /** @ingroup dev
  * @brief Get the defaut NFC device
  * @param connstring \a nfc_connstring pointer where the default connection string will be stored
@@ -222,6 +265,9 @@ nfc_open(nfc_context *context, const nfc_connstring connstring)
     }
 
     log_put(LOG_CATEGORY, NFC_PRIORITY_TRACE, "\"%s\" (%s) has been claimed.", pnd->name, pnd->connstring);
+    const char *pcTrace = getenv("LIBNFC_TRACE");
+    if (pcTrace && *pcTrace)
+      nfc_device_set_trace(pnd, pcTrace);
     log_fini();
     return pnd;
   }
@@ -318,31 +364,15 @@ nfc_device_set_property_int(nfc_device *pnd, const nfc_property property, const
 int
 nfc_device_set_property_bool(nfc_device *pnd, const nfc_property property, const bool bEnable)
 {
-  HAL(device_set_property_bool, pnd, property, bEnable);
+  int res;
+  HAL_RES(res, device_set_property_bool, pnd, property, bEnable);
+  if (pnd->capture && (property == NP_ACTIVATE_FIELD) && (res >= 0))
+    capture_iso14443(pnd->capture, bEnable ? CAPTURE_EVT_FIELD_ON : CAPTURE_EVT_FIELD_OFF, NULL, 0);
+  return res;
 }
 
-/** @ingroup initiator
- * @brief Initialize NFC device as initiator (reader)
- * @return Returns 0 on success, otherwise returns libnfc's error code (negative value)
- * @param pnd \a nfc_device struct pointer that represent currently used device
- *
- * The NFC device is configured to function as RFID reader.
- * After initialization it can be used to communicate to passive RFID tags and active NFC devices.
- * The reader will act as initiator to communicate peer 2 peer (NFCIP) to other active NFC devices.
- * - Crc is handled by the device (NP_HANDLE_CRC = true)
- * - Parity is handled the device (NP_HANDLE_PARITY = true)
- * - Cryto1 cipher is disabled (NP_ACTIVATE_CRYPTO1 = false)
- * - Easy framing is enabled (NP_EASY_FRAMING = true)
- * - Auto-switching in ISO14443-4 mode is enabled (NP_AUTO_ISO14443_4 = true)
- * - Invalid frames are not accepted (NP_ACCEPT_INVALID_FRAMES = false)
- * - Multiple frames are not accepted (NP_ACCEPT_MULTIPLE_FRAMES = false)
- * - 14443-A mode is activated (NP_FORCE_ISO14443_A = true)
- * - speed is set to 106 kbps (NP_FORCE_SPEED_106 = true)
- * - Let the device try forever to find a target (NP_INFINITE_SELECT = true)
- * - RF field is shortly dropped (if it was enabled) then activated again
- */
-int
-nfc_initiator_init(nfc_device *pnd)
+static int
+initiator_init(nfc_device *pnd)
 {
   int res = 0;
   // Drop the field for a while
@@ -369,9 +399,38 @@ nfc_initiator_init(nfc_device *pnd)
   // Disallow multiple frames
   if ((res = nfc_device_set_property_bool(pnd, NP_ACCEPT_MULTIPLE_FRAMES, false)) < 0)
     return res;
+  iso14443_4_session_stop(pnd);
   HAL(initiator_init, pnd);
 }
 
+/** @ingroup initiator
+ * @brief Initialize NFC device as initiator (reader)
+ * @return Returns 0 on success, otherwise returns libnfc's error code (negative value)
+ * @param pnd \a nfc_device struct pointer that represent currently used device
+ *
+ * The NFC device is configured to function as RFID reader.
+ * After initialization it can be used to communicate to passive RFID tags and active NFC devices.
+ * The reader will act as initiator to communicate peer 2 peer (NFCIP) to other active NFC devices.
+ * - Crc is handled by the device (NP_HANDLE_CRC = true)
+ * - Parity is handled the device (NP_HANDLE_PARITY = true)
+ * - Cryto1 cipher is disabled (NP_ACTIVATE_CRYPTO1 = false)
+ * - Easy framing is enabled (NP_EASY_FRAMING = true)
+ * - Auto-switching in ISO14443-4 mode is enabled (NP_AUTO_ISO14443_4 = true)
+ * - Invalid frames are not accepted (NP_ACCEPT_INVALID_FRAMES = false)
+ * - Multiple frames are not accepted (NP_ACCEPT_MULTIPLE_FRAMES = false)
+ * - 14443-A mode is activated (NP_FORCE_ISO14443_A = true)
+ * - speed is set to 106 kbps (NP_FORCE_SPEED_106 = true)
+ * - Let the device try forever to find a target (NP_INFINITE_SELECT = true)
+ * - RF field is shortly dropped (if it was enabled) then activated again
+ */
+int
+nfc_initiator_init(nfc_device *pnd)
+{
+  int res;
+  TRACE_SPAN(res, initiator_init(pnd));
+  return res;
+}
+
 /** @ingroup initiator
  * @brief Initialize NFC device as initiator with its secure element initiator (reader)
  * @return Returns 0 on success, otherwise returns libnfc's error code (negative value)
@@ -406,12 +465,42 @@ nfc_initiator_init_secure_element(nfc_device *pnd)
  *
  * The chip needs to know with what kind of tag it is dealing with, therefore
  * the initial modulation and speed (106, 212 or 424 kbps) should be supplied.
+ *
+ * ISO14443-A targets are always selected at 106 kbps: \a nm.nbr is the highest
+ * bit rate to negotiate (PPS) once the target is activated in ISO14443-4,
+ * within what both the device and the target (TA(1) of its ATS) support. The
+ * bit rate in use is returned in \a pnt->nm.nbr.
  */
 int
 nfc_initiator_select_passive_target(nfc_device *pnd,
                                     const nfc_modulation nm,
                                     const uint8_t *pbtInitData, const size_t szInitData,
                                     nfc_target *pnt)
+{
+  return nfc_initiator_select_passive_target_ext(pnd, nm, pbtInitData, szInitData, pnt, 0);
+}
+
+/** @ingroup initiator
+ * @brief Select a passive or emulated tag using discovery flags
+ * @return Returns selected passive target count on success, otherwise returns libnfc's error code (negative value)
+ *
+ * @param pnd \a nfc_device struct pointer that represent currently used device
+ * @param nm desired modulation
+ * @param pbtInitData optional initiator data, see nfc_initiator_select_passive_target()
+ * @param szInitData length of initiator data \a pbtInitData.
+ * @param[out] pnt \a nfc_target struct pointer which will filled if available
+ * @param flags OR'ed \a nfc_discovery_flag values which only apply to this call
+ *
+ * This function behaves like nfc_initiator_select_passive_target(). With
+ * \a NDF_UID_ONLY, an ISO14443-A target is not activated in ISO14443-4 nor
+ * in D.E.P. mode: the selection stops right after anticollision. RATS can
+ * be sent later using nfc_initiator_activate_iso14443_4() when needed.
+ */
+int
+nfc_initiator_select_passive_target_ext(nfc_device *pnd,
+                                        const nfc_modulation nm,
+                                        const uint8_t *pbtInitData, const size_t szInitData,
+                                        nfc_target *pnt, const int flags)
 {
   uint8_t  abtInit[MAX(12, szInitData)];
   size_t  szInit;
@@ -433,29 +522,42 @@ nfc_initiator_select_passive_target(nfc_device *pnd,
       break;
   }
 
-  HAL(initiator_select_passive_target, pnd, nm, abtInit, szInit, pnt);
+  int res;
+  HAL_RES(res, initiator_select_passive_target, pnd, nm, abtInit, szInit, pnt, flags);
+  if (res > 0)
+    iso14443_4_session_start(pnd, pnt, false);
+  return res;
 }
 
 /** @ingroup initiator
- * @brief List passive or emulated tags
- * @return Returns the number of targets found on success, otherwise returns libnfc's error code (negative value)
+ * @brief Activate a selected ISO14443-A target in ISO14443-4 mode
+ * @return Returns 0 on success, otherwise returns libnfc's error code (negative value)
  *
  * @param pnd \a nfc_device struct pointer that represent currently used device
- * @param nm desired modulation
- * @param[out] ant array of \a nfc_target that will be filled with targets info
- * @param szTargets size of \a ant (will be the max targets listed)
+ * @param[in,out] pnt selected \a nfc_target, its ATS is filled on success
  *
- * The NFC device will try to find the available passive tags. Some NFC devices
- * are capable to emulate passive tags. The standards (ISO18092 and ECMA-340)
- * describe the modulation that can be used for reader to passive
- * communications. The chip needs to know with what kind of tag it is dealing
- * with, therefore the initial modulation and speed (106, 212 or 424 kbps)
- * should be supplied.
+ * Sends RATS to a target selected with \a NDF_UID_ONLY. Nothing is sent if
+ * the ATS is already known. A bit rate above 106 kbps asked at selection is
+ * then negotiated (PPS) and returned in \a pnt->nm.nbr.
+ *
+ * @note The device is not aware of the ISO14443-4 layer of a target activated
+ * this way: blocks have to be exchanged with \a NP_EASY_FRAMING disabled.
  */
 int
-nfc_initiator_list_passive_targets(nfc_device *pnd,
-                                   const nfc_modulation nm,
-                                   nfc_target ant[], const size_t szTargets)
+nfc_initiator_activate_iso14443_4(nfc_device *pnd, nfc_target *pnt)
+{
+  const bool bHostActivated = (pnt->nti.nai.szAtsLen == 0);
+  int res;
+  HAL_RES(res, initiator_activate_iso14443_4, pnd, pnt);
+  if (res == NFC_SUCCESS)
+    iso14443_4_session_start(pnd, pnt, bHostActivated);
+  return res;
+}
+
+static int
+initiator_list_passive_targets(nfc_device *pnd,
+                               const nfc_modulation nm,
+                               nfc_target ant[], const size_t szTargets)
 {
   nfc_target nt;
   size_t  szTargetFound = 0;
@@ -472,6 +574,15 @@ nfc_initiator_list_passive_targets(nfc_device *pnd,
 
   prepare_initiator_data(nm, &pbtInitData, &szInitDataLen);
 
+  // Some devices are able to list several targets at once using anticollision (e.g. ISO14443-B slots)
+  if (pnd->driver->initiator_list_passive_targets) {
+    res = pnd->driver->initiator_list_passive_targets(pnd, nm, pbtInitData, szInitDataLen, ant, szTargets);
+    if (res != NFC_ENOTIMPL) {
+      return res;
+    }
+    pnd->last_error = 0;
+  }
+
   while (nfc_initiator_select_passive_target(pnd, nm, pbtInitData, szInitDataLen, &nt) > 0) {
     size_t i;
     bool seen = false;
@@ -499,6 +610,41 @@ nfc_initiator_list_passive_targets(nfc_device *pnd,
   return szTargetFound;
 }
 
+/** @ingroup initiator
+ * @brief List passive or emulated tags
+ * @return Returns the number of targets found on success, otherwise returns libnfc's error code (negative value)
+ *
+ * @param pnd \a nfc_device struct pointer that represent currently used device
+ * @param nm desired modulation
+ * @param[out] ant array of \a nfc_target that will be filled with targets info
+ * @param szTargets size of \a ant (will be the max targets listed)
+ *
+ * The NFC device will try to find the available passive tags. Some NFC devices
+ * are capable to emulate passive tags. The standards (ISO18092 and ECMA-340)
+ * describe the modulation that can be used for reader to passive
+ * communications. The chip needs to know with what kind of tag it is dealing
+ * with, therefore the initial modulation and speed (106, 212 or 424 kbps)
+ * should be supplied.
+ *
+ * When the device supports it, ISO14443-B targets are enumerated using the
+ * slot anticollision of ISO/IEC 14443-3 (REQB/WUPB with several slots,
+ * Slot-MARKER and HLTB), so several cards present in the field at the same
+ * time can be listed. Listed targets are left in HALT state.
+ *
+ * Likewise ST SRx (ISO14443-2B SR) tags are inventoried with PCALL16 and
+ * SLOT_MARKER commands. Each listed tag is deactivated once its UID is read,
+ * then the RF field is reset so the tags can be selected again.
+ */
+int
+nfc_initiator_list_passive_targets(nfc_device *pnd,
+                                   const nfc_modulation nm,
+                                   nfc_target ant[], const size_t szTargets)
+{
+  int res;
+  TRACE_SPAN(res, initiator_list_passive_targets(pnd, nm, ant, szTargets));
+  return res;
+}
+
 /** @ingroup initiator
  * @brief Polling for NFC targets
  * @return Returns polled targets count, otherwise returns libnfc's error code (negative value).
@@ -518,7 +664,201 @@ nfc_initiator_poll_target(nfc_device *pnd,
                           const uint8_t uiPollNr, const uint8_t uiPeriod,
                           nfc_target *pnt)
 {
-  HAL(initiator_poll_target, pnd, pnmModulations, szModulations, uiPollNr, uiPeriod, pnt);
+  return nfc_initiator_poll_target_ext(pnd, pnmModulations, szModulations, uiPollNr, uiPeriod, pnt, 0);
+}
+
+/** @ingroup initiator
+ * @brief Polling for NFC targets using discovery flags
+ * @return Returns polled targets count, otherwise returns libnfc's error code (negative value).
+ *
+ * @param pnd \a nfc_device struct pointer that represent currently used device
+ * @param pnmModulations desired modulations
+ * @param szModulations size of \a pnmModulations
+ * @param uiPollNr specifies the number of polling, see nfc_initiator_poll_target()
+ * @param uiPeriod indicates the polling period in units of 150 ms, see nfc_initiator_poll_target()
+ * @param[out] pnt pointer on \a nfc_target (over)writable struct
+ * @param flags OR'ed \a nfc_discovery_flag values which only apply to this call
+ *
+ * This function behaves like nfc_initiator_poll_target(). With \a NDF_UID_ONLY,
+ * polled ISO14443-A targets are not activated in ISO14443-4 nor D.E.P. mode.
+ */
+int
+nfc_initiator_poll_target_ext(nfc_device *pnd,
+                              const nfc_modulation *pnmModulations, const size_t szModulations,
+                              const uint8_t uiPollNr, const uint8_t uiPeriod,
+                              nfc_target *pnt, const int flags)
+{
+  int res;
+  HAL_RES(res, initiator_poll_target, pnd, pnmModulations, szModulations, uiPollNr, uiPeriod, pnt, flags);
+  if (res > 0)
+    iso14443_4_session_start(pnd, pnt, false);
+  return res;
+}
+
+// Compare targets on their identifier only: other fields (e.g. ATS) may differ from one poll to another
+static bool
+nfc_target_is_same(const nfc_target *pnt1, const nfc_target *pnt2)
+{
+  if (pnt1->nm.nmt != pnt2->nm.nmt)
+    return false;
+  switch (pnt1->nm.nmt) {
+    case NMT_ISO14443A:
+      return (pnt1->nti.nai.szUidLen == pnt2->nti.nai.szUidLen) && (0 == memcmp(pnt1->nti.nai.abtUid, pnt2->nti.nai.abtUid, pnt1->nti.nai.szUidLen));
+    case NMT_JEWEL:
+      return 0 == memcmp(pnt1->nti.nji.btId, pnt2->nti.nji.btId, sizeof(pnt1->nti.nji.btId));
+    case NMT_ISO14443B:
+      return 0 == memcmp(pnt1->nti.nbi.abtPupi, pnt2->nti.nbi.abtPupi, sizeof(pnt1->nti.nbi.abtPupi));
+    case NMT_ISO14443BI:
+      return 0 == memcmp(pnt1->nti.nii.abtDIV, pnt2->nti.nii.abtDIV, sizeof(pnt1->nti.nii.abtDIV));
+    case NMT_ISO14443B2SR:
+      return 0 == memcmp(pnt1->nti.nsi.abtUID, pnt2->nti.nsi.abtUID, sizeof(pnt1->nti.nsi.abtUID));
+    case NMT_ISO14443B2CT:
+      return 0 == memcmp(pnt1->nti.nci.abtUID, pnt2->nti.nci.abtUID, sizeof(pnt1->nti.nci.abtUID));
+    case NMT_FELICA:
+      return 0 == memcmp(pnt1->nti.nfi.abtId, pnt2->nti.nfi.abtId, sizeof(pnt1->nti.nfi.abtId));
+    case NMT_DEP:
+      return 0 == memcmp(pnt1->nti.ndi.abtNFCID3, pnt2->nti.ndi.abtNFCID3, sizeof(pnt1->nti.ndi.abtNFCID3));
+  }
+  return false;
+}
+
+// Fill and deliver an event, latency is measured from i64Since (last time the state was known) to delivery
+static bool
+poll_event_deliver(nfc_device *pnd, nfc_poll_callback callback, void *user_data,
+                   const nfc_poll_event_type npet, const nfc_target *pnt,
+                   const int64_t i64Event, const int64_t i64Since)
+{
+  nfc_poll_event npe;
+  const int64_t i64Latency = monotonic_time_us() - i64Since;
+
+  npe.npet = npet;
+  npe.nt = *pnt;
+  npe.i64Time = i64Event;
+  npe.ui32Latency = (i64Latency > 0) ? ((i64Latency < UINT32_MAX) ? (uint32_t) i64Latency : UINT32_MAX) : 0;
+  return callback(pnd, &npe, user_data);
+}
+
+// Delay between two presence checks of a target which stays in the field
+#define POLL_STREAM_PRESENCE_INTERVAL 100
+// Polling period of one target type, i.e. uiPeriod = 1
+#define POLL_STREAM_PERIOD_US 150000
+
+static int
+initiator_poll_stream(nfc_device *pnd,
+                      const nfc_modulation *pnmModulations, const size_t szModulations,
+                      const int holdoff,
+                      nfc_poll_callback callback, void *user_data)
+{
+  nfc_target ntCurrent;
+  bool bPresent = false;
+  int64_t i64LastSeen = 0;
+  int iEvents = 0;
+  int res = 0;
+
+  pnd->last_error = 0;
+
+  if ((szModulations == 0) || (!pnmModulations) || (holdoff < 0) || (!callback)) {
+    pnd->last_error = NFC_EINVARG;
+    return pnd->last_error;
+  }
+
+  for (;;) {
+    if (bPresent && (nfc_initiator_target_is_present(pnd, ntCurrent) == NFC_SUCCESS)) {
+      i64LastSeen = monotonic_time_us();
+      monotonic_sleep_us(POLL_STREAM_PRESENCE_INTERVAL * 1000);
+      continue;
+    }
+
+    // Polling is armed once: endless while no target is known, otherwise until the hold-off of the current one expires
+    uint8_t uiPollNr = 0xff;
+    if (bPresent) {
+      const int64_t i64Remaining = i64LastSeen + (int64_t) holdoff * 1000 - monotonic_time_us();
+      if (i64Remaining <= 0) {
+        bPresent = false;
+        iEvents++;
+        if (!poll_event_deliver(pnd, callback, user_data, NPE_REMOVAL, &ntCurrent, monotonic_time_us(), i64LastSeen))
+          return iEvents;
+        continue;
+      }
+      const int64_t i64Poll = (int64_t) szModulations * POLL_STREAM_PERIOD_US;
+      const int64_t i64PollNr = (i64Remaining + i64Poll - 1) / i64Poll;
+      uiPollNr = (i64PollNr < 0xfe) ? (uint8_t) i64PollNr : 0xfe;
+    }
+
+    nfc_target nt;
+    const int64_t i64Start = monotonic_time_us();
+    if ((res = nfc_initiator_poll_target(pnd, pnmModulations, szModulations, uiPollNr, 1, &nt)) < 0) {
+      if ((res != NFC_ETIMEOUT) && (res != NFC_ERFTRANS)) {
+        return res;
+      }
+      res = 0;
+    }
+    const int64_t i64Found = monotonic_time_us();
+
+    if (res > 0) {
+      if (bPresent && nfc_target_is_same(&ntCurrent, &nt)) {
+        // Same target back within its hold-off
+        ntCurrent = nt;
+        i64LastSeen = i64Found;
+        continue;
+      }
+      if (bPresent) {
+        // Another target replaced the current one, which is reported removed once its hold-off expires as well
+        const int64_t i64Expiry = i64LastSeen + (int64_t) holdoff * 1000;
+        monotonic_sleep_us(i64Expiry - monotonic_time_us());
+        iEvents++;
+        if (!poll_event_deliver(pnd, callback, user_data, NPE_REMOVAL, &ntCurrent, MAX(i64Found, i64Expiry), i64LastSeen))
+          return iEvents;
+      }
+      ntCurrent = nt;
+      bPresent = true;
+      i64LastSeen = i64Found;
+      iEvents++;
+      // Target was not there one polling cycle before it has been found, a modulation may be polled as two target types (ISO14443-4A then MIFARE)
+      if (!poll_event_deliver(pnd, callback, user_data, NPE_ARRIVAL, &nt, i64Found,
+                              MAX(i64Start, i64Found - (int64_t) szModulations * 2 * POLL_STREAM_PERIOD_US)))
+        return iEvents;
+    }
+  }
+}
+
+/** @ingroup initiator
+ * @brief Continuously poll for NFC targets and report their arrival and removal
+ * @return Returns the number of delivered events when \a callback stops polling, otherwise returns libnfc's error code (negative value).
+ *
+ * @param pnd \a nfc_device struct pointer that represent currently used device
+ * @param pnmModulations desired modulations
+ * @param szModulations size of \a pnmModulations
+ * @param holdoff delay in milliseconds a target must stay out of reach before its removal is reported
+ * @param callback function called for each \a nfc_poll_event, polling stops when it returns \e false
+ * @param user_data pointer passed as is to \a callback
+ *
+ * Polling stays armed while no target is in the field: PN532 is given one
+ * endless InAutoPoll command, other chips loop on target selection, without
+ * going back to the caller. While a target is present, its presence is checked
+ * with nfc_initiator_target_is_present() every 100 ms. Once it stops
+ * answering, polling is armed for the rest of \a holdoff and its removal is
+ * reported only if it is not found again by then: a target which comes back
+ * within \a holdoff is not reported twice. When another target shows up
+ * instead, the removal of the previous one is likewise reported once its
+ * \a holdoff expires, followed by the arrival of the new one.
+ *
+ * Each event carries the time at which the device reported it and the
+ * arrival-to-event latency: the delay between the start of the polling cycle
+ * which found the target (a target is not present before the previous cycle
+ * ends) and the event delivery.
+ *
+ * @note nfc_abort_command() can be used from another thread to stop polling.
+ */
+int
+nfc_initiator_poll_stream(nfc_device *pnd,
+                          const nfc_modulation *pnmModulations, const size_t szModulations,
+                          const int holdoff,
+                          nfc_poll_callback callback, void *user_data)
+{
+  int res;
+  TRACE_SPAN(res, initiator_poll_stream(pnd, pnmModulations, szModulations, holdoff, callback, user_data));
+  return res;
 }
 
 
@@ -538,15 +878,50 @@ nfc_initiator_poll_target(nfc_device *pnd,
  * to passive communications.
  *
  * @note \a nfc_dep_info will be returned when the target was acquired successfully.
+ *
+ * When \a NP_AUTO_PSL is enabled, the link is raised right after ATR (PSL) to
+ * the highest bit rate supported by the device and, in both directions, by the
+ * target (BSt/BRt of ATR_RES); the bit rate in use is returned in \e nm.nbr of
+ * \a pnt.
+ *
+ * The maximum frame payload advertised by the target (LRt) is returned in
+ * \e nti.ndi.szLR of \a pnt for information only: D.E.P. frames are built by
+ * the device firmware, libnfc does not check nor split data against it.
  */
 int
 nfc_initiator_select_dep_target(nfc_device *pnd,
                                 const nfc_dep_mode ndm, const nfc_baud_rate nbr,
                                 const nfc_dep_info *pndiInitiator, nfc_target *pnt, const int timeout)
 {
+  iso14443_4_session_stop(pnd);
   HAL(initiator_select_dep_target, pnd, ndm, nbr, pndiInitiator, pnt, timeout);
 }
 
+static int
+initiator_poll_dep_target(struct nfc_device *pnd,
+                          const nfc_dep_mode ndm, const nfc_baud_rate nbr,
+                          const nfc_dep_info *pndiInitiator,
+                          nfc_target *pnt,
+                          const int timeout)
+{
+  const int period = 300;
+  const int64_t deadline = monotonic_time_ms() + timeout;
+  int64_t remaining_time;
+  int res;
+  if ((res = nfc_device_set_property_bool(pnd, NP_INFINITE_SELECT, true)) < 0)
+    return res;
+  // Remaining time is computed from the elapsed time as a select may return before its timeout
+  while ((remaining_time = deadline - monotonic_time_ms()) > 0) {
+    if ((res = nfc_initiator_select_dep_target(pnd, ndm, nbr, pndiInitiator, pnt, (int) MIN(period, remaining_time))) < 0) {
+      if (res != NFC_ETIMEOUT)
+        return res;
+    }
+    if (res == 1)
+      return res;
+  }
+  return 0;
+}
+
 /** @ingroup initiator
  * @brief Poll a target and request active or passive mode for D.E.P. (Data Exchange Protocol)
  * @return Returns selected D.E.P targets count on success, otherwise returns libnfc's error code (negative value).
@@ -571,23 +946,107 @@ nfc_initiator_poll_dep_target(struct nfc_device *pnd,
                               nfc_target *pnt,
                               const int timeout)
 {
+  int res;
+  TRACE_SPAN(res, initiator_poll_dep_target(pnd, ndm, nbr, pndiInitiator, pnt, timeout));
+  return res;
+}
+
+static int
+initiator_poll_dep_and_passive_target(struct nfc_device *pnd,
+                                      const nfc_modulation *pnmModulations, const size_t szModulations,
+                                      const nfc_dep_info *pndiInitiator,
+                                      nfc_target *pnt,
+                                      const int timeout)
+{
+  const nfc_dep_mode andmModes[] = { NDM_PASSIVE, NDM_ACTIVE };
+  // Time slot of a single D.E.P. attempt, so that one of them can not take the whole budget
   const int period = 300;
-  int remaining_time = timeout;
+  const int64_t deadline = monotonic_time_ms() + timeout;
+  int64_t remaining_time;
   int res;
-  if ((res = nfc_device_set_property_bool(pnd, NP_INFINITE_SELECT, true)) < 0)
+
+  pnd->last_error = 0;
+
+  if ((szModulations == 0) || (!pnmModulations)) {
+    pnd->last_error = NFC_EINVARG;
+    return pnd->last_error;
+  }
+
+  // Each attempt only tries once, the scheduler loops until deadline
+  if ((res = nfc_device_set_property_bool(pnd, NP_INFINITE_SELECT, false)) < 0)
     return res;
-  while (remaining_time > 0) {
-    if ((res = nfc_initiator_select_dep_target(pnd, ndm, nbr, pndiInitiator, pnt, period)) < 0) {
-      if (res != NFC_ETIMEOUT)
-        return res;
+
+  while ((remaining_time = deadline - monotonic_time_ms()) > 0) {
+    for (size_t n = 0; n < szModulations; n++) {
+      if (pnmModulations[n].nmt != NMT_DEP) {
+        uint8_t *pbtInitData;
+        size_t szInitData;
+        prepare_initiator_data(pnmModulations[n], &pbtInitData, &szInitData);
+        if ((res = nfc_initiator_select_passive_target(pnd, pnmModulations[n], pbtInitData, szInitData, pnt)) < 0) {
+          if ((res != NFC_ETIMEOUT) && (res != NFC_ERFTRANS))
+            return res;
+        } else if (res > 0) {
+          return res;
+        }
+      } else {
+        const nfc_baud_rate *pnbr;
+        nfc_baud_rate anbr[] = { pnmModulations[n].nbr, 0 };
+        if (pnmModulations[n].nbr == NBR_UNDEFINED) {
+          if ((res = nfc_device_get_supported_baud_rate(pnd, NMT_DEP, &pnbr)) < 0)
+            return res;
+        } else {
+          pnbr = anbr;
+        }
+        for (; *pnbr; pnbr++) {
+          for (size_t m = 0; m < sizeof(andmModes) / sizeof(andmModes[0]); m++) {
+            if ((remaining_time = deadline - monotonic_time_ms()) <= 0)
+              return 0;
+            if ((res = nfc_initiator_select_dep_target(pnd, andmModes[m], *pnbr, pndiInitiator, pnt, (int) MIN(period, remaining_time))) < 0) {
+              if ((res != NFC_ETIMEOUT) && (res != NFC_ERFTRANS))
+                return res;
+            } else if (res > 0) {
+              return res;
+            }
+          }
+        }
+      }
+      if (deadline - monotonic_time_ms() <= 0)
+        return 0;
     }
-    if (res == 1)
-      return res;
-    remaining_time -= period;
   }
   return 0;
 }
 
+/** @ingroup initiator
+ * @brief Poll D.E.P. and passive targets within a single time budget
+ * @return Returns selected target count on success, otherwise returns libnfc's error code (negative value).
+ *
+ * @param pnd \a nfc_device struct pointer that represent currently used device
+ * @param pnmModulations desired modulations, \a NMT_DEP ones are polled in both active and passive modes
+ * @param szModulations size of \a pnmModulations
+ * @param pndiInitiator pointer \a nfc_dep_info struct that contains \e NFCID3 and \e General \e Bytes to set to the initiator device (optionnal, can be \e NULL)
+ * @param[out] pnt is a \a nfc_target struct pointer where target information will be put.
+ * @param timeout in milliseconds
+ *
+ * Each modulation is tried once in turn (with each mode for \a NMT_DEP, and
+ * each supported baud rate when its baud rate is \a NBR_UNDEFINED) until a
+ * target is found or \a timeout is elapsed. This way, a peer-to-peer device
+ * and a plain tag are both detected within the same polling cycle. Time is
+ * measured on a monotonic clock and each D.E.P. attempt is given a 300 ms slot
+ * at most, bounded by the remaining time, so \a timeout is not overshot.
+ */
+int
+nfc_initiator_poll_dep_and_passive_target(struct nfc_device *pnd,
+                                          const nfc_modulation *pnmModulations, const size_t szModulations,
+                                          const nfc_dep_info *pndiInitiator,
+                                          nfc_target *pnt,
+                                          const int timeout)
+{
+  int res;
+  TRACE_SPAN(res, initiator_poll_dep_and_passive_target(pnd, pnmModulations, szModulations, pndiInitiator, pnt, timeout));
+  return res;
+}
+
 /** @ingroup initiator
  * @brief Deselect a selected passive or emulated tag
  * @return Returns 0 on success, otherwise returns libnfc's error code (negative value).
@@ -603,6 +1062,10 @@ nfc_initiator_poll_dep_target(struct nfc_device *pnd,
 int
 nfc_initiator_deselect_target(nfc_device *pnd)
 {
+  // Device is not aware of the ISO14443-4 layer of a target activated by the host, send S(DESELECT) ourselves
+  if (pnd->tcl.bActive && pnd->tcl.bHostActivated)
+    iso14443_4_deselect(pnd);
+  iso14443_4_session_stop(pnd);
   HAL(initiator_deselect_target, pnd);
 }
 
@@ -639,7 +1102,48 @@ int
 nfc_initiator_transceive_bytes(nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx, uint8_t *pbtRx,
                                const size_t szRx, int timeout)
 {
-  HAL(initiator_transceive_bytes, pnd, pbtTx, szTx, pbtRx, szRx, timeout)
+  int res;
+  nfc_capture(pnd, false, pbtTx, szTx);
+  HAL_RES(res, initiator_transceive_bytes, pnd, pbtTx, szTx, pbtRx, szRx, timeout);
+  if (res > 0)
+    nfc_capture(pnd, true, pbtRx, res);
+  return res;
+}
+
+/** @ingroup initiator
+ * @brief Send an APDU to an ISO14443-4 target then retrieve its response
+ * @return Returns received bytes count on success, otherwise returns libnfc's error code
+ *
+ * @param pnd \a nfc_device struct pointer that represents currently used device
+ * @param pbtTx command APDU, short or extended length
+ * @param szTx length of the command APDU
+ * @param[out] pbtRx response APDU (data and status word)
+ * @param szRx size of \a pbtRx (Will return NFC_EOVFLOW if the response exceeds this size)
+ *
+ * The ISO14443-4 (T=CL) block protocol is run by the host, on top of raw
+ * frames: the command is chained in as many I-blocks as the frame size
+ * announced by the target (FSCI, from its ATS) requires, the response is
+ * reassembled the same way. Waiting time extensions (S(WTX)) are granted and
+ * lost blocks are recovered with R(ACK)/R(NAK). The APDU size is thus not
+ * limited by the device firmware.
+ *
+ * The target must have been selected with its ATS, either by
+ * nfc_initiator_select_passive_target() (\a NP_AUTO_ISO14443_4 enabled) or
+ * by nfc_initiator_activate_iso14443_4(). \a NP_TIMEOUT_COM is set to the
+ * target's frame waiting time while blocks are exchanged; it is restored on
+ * return, like \a NP_EASY_FRAMING and \a NP_HANDLE_CRC.
+ *
+ * @warning Don't mix this function with nfc_initiator_transceive_bytes() and
+ * \a NP_EASY_FRAMING enabled on the same target: the device firmware then runs
+ * its own ISO14443-4 layer, whose block numbers are not tracked by the host
+ * one. Select the target again before switching from one to the other.
+ */
+int
+nfc_initiator_transceive_apdu(nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx, uint8_t *pbtRx, const size_t szRx)
+{
+  int res;
+  TRACE_SPAN(res, iso14443_4_transceive(pnd, pbtTx, szTx, pbtRx, szRx));
+  return res;
 }
 
 /** @ingroup initiator
@@ -681,7 +1185,12 @@ int
 nfc_initiator_transceive_bits(nfc_device *pnd, const uint8_t *pbtTx, const size_t szTxBits, const uint8_t *pbtTxPar,
                               uint8_t *pbtRx, uint8_t *pbtRxPar)
 {
-  HAL(initiator_transceive_bits, pnd, pbtTx, szTxBits, pbtTxPar, pbtRx, pbtRxPar);
+  int res;
+  nfc_capture(pnd, false, pbtTx, (szTxBits + 7) / 8);
+  HAL_RES(res, initiator_transceive_bits, pnd, pbtTx, szTxBits, pbtTxPar, pbtRx, pbtRxPar);
+  if (res > 0)
+    nfc_capture(pnd, true, pbtRx, (res + 7) / 8);
+  return res;
 }
 
 /** @ingroup initiator
@@ -707,7 +1216,12 @@ nfc_initiator_transceive_bits(nfc_device *pnd, const uint8_t *pbtTx, const size_
 int
 nfc_initiator_transceive_bytes_timed(nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx, uint8_t *pbtRx, uint32_t *cycles)
 {
-  HAL(initiator_transceive_bytes_timed, pnd, pbtTx, szTx, pbtRx, cycles);
+  int res;
+  nfc_capture(pnd, false, pbtTx, szTx);
+  HAL_RES(res, initiator_transceive_bytes_timed, pnd, pbtTx, szTx, pbtRx, cycles);
+  if (res > 0)
+    nfc_capture(pnd, true, pbtRx, res);
+  return res;
 }
 
 /** @ingroup initiator
@@ -749,7 +1263,43 @@ int
 nfc_initiator_transceive_bits_timed(nfc_device *pnd, const uint8_t *pbtTx, const size_t szTxBits, const uint8_t *pbtTxPar,
                                     uint8_t *pbtRx, uint8_t *pbtRxPar, uint32_t *cycles)
 {
-  HAL(initiator_transceive_bits_timed, pnd, pbtTx, szTxBits, pbtTxPar, pbtRx, pbtRxPar, cycles);
+  int res;
+  nfc_capture(pnd, false, pbtTx, (szTxBits + 7) / 8);
+  HAL_RES(res, initiator_transceive_bits_timed, pnd, pbtTx, szTxBits, pbtTxPar, pbtRx, pbtRxPar, cycles);
+  if (res > 0)
+    nfc_capture(pnd, true, pbtRx, (res + 7) / 8);
+  return res;
+}
+
+static int
+target_init(nfc_device *pnd, nfc_target *pnt, uint8_t *pbtRx, const size_t szRx, int timeout)
+{
+  int res = 0;
+  // Disallow invalid frame
+  if ((res = nfc_device_set_property_bool(pnd, NP_ACCEPT_INVALID_FRAMES, false)) < 0)
+    return res;
+  // Disallow multiple frames
+  if ((res = nfc_device_set_property_bool(pnd, NP_ACCEPT_MULTIPLE_FRAMES, false)) < 0)
+    return res;
+  // Make sure we reset the CRC and parity to chip handling.
+  if ((res = nfc_device_set_property_bool(pnd, NP_HANDLE_CRC, true)) < 0)
+    return res;
+  if ((res = nfc_device_set_property_bool(pnd, NP_HANDLE_PARITY, true)) < 0)
+    return res;
+  // Activate auto ISO14443-4 switching by default
+  if ((res = nfc_device_set_property_bool(pnd, NP_AUTO_ISO14443_4, true)) < 0)
+    return res;
+  // Activate "easy framing" feature by default
+  if ((res = nfc_device_set_property_bool(pnd, NP_EASY_FRAMING, true)) < 0)
+    return res;
+  // Deactivate the CRYPTO1 cipher, it may could cause problems when still active
+  if ((res = nfc_device_set_property_bool(pnd, NP_ACTIVATE_CRYPTO1, false)) < 0)
+    return res;
+  // Drop explicitely the field
+  if ((res = nfc_device_set_property_bool(pnd, NP_ACTIVATE_FIELD, false)) < 0)
+    return res;
+
+  HAL(target_init, pnd, pnt, pbtRx, szRx, timeout);
 }
 
 /** @ingroup target
@@ -785,32 +1335,9 @@ nfc_initiator_transceive_bits_timed(nfc_device *pnd, const uint8_t *pbtTx, const
 int
 nfc_target_init(nfc_device *pnd, nfc_target *pnt, uint8_t *pbtRx, const size_t szRx, int timeout)
 {
-  int res = 0;
-  // Disallow invalid frame
-  if ((res = nfc_device_set_property_bool(pnd, NP_ACCEPT_INVALID_FRAMES, false)) < 0)
-    return res;
-  // Disallow multiple frames
-  if ((res = nfc_device_set_property_bool(pnd, NP_ACCEPT_MULTIPLE_FRAMES, false)) < 0)
-    return res;
-  // Make sure we reset the CRC and parity to chip handling.
-  if ((res = nfc_device_set_property_bool(pnd, NP_HANDLE_CRC, true)) < 0)
-    return res;
-  if ((res = nfc_device_set_property_bool(pnd, NP_HANDLE_PARITY, true)) < 0)
-    return res;
-  // Activate auto ISO14443-4 switching by default
-  if ((res = nfc_device_set_property_bool(pnd, NP_AUTO_ISO14443_4, true)) < 0)
-    return res;
-  // Activate "easy framing" feature by default
-  if ((res = nfc_device_set_property_bool(pnd, NP_EASY_FRAMING, true)) < 0)
-    return res;
-  // Deactivate the CRYPTO1 cipher, it may could cause problems when still active
-  if ((res = nfc_device_set_property_bool(pnd, NP_ACTIVATE_CRYPTO1, false)) < 0)
-    return res;
-  // Drop explicitely the field
-  if ((res = nfc_device_set_property_bool(pnd, NP_ACTIVATE_FIELD, false)) < 0)
-    return res;
-
-  HAL(target_init, pnd, pnt, pbtRx, szRx, timeout);
+  int res;
+  TRACE_SPAN(res, target_init(pnd, pnt, pbtRx, szRx, timeout));
+  return res;
 }
 
 /** @ingroup dev
@@ -843,7 +1370,12 @@ nfc_idle(nfc_device *pnd)
 int
 nfc_abort_command(nfc_device *pnd)
 {
-  HAL(abort_command, pnd);
+  // Not traced: usually called from another thread while a command is running
+  pnd->last_error = 0;
+  if (pnd->driver->abort_command)
+    return pnd->driver->abort_command(pnd);
+  pnd->last_error = NFC_EDEVNOTSUPP;
+  return false;
 }
 
 /** @ingroup target
@@ -864,6 +1396,7 @@ nfc_abort_command(nfc_device *pnd)
 int
 nfc_target_send_bytes(nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx, int timeout)
 {
+  nfc_capture(pnd, true, pbtTx, szTx);
   HAL(target_send_bytes, pnd, pbtTx, szTx, timeout);
 }
 
@@ -884,7 +1417,11 @@ nfc_target_send_bytes(nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx,
 int
 nfc_target_receive_bytes(nfc_device *pnd, uint8_t *pbtRx, const size_t szRx, int timeout)
 {
-  HAL(target_receive_bytes, pnd, pbtRx, szRx, timeout);
+  int res;
+  HAL_RES(res, target_receive_bytes, pnd, pbtRx, szRx, timeout);
+  if (res > 0)
+    nfc_capture(pnd, false, pbtRx, res);
+  return res;
 }
 
 /** @ingroup target
@@ -901,6 +1438,7 @@ nfc_target_receive_bytes(nfc_device *pnd, uint8_t *pbtRx, const size_t szRx, int
 int
 nfc_target_send_bits(nfc_device *pnd, const uint8_t *pbtTx, const size_t szTxBits, const uint8_t *pbtTxPar)
 {
+  nfc_capture(pnd, true, pbtTx, (szTxBits + 7) / 8);
   HAL(target_send_bits, pnd, pbtTx, szTxBits, pbtTxPar);
 }
 
@@ -923,7 +1461,11 @@ nfc_target_send_bits(nfc_device *pnd, const uint8_t *pbtTx, const size_t szTxBit
 int
 nfc_target_receive_bits(nfc_device *pnd, uint8_t *pbtRx, const size_t szRx, uint8_t *pbtRxPar)
 {
-  HAL(target_receive_bits, pnd, pbtRx, szRx, pbtRxPar);
+  int res;
+  HAL_RES(res, target_receive_bits, pnd, pbtRx, szRx, pbtRxPar);
+  if (res > 0)
+    nfc_capture(pnd, false, pbtRx, (res + 7) / 8);
+  return res;
 }
 
 static struct sErrorMessage {
@@ -1060,6 +1602,129 @@ nfc_device_get_supported_baud_rate(nfc_device *pnd, const nfc_modulation_type nm
 
 /* Misc. functions */
 
+/** @ingroup dev
+ * @brief Copy the last frames exchanged between libnfc and the NFC chip
+ * @return Returns the number of records copied, oldest first, otherwise returns libnfc's error code (negative value)
+ * @param pnd \a nfc_device struct pointer that represent currently used device
+ * @param[out] records array of \a nfc_frame_record where frames are copied
+ * @param szRecords size of \a records array
+ *
+ * Frames are always recorded, even without debug support, in a ring buffer holding the last 64 frames
+ * (the oldest one is skipped once the ring wrapped since the device may be overwriting it).
+ * Records are plain structures: they can be written as is to a file (ie. with fwrite()) when a reader
+ * misbehaves and decoded later with pn53x-frame-recorder.
+ * @note This function can be called from another thread than the one using \a pnd: records overwritten while copied are skipped.
+ */
+int
+nfc_device_get_frame_records(nfc_device *pnd, nfc_frame_record records[], const size_t szRecords)
+{
+  const struct nfc_frame_recorder *pnfr = &pnd->frame_recorder;
+  const uint32_t ui32Head = __atomic_load_n(&pnfr->ui32Head, __ATOMIC_ACQUIRE);
+  size_t szCount = (ui32Head < NFC_FRAME_RECORDER_SIZE) ? ui32Head : NFC_FRAME_RECORDER_SIZE;
+  if (szCount > szRecords)
+    szCount = szRecords;
+
+  uint32_t ui32First = ui32Head - szCount;
+  for (size_t n = 0; n < szCount; n++) {
+    records[n] = pnfr->records[(ui32First + n) % NFC_FRAME_RECORDER_SIZE];
+  }
+
+  // Skip records the device overwrote while we were copying them, including the one it may be writing right now
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  const uint32_t ui32Overwritten = __atomic_load_n(&pnfr->ui32Head, __ATOMIC_ACQUIRE) - ui32Head + 1;
+  const size_t szRecycled = (ui32Overwritten > (NFC_FRAME_RECORDER_SIZE - szCount)) ? ui32Overwritten - (NFC_FRAME_RECORDER_SIZE - szCount) : 0;
+  if (szRecycled >= szCount)
+    return 0;
+  if (szRecycled) {
+    memmove(records, records + szRecycled, (szCount - szRecycled) * sizeof(nfc_frame_record));
+    szCount -= szRecycled;
+  }
+  return szCount;
+}
+
+/** @ingroup dev
+ * @brief Get per command counters of the device
+ * @return Returns 0 on success, otherwise returns libnfc's error code (negative value)
+ * @param pnd \a nfc_device struct pointer that represent currently used device
+ * @param[out] pnds \a nfc_device_stats struct pointer where counters are copied
+ *
+ * Counters are indexed by chip command code (ie. InDataExchange) and gathered since the device
+ * was opened or since the last nfc_device_reset_stats() call: calls, bytes in and out, errors
+ * and a log2 histogram of the round-trip latency (see \c NFC_STATS_LATENCY_BUCKETS).
+ * Automatic recoveries of a wedged chip are counted along with the time spent in them.
+ */
+int
+nfc_device_get_stats(nfc_device *pnd, nfc_device_stats *pnds)
+{
+  memcpy(pnds, &pnd->stats, sizeof(*pnds));
+  return NFC_SUCCESS;
+}
+
+/** @ingroup dev
+ * @brief Reset per command counters of the device
+ * @return Returns 0 on success, otherwise returns libnfc's error code (negative value)
+ * @param pnd \a nfc_device struct pointer that represent currently used device
+ */
+int
+nfc_device_reset_stats(nfc_device *pnd)
+{
+  memset(&pnd->stats, 0x00, sizeof(pnd->stats));
+  return NFC_SUCCESS;
+}
+
+/** @ingroup dev
+ * @brief Start or stop capturing the device's traffic to a pcapng file
+ * @return Returns 0 on success, otherwise returns libnfc's error code (negative value)
+ * @param pnd \a nfc_device struct pointer that represent currently used device
+ * @param filename pcapng file to write (truncated), \c NULL to stop capturing
+ *
+ * Frames exchanged with the remote device are captured on a LINKTYPE_ISO_14443
+ * interface, with field on/off events; frames exchanged with the chip are
+ * captured on a second (LINKTYPE_USER0) interface. Timestamps have nanosecond
+ * resolution. Frames are written by a background thread: capturing never
+ * blocks on I/O, frames are dropped if the writer can't keep up.
+ *
+ * The LIBNFC_CAPTURE environment variable starts a capture to the given file
+ * as soon as a device is created, so that its initialization is captured too
+ * and the capture can be replayed by the pn53x_replay driver.
+ */
+int
+nfc_device_set_capture(nfc_device *pnd, const char *filename)
+{
+  struct capture *pc = NULL;
+  if (filename && !(pc = capture_open(filename)))
+    return pnd->last_error = NFC_ESOFT;
+  capture_close(pnd->capture);
+  pnd->capture = pc;
+  return NFC_SUCCESS;
+}
+
+/** @ingroup dev
+ * @brief Start or stop tracing the device's operations to a Chrome trace-event JSON file
+ * @return Returns 0 on success, otherwise returns libnfc's error code (negative value)
+ * @param pnd \a nfc_device struct pointer that represent currently used device
+ * @param filename JSON file to write (truncated), \c NULL to stop tracing
+ *
+ * Each call to a public function of this device is recorded as a span, with
+ * nested spans for each PN53x command, register write-back and driver
+ * send/receive it issued; the result of each call is stored in its span's
+ * arguments. The file can be loaded in chrome://tracing, it is completed when
+ * tracing stops or the device is closed.
+ *
+ * The LIBNFC_TRACE environment variable starts tracing to the given file when a
+ * device is opened.
+ */
+int
+nfc_device_set_trace(nfc_device *pnd, const char *filename)
+{
+  struct tracer *pt = NULL;
+  if (filename && !(pt = tracer_open(filename, pnd->name)))
+    return pnd->last_error = NFC_ESOFT;
+  tracer_close(pnd->tracer);
+  pnd->tracer = pt;
+  return NFC_SUCCESS;
+}
+
 /** @ingroup misc
  * @brief Returns the library version
  * @return Returns a string with the library version
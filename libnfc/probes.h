@@ -0,0 +1,41 @@
+/*-
+ * Public platform independent Near Field Communication (NFC) library
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/**
+ * @file probes.h
+ * @brief USDT (SystemTap/DTrace) static probes
+ *
+ * Probes of the "libnfc" provider are a single nop until a tracer (ie.
+ * bpftrace, perf or stap) attaches to them, e.g.:
+ *   bpftrace -e 'usdt:/usr/lib/libnfc.so:libnfc:pn53x_transceive__return { @[arg0] = count(); }'
+ */
+
+#ifndef __NFC_PROBES_H__
+#define __NFC_PROBES_H__
+
+#ifdef HAVE_SYS_SDT_H
+#  include <sys/sdt.h>
+#  define NFC_PROBE1( NAME, A1 )         DTRACE_PROBE1(libnfc, NAME, A1)
+#  define NFC_PROBE2( NAME, A1, A2 )     DTRACE_PROBE2(libnfc, NAME, A1, A2)
+#  define NFC_PROBE3( NAME, A1, A2, A3 ) DTRACE_PROBE3(libnfc, NAME, A1, A2, A3)
+#else
+#  define NFC_PROBE1( NAME, A1 )         do {} while (0)
+#  define NFC_PROBE2( NAME, A1, A2 )     do {} while (0)
+#  define NFC_PROBE3( NAME, A1, A2, A3 ) do {} while (0)
+#endif
+
+#endif // __NFC_PROBES_H__
@@ -0,0 +1,103 @@
+/*-
+ * Public platform independent Near Field Communication (NFC) library
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/**
+ * @file tracer-chrome.c
+ * @brief Operation spans exported as Chrome trace-event JSON
+ *
+ * Files can be loaded in chrome://tracing (or any trace-event viewer): spans
+ * are written as duration events ("ph":"B" and "ph":"E") of a single thread.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <nfc/nfc.h>
+
+#include "nfc-internal.h"
+#include "tracer.h"
+
+#define LOG_CATEGORY "libnfc.tracer"
+
+// Events are written through a large stdio buffer, flushed when the tracer is closed
+#define TRACER_BUFFER_SIZE 65536
+
+struct tracer {
+  FILE *fp;
+  int64_t i64Origin;
+};
+
+static void
+tracer_put_string(FILE *fp, const char *pc)
+{
+  fputc('"', fp);
+  for (; *pc; pc++) {
+    if ((*pc == '"') || (*pc == '\\'))
+      fputc('\\', fp);
+    if ((unsigned char) *pc >= 0x20)
+      fputc(*pc, fp);
+  }
+  fputc('"', fp);
+}
+
+struct tracer *
+tracer_open(const char *filename, const char *pcProcessName)
+{
+  struct tracer *pt = malloc(sizeof(*pt));
+  if (!pt)
+    return NULL;
+  if (!(pt->fp = fopen(filename, "w"))) {
+    log_put(LOG_CATEGORY, NFC_PRIORITY_ERROR, "Unable to open trace file \"%s\"", filename);
+    free(pt);
+    return NULL;
+  }
+  setvbuf(pt->fp, NULL, _IOFBF, TRACER_BUFFER_SIZE);
+  pt->i64Origin = monotonic_time_us();
+
+  fprintf(pt->fp, "[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":");
+  tracer_put_string(pt->fp, pcProcessName);
+  fprintf(pt->fp, "}}");
+  return pt;
+}
+
+void
+tracer_close(struct tracer *pt)
+{
+  if (!pt)
+    return;
+  fprintf(pt->fp, "\n]\n");
+  fclose(pt->fp);
+  free(pt);
+}
+
+void
+tracer_begin(struct tracer *pt, const char *pcCategory, const char *pcName)
+{
+  fprintf(pt->fp, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"B\",\"ts\":%lld,\"pid\":1,\"tid\":1}",
+          pcName, pcCategory, (long long)(monotonic_time_us() - pt->i64Origin));
+}
+
+void
+tracer_end(struct tracer *pt, const char *pcCategory, const char *pcName, const int iResult)
+{
+  fprintf(pt->fp, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"E\",\"ts\":%lld,\"pid\":1,\"tid\":1,\"args\":{\"res\":%d}}",
+          pcName, pcCategory, (long long)(monotonic_time_us() - pt->i64Origin), iResult);
+}
@@ -0,0 +1,45 @@
+/*-
+ * Public platform independent Near Field Communication (NFC) library
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/**
+ * @file tracer.h
+ * @brief Operation spans exported as Chrome trace-event JSON
+ */
+
+#ifndef __NFC_TRACER_H__
+#define __NFC_TRACER_H__
+
+struct tracer;
+
+struct tracer *tracer_open(const char *filename, const char *pcProcessName);
+void  tracer_close(struct tracer *pt);
+
+// Spans nest by time: a span begun after another one and ended before it is its child
+void  tracer_begin(struct tracer *pt, const char *pcCategory, const char *pcName);
+void  tracer_end(struct tracer *pt, const char *pcCategory, const char *pcName, const int iResult);
+
+// Only cost a pointer test when the device is not traced
+#define TRACE_BEGIN( pnd, CATEGORY, NAME ) do { \
+    if ((pnd)->tracer) \
+      tracer_begin((pnd)->tracer, CATEGORY, NAME); \
+  } while (0)
+#define TRACE_END( pnd, CATEGORY, NAME, RES ) do { \
+    if ((pnd)->tracer) \
+      tracer_end((pnd)->tracer, CATEGORY, NAME, RES); \
+  } while (0)
+
+#endif // __NFC_TRACER_H__
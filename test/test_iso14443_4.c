@@ -0,0 +1,67 @@
+#include <cutter.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <nfc/nfc.h>
+
+#define TRACE "pn53x_replay_iso14443_4.txt"
+
+void
+cut_setup(void)
+{
+  nfc_init(NULL);
+}
+
+void
+cut_teardown(void)
+{
+  nfc_exit(NULL);
+}
+
+// Host side block protocol, replayed against a target which chains, asks for more time, loses a block and is deselected
+void
+test_iso14443_4_blocks(void)
+{
+  const char *pcBaseDir = getenv("BASE_DIR");
+  nfc_connstring connstring;
+  snprintf(connstring, sizeof(connstring), "pn53x_replay:%s/%s", pcBaseDir ? pcBaseDir : ".", TRACE);
+
+  nfc_device *pnd = nfc_open(NULL, connstring);
+  cut_assert_not_null(pnd, cut_message("Unable to open %s", connstring));
+  cut_assert_equal_int(0, nfc_initiator_init(pnd), cut_message("nfc_initiator_init"));
+  cut_assert_equal_int(0, nfc_device_set_property_bool(pnd, NP_AUTO_ISO14443_4, false), cut_message("NP_AUTO_ISO14443_4"));
+
+  const nfc_modulation nm = { .nmt = NMT_ISO14443A, .nbr = NBR_106 };
+  nfc_target nt;
+  cut_assert_equal_int(1, nfc_initiator_select_passive_target(pnd, nm, NULL, 0, &nt), cut_message("select"));
+  cut_assert_equal_int(0, nt.nti.nai.szAtsLen, cut_message("RATS sent by the firmware"));
+  cut_assert_equal_int(0, nfc_initiator_activate_iso14443_4(pnd, &nt), cut_message("activate"));
+  cut_assert_equal_memory("\x70\x80\x40\x02", 4, nt.nti.nai.abtAts, nt.nti.nai.szAtsLen);
+
+  // FSC is 16 bytes: the command is chained in three I-blocks, the response in two, with a S(WTX) in between
+  uint8_t abtUpdate[30];
+  for (size_t n = 0; n < sizeof(abtUpdate); n++)
+    abtUpdate[n] = n;
+  abtUpdate[0] = 0x00;
+  abtUpdate[1] = 0xd6;
+  uint8_t abtRx[64];
+  uint8_t abtExpected[22];
+  for (size_t n = 0; n < 20; n++)
+    abtExpected[n] = 0x60 + n;
+  abtExpected[20] = 0x90;
+  abtExpected[21] = 0x00;
+  int res = nfc_initiator_transceive_apdu(pnd, abtUpdate, sizeof(abtUpdate), abtRx, sizeof(abtRx));
+  cut_assert_equal_int(sizeof(abtExpected), res, cut_message("chained APDU"));
+  cut_assert_equal_memory(abtExpected, sizeof(abtExpected), abtRx, res);
+
+  // First I-block is lost: R(NAK) is answered by R(ACK) of the previous block, the I-block is sent again
+  const uint8_t abtRead[] = { 0x00, 0xb0, 0x00, 0x00, 0x02 };
+  res = nfc_initiator_transceive_apdu(pnd, abtRead, sizeof(abtRead), abtRx, sizeof(abtRx));
+  cut_assert_equal_int(4, res, cut_message("retransmitted APDU"));
+  cut_assert_equal_memory("\xca\xfe\x90\x00", 4, abtRx, res);
+
+  // Target activated by the host is deselected with S(DESELECT)
+  cut_assert_operator_int(0, <=, nfc_initiator_deselect_target(pnd), cut_message("deselect"));
+  nfc_close(pnd);
+}
@@ -0,0 +1,125 @@
+#include <cutter.h>
+
+#include <sys/time.h>
+
+#include <nfc/nfc.h>
+
+#define BENCH_FRAME_LEN 64
+#define BENCH_ROUNDS 200000
+
+/* Bytewise loop formerly used by iso14443a_crc(), kept as reference */
+static void
+reference_crc(const uint16_t wInit, const uint8_t *pbtData, size_t szLen, uint8_t *pbtCrc)
+{
+  uint8_t  bt;
+  uint32_t wCrc = wInit;
+
+  while (szLen--) {
+    bt = *pbtData++;
+    bt = (bt ^(uint8_t)(wCrc & 0x00FF));
+    bt = (bt ^(bt << 4));
+    wCrc = (wCrc >> 8) ^((uint32_t) bt << 8) ^((uint32_t) bt << 3) ^((uint32_t) bt >> 4);
+  }
+
+  *pbtCrc++ = (uint8_t)(wCrc & 0xFF);
+  *pbtCrc = (uint8_t)((wCrc >> 8) & 0xFF);
+}
+
+static double
+elapsed_ms(const struct timeval *start)
+{
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  return (now.tv_sec - start->tv_sec) * 1000.0 + (now.tv_usec - start->tv_usec) / 1000.0;
+}
+
+void
+test_iso14443a_crc_vectors(void)
+{
+  uint8_t abtCrc[2];
+
+  /* SELECT of UID 0x9a 0xb2 0x3c 0x12, checked against the bytewise loop */
+  uint8_t abtSelect[] = { 0x93, 0x70, 0x9a, 0xb2, 0x3c, 0x12, 0x06 };
+  iso14443a_crc(abtSelect, sizeof(abtSelect), abtCrc);
+  uint8_t abtExpected[2];
+  reference_crc(0x6363, abtSelect, sizeof(abtSelect), abtExpected);
+  cut_assert_equal_memory(abtExpected, 2, abtCrc, 2, cut_message("SELECT CRC_A"));
+
+  /* HLTA 0x50 0x00 is followed by CRC_A 0x57 0xcd */
+  uint8_t abtHlta[4] = { 0x50, 0x00 };
+  iso14443a_crc_append(abtHlta, 2);
+  cut_assert_equal_int(0x57, abtHlta[2], cut_message("HLTA CRC_A low byte"));
+  cut_assert_equal_int(0xcd, abtHlta[3], cut_message("HLTA CRC_A high byte"));
+}
+
+void
+test_iso14443b_crc_vectors(void)
+{
+  /* REQB 0x05 0x00 0x08 is followed by CRC_B 0x39 0x73 */
+  uint8_t abtReqb[5] = { 0x05, 0x00, 0x08 };
+  iso14443b_crc_append(abtReqb, 3);
+  cut_assert_equal_int(0x39, abtReqb[3], cut_message("REQB CRC_B low byte"));
+  cut_assert_equal_int(0x73, abtReqb[4], cut_message("REQB CRC_B high byte"));
+}
+
+void
+test_iso14443_crc_lengths(void)
+{
+  uint8_t abtData[BENCH_FRAME_LEN + 1];
+  uint8_t abtCrc[2], abtExpected[2];
+
+  for (size_t n = 0; n < sizeof(abtData); n++)
+    abtData[n] = (uint8_t)(n * 37 + 11);
+
+  /* Cover both the 8 bytes slices and every tail length */
+  for (size_t szLen = 1; szLen <= sizeof(abtData); szLen++) {
+    iso14443a_crc(abtData, szLen, abtCrc);
+    reference_crc(0x6363, abtData, szLen, abtExpected);
+    cut_assert_equal_memory(abtExpected, 2, abtCrc, 2, cut_message("CRC_A over %u bytes", (unsigned) szLen));
+
+    iso14443b_crc(abtData, szLen, abtCrc);
+    reference_crc(0xFFFF, abtData, szLen, abtExpected);
+    abtExpected[0] = ~abtExpected[0];
+    abtExpected[1] = ~abtExpected[1];
+    cut_assert_equal_memory(abtExpected, 2, abtCrc, 2, cut_message("CRC_B over %u bytes", (unsigned) szLen));
+  }
+}
+
+void
+test_iso14443_crc_benchmark(void)
+{
+  uint8_t abtFrame[BENCH_FRAME_LEN];
+  uint8_t abtCrc[2];
+  uint8_t btAcc = 0;
+  struct timeval start;
+
+  for (size_t n = 0; n < sizeof(abtFrame); n++)
+    abtFrame[n] = (uint8_t) n;
+
+  gettimeofday(&start, NULL);
+  for (int n = 0; n < BENCH_ROUNDS; n++) {
+    abtFrame[0] = (uint8_t) n;
+    reference_crc(0x6363, abtFrame, sizeof(abtFrame), abtCrc);
+    btAcc ^= abtCrc[0];
+  }
+  const double dReference = elapsed_ms(&start);
+
+  gettimeofday(&start, NULL);
+  for (int n = 0; n < BENCH_ROUNDS; n++) {
+    abtFrame[0] = (uint8_t) n;
+    iso14443a_crc(abtFrame, sizeof(abtFrame), abtCrc);
+    btAcc ^= abtCrc[0];
+  }
+  const double dCrcA = elapsed_ms(&start);
+
+  gettimeofday(&start, NULL);
+  for (int n = 0; n < BENCH_ROUNDS; n++) {
+    abtFrame[0] = (uint8_t) n;
+    iso14443b_crc(abtFrame, sizeof(abtFrame), abtCrc);
+    btAcc ^= abtCrc[0];
+  }
+  const double dCrcB = elapsed_ms(&start);
+
+  cut_notify("%d x %d bytes: bytewise loop %.1f ms, iso14443a_crc %.1f ms, iso14443b_crc %.1f ms (%02x)",
+             BENCH_ROUNDS, BENCH_FRAME_LEN, dReference, dCrcA, dCrcB, btAcc);
+}
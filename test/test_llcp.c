@@ -0,0 +1,106 @@
+#include <cutter.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <nfc/nfc.h>
+#include <nfc/nfc-llcp.h>
+
+#define TRACE "pn53x_replay_llcp.txt"
+
+void
+cut_setup(void)
+{
+  nfc_init(NULL);
+}
+
+void
+cut_teardown(void)
+{
+  nfc_exit(NULL);
+}
+
+void
+test_llcp_link_params(void)
+{
+  const nfc_llcp_params params[] = {
+    { .szMiu = 127, .ui8Rw = 1, .iLto = 100 },
+    { .szMiu = NFC_LLCP_MIU_MAX + 1, .ui8Rw = 1, .iLto = 100 },
+    { .szMiu = 128, .ui8Rw = 0, .iLto = 100 },
+    { .szMiu = 128, .ui8Rw = NFC_LLCP_RW_MAX + 1, .iLto = 100 },
+    { .szMiu = 128, .ui8Rw = 1, .iLto = 9 },
+    { .szMiu = 128, .ui8Rw = 1, .iLto = 2551 },
+  };
+  for (size_t n = 0; n < sizeof(params) / sizeof(params[0]); n++)
+    cut_assert_true(NULL == nfc_llcp_link_new(NULL, &params[n]), cut_message("parameters #%d accepted", (int) n));
+
+  nfc_llcp_link *link = nfc_llcp_link_new(NULL, NULL);
+  cut_assert_not_null(link, cut_message("default parameters"));
+  nfc_llcp_params remote;
+  cut_assert_equal_int(NFC_ETGRELEASED, nfc_llcp_link_get_remote_params(link, &remote), cut_message("inactive link"));
+  nfc_llcp_link_free(link);
+}
+
+// Link and connection replayed against a peer which echoes SDUs, then overruns the receive window
+void
+test_llcp_link(void)
+{
+  const char *pcBaseDir = getenv("BASE_DIR");
+  nfc_connstring connstring;
+  snprintf(connstring, sizeof(connstring), "pn53x_replay:%s/%s", pcBaseDir ? pcBaseDir : ".", TRACE);
+
+  nfc_device *pnd = nfc_open(NULL, connstring);
+  cut_assert_not_null(pnd, cut_message("Unable to open %s", connstring));
+  cut_assert_equal_int(0, nfc_initiator_init(pnd), cut_message("nfc_initiator_init"));
+  nfc_llcp_link *link = nfc_llcp_link_new(pnd, NULL);
+  cut_assert_not_null(link, cut_message("nfc_llcp_link_new"));
+
+  // ATR_REQ general bytes are checked by the replay, ATR_RES ones are decoded here
+  cut_assert_equal_int(0, nfc_llcp_link_activate_initiator(link, NDM_PASSIVE, NBR_106, 1000), cut_message("activate"));
+  nfc_llcp_params remote;
+  cut_assert_equal_int(0, nfc_llcp_link_get_remote_params(link, &remote));
+  cut_assert_equal_int(256, remote.szMiu, cut_message("MIUX"));
+  cut_assert_equal_int(1500, remote.iLto, cut_message("LTO"));
+  cut_assert_equal_int(0x0013, remote.ui16Wks, cut_message("WKS"));
+
+  const int connection = nfc_llcp_connect(link, 0, "urn:nfc:sn:snep", 1000);
+  cut_assert_operator_int(connection, >=, 0, cut_message("connect"));
+
+  // Remote MIU from CC is 144 bytes: SDUs of 144, 144 and 12 bytes
+  uint8_t abtTx[300];
+  uint8_t abtRx[NFC_LLCP_MIU_MAX];
+  for (size_t n = 0; n < sizeof(abtTx); n++)
+    abtTx[n] = n;
+  cut_assert_equal_int(sizeof(abtTx), nfc_llcp_send(link, connection, abtTx, sizeof(abtTx), 1000), cut_message("send"));
+  const size_t aszSdu[] = { 144, 144, 12 };
+  size_t szOffset = 0;
+  for (size_t n = 0; n < sizeof(aszSdu) / sizeof(aszSdu[0]); n++) {
+    const int res = nfc_llcp_receive(link, connection, abtRx, sizeof(abtRx), 1000);
+    cut_assert_equal_int(aszSdu[n], res, cut_message("SDU #%d", (int) n));
+    cut_assert_equal_memory(abtTx + szOffset, aszSdu[n], abtRx, res);
+    szOffset += aszSdu[n];
+  }
+
+  // Sequence numbers are modulo 16
+  for (uint8_t n = 0; n < 18; n++) {
+    cut_assert_equal_int(1, nfc_llcp_send(link, connection, &n, 1, 1000), cut_message("send #%d", n));
+    cut_assert_equal_int(1, nfc_llcp_receive(link, connection, abtRx, sizeof(abtRx), 1000), cut_message("receive #%d", n));
+    cut_assert_equal_int(n, abtRx[0]);
+  }
+
+  // Peer sends 5 I PDUs while our receive window is 4: the 5th one is rejected with FRMR and the connection dropped
+  const uint8_t btFlood = 0xff;
+  cut_assert_equal_int(1, nfc_llcp_send(link, connection, &btFlood, 1, 1000));
+  for (uint8_t n = 0; n < 4; n++) {
+    cut_assert_equal_int(1, nfc_llcp_receive(link, connection, abtRx, sizeof(abtRx), 1000), cut_message("receive in window #%d", n));
+    cut_assert_equal_int(0xf0 + n, abtRx[0]);
+  }
+  cut_assert_equal_int(0, nfc_llcp_receive(link, connection, abtRx, sizeof(abtRx), 1000), cut_message("connection closed"));
+  cut_assert_equal_int(NFC_ETGRELEASED, nfc_llcp_send(link, connection, &btFlood, 1, 1000));
+  cut_assert_equal_int(0, nfc_llcp_close(link, connection, 1000));
+
+  // FRMR goes out with DISC
+  cut_assert_equal_int(0, nfc_llcp_link_deactivate(link), cut_message("deactivate"));
+  nfc_llcp_link_free(link);
+  nfc_close(pnd);
+}
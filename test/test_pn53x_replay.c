@@ -0,0 +1,131 @@
+#include <cutter.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <nfc/nfc.h>
+
+#define TRACE "pn53x_replay_mifare.txt"
+
+void
+cut_setup(void)
+{
+  nfc_init(NULL);
+}
+
+void
+cut_teardown(void)
+{
+  nfc_exit(NULL);
+}
+
+static void
+replay_connstring(nfc_connstring connstring, const char *pcFilename)
+{
+  const char *pcBaseDir = getenv("BASE_DIR");
+  snprintf(connstring, sizeof(nfc_connstring), "pn53x_replay:%s/%s", pcBaseDir ? pcBaseDir : ".", pcFilename);
+}
+
+// Replays what the trace records: select a MIFARE Classic then read its block 4
+static void
+replay_scenario(const nfc_connstring connstring)
+{
+  nfc_device *pnd = nfc_open(NULL, connstring);
+  cut_assert_not_null(pnd, cut_message("Unable to open %s", connstring));
+
+  cut_assert_equal_int(0, nfc_initiator_init(pnd));
+
+  const nfc_modulation nm = { .nmt = NMT_ISO14443A, .nbr = NBR_106 };
+  nfc_target nt;
+  cut_assert_equal_int(1, nfc_initiator_select_passive_target(pnd, nm, NULL, 0, &nt));
+  cut_assert_equal_int(4, nt.nti.nai.szUidLen);
+  cut_assert_equal_memory("\x11\x22\x33\x44", 4, nt.nti.nai.abtUid, nt.nti.nai.szUidLen);
+  cut_assert_equal_int(0x08, nt.nti.nai.btSak);
+
+  const uint8_t abtRead[] = { 0x30, 0x04 };
+  uint8_t abtRx[16];
+  cut_assert_equal_int(16, nfc_initiator_transceive_bytes(pnd, abtRead, sizeof(abtRead), abtRx, sizeof(abtRx), 0));
+  cut_assert_equal_memory("\x40\x41\x42\x43\x44\x45\x46\x47\x48\x49\x4a\x4b\x4c\x4d\x4e\x4f", 16, abtRx, sizeof(abtRx));
+
+  nfc_close(pnd);
+}
+
+void
+test_pn53x_replay_text(void)
+{
+  nfc_connstring connstring;
+  replay_connstring(connstring, TRACE);
+  replay_scenario(connstring);
+}
+
+void
+test_pn53x_replay_mismatch(void)
+{
+  nfc_connstring connstring;
+  replay_connstring(connstring, TRACE);
+  nfc_device *pnd = nfc_open(NULL, connstring);
+  cut_assert_not_null(pnd, cut_message("Unable to open %s", connstring));
+
+  cut_assert_equal_int(0, nfc_initiator_init(pnd));
+
+  // The trace selects an ISO14443A target, not a FeliCa one
+  const nfc_modulation nm = { .nmt = NMT_FELICA, .nbr = NBR_212 };
+  nfc_target nt;
+  cut_assert_operator_int(0, >, nfc_initiator_select_passive_target(pnd, nm, NULL, 0, &nt));
+  cut_assert_equal_int(NFC_EIO, nfc_device_get_last_error(pnd));
+
+  nfc_close(pnd);
+}
+
+void
+test_pn53x_replay_capture(void)
+{
+  nfc_connstring connstring;
+  replay_connstring(connstring, TRACE);
+
+  // Capture the replay itself, from device creation on, then replay the capture
+  char acFilename[] = "/tmp/test_pn53x_replay.pcapng";
+  setenv("LIBNFC_CAPTURE", acFilename, 1);
+  replay_scenario(connstring);
+  unsetenv("LIBNFC_CAPTURE");
+
+  snprintf(connstring, sizeof(nfc_connstring), "pn53x_replay:%s", acFilename);
+  replay_scenario(connstring);
+  remove(acFilename);
+}
+
+void
+test_pn53x_replay_frame_records(void)
+{
+  nfc_connstring connstring;
+  replay_connstring(connstring, TRACE);
+  nfc_device *pnd = nfc_open(NULL, connstring);
+  cut_assert_not_null(pnd, cut_message("Unable to open %s", connstring));
+
+  cut_assert_equal_int(0, nfc_initiator_init(pnd));
+  const nfc_modulation nm = { .nmt = NMT_ISO14443A, .nbr = NBR_106 };
+  nfc_target nt;
+  cut_assert_equal_int(1, nfc_initiator_select_passive_target(pnd, nm, NULL, 0, &nt));
+
+  // Dump records as pn53x-frame-recorder -w does, then replay them
+  nfc_frame_record records[64];
+  const int res = nfc_device_get_frame_records(pnd, records, sizeof(records) / sizeof(records[0]));
+  cut_assert_operator_int(0, <, res);
+  nfc_close(pnd);
+
+  const char *pcFilename = "/tmp/test_pn53x_replay.rec";
+  FILE *f = fopen(pcFilename, "wb");
+  cut_assert_not_null(f);
+  cut_assert_equal_int(res, fwrite(records, sizeof(records[0]), res, f));
+  fclose(f);
+
+  snprintf(connstring, sizeof(nfc_connstring), "pn53x_replay:%s", pcFilename);
+  pnd = nfc_open(NULL, connstring);
+  cut_assert_not_null(pnd, cut_message("Unable to open %s", connstring));
+  cut_assert_equal_int(0, nfc_initiator_init(pnd));
+  cut_assert_equal_int(1, nfc_initiator_select_passive_target(pnd, nm, NULL, 0, &nt));
+  cut_assert_equal_memory("\x11\x22\x33\x44", 4, nt.nti.nai.abtUid, nt.nti.nai.szUidLen);
+  nfc_close(pnd);
+  remove(pcFilename);
+}
@@ -49,6 +49,7 @@
 #include <ctype.h>
 
 #include <nfc/nfc.h>
+#include <nfc/nfc-mfclassic.h>
 
 #include "mifare.h"
 #include "nfc-utils.h"
@@ -58,6 +59,7 @@ static nfc_target nt;
 static mifare_param mp;
 static mifare_classic_tag mtKeys;
 static mifare_classic_tag mtDump;
+static nfc_mfclassic_key_cache mkcKeys;
 static bool bUseKeyA;
 static bool bUseKeyFile;
 static uint8_t uiBlocks;
@@ -256,73 +258,81 @@ unlock_card(void)
   return true;
 }
 
+static  uint8_t
+get_sectors(void)
+{
+  // 4 blocks per sector up to block 127, then 16 blocks per sector
+  if (uiBlocks < 128)
+    return (uiBlocks + 1) / 4;
+  else
+    return 32 + (uiBlocks + 1 - 128) / 16;
+}
+
+static void
+build_keymap(nfc_mfclassic_keymap *pmkm, nfc_mfclassic_key *amkDictionary)
+{
+  const nfc_mfclassic_key_type mkt = (bUseKeyA) ? NFC_MFCLASSIC_KEY_A : NFC_MFCLASSIC_KEY_B;
+
+  // Key file gives the key of each sector, otherwise try to guess the right key
+  memset(pmkm, 0x00, sizeof(*pmkm));
+  if (bUseKeyFile) {
+    for (uint8_t uiSector = 0; uiSector < get_sectors(); uiSector++) {
+      const mifare_classic_block_trailer *pmbt = &mtKeys.amb[get_trailer_block(nfc_mfclassic_sector_first_block(uiSector))].mbt;
+      nfc_mfclassic_key *pmk = &pmkm->amkSector[uiSector][(bUseKeyA) ? 0 : 1];
+      pmk->mkt = mkt;
+      memcpy(pmk->abtKey, (bUseKeyA) ? pmbt->abtKeyA : pmbt->abtKeyB, 6);
+    }
+  } else {
+    for (size_t key_index = 0; key_index < num_keys; key_index++) {
+      amkDictionary[key_index].mkt = mkt;
+      memcpy(amkDictionary[key_index].abtKey, keys + (key_index * 6), 6);
+    }
+    pmkm->pmkDictionary = amkDictionary;
+    pmkm->szDictionary = num_keys;
+  }
+}
+
 static  bool
-read_card(int read_unlocked)
+read_card(int read_unlocked, mifare_classic_tag *pmt, nfc_mfclassic_key *pamkOpened)
 {
-  int32_t iBlock;
-  bool    bFailure = false;
+  nfc_mfclassic_keymap mkm;
+  nfc_mfclassic_key amkDictionary[sizeof(keys) / 6];
   uint32_t uiReadBlocks = 0;
 
   if (read_unlocked)
     if (!unlock_card())
       return false;
 
+  build_keymap(&mkm, amkDictionary);
 
   printf("Reading out %d blocks |", uiBlocks + 1);
 
-  // Read the card from end to begin
-  for (iBlock = uiBlocks; iBlock >= 0; iBlock--) {
-    // Authenticate everytime we reach a trailer block
-    if (is_trailer_block(iBlock)) {
-      // Skip this the first time, bFailure it means nothing (yet)
-      if (iBlock != uiBlocks)
-        print_success_or_failure(bFailure, &uiReadBlocks);
-
-      // Show if the readout went well
-      if (bFailure) {
-        // When a failure occured we need to redo the anti-collision
-        if (nfc_initiator_select_passive_target(pnd, nmMifare, NULL, 0, &nt) < 0) {
-          printf("!\nError: tag was removed\n");
-          return false;
-        }
-        bFailure = false;
-      }
-
-      fflush(stdout);
-
-      // Try to authenticate for the current sector
-      if (!read_unlocked && !authenticate(iBlock)) {
-        printf("!\nError: authentication failed for block 0x%02x\n", iBlock);
-        return false;
-      }
-      // Try to read out the trailer
-      if (nfc_initiator_mifare_cmd(pnd, MC_READ, iBlock, &mp)) {
-        if (read_unlocked) {
-          memcpy(mtDump.amb[iBlock].mbd.abtData, mp.mpd.abtData, 16);
-        } else {
-          // Copy the keys over from our key dump and store the retrieved access bits
-          memcpy(mtDump.amb[iBlock].mbt.abtKeyA, mtKeys.amb[iBlock].mbt.abtKeyA, 6);
-          memcpy(mtDump.amb[iBlock].mbt.abtAccessBits, mp.mpd.abtData + 6, 4);
-          memcpy(mtDump.amb[iBlock].mbt.abtKeyB, mtKeys.amb[iBlock].mbt.abtKeyB, 6);
-        }
-      } else {
-        printf("!\nError: unable to read trailer block 0x%02x\n", iBlock);
-      }
-    } else {
-      // Make sure a earlier readout did not fail
-      if (!bFailure) {
-        // Try to read out the data block
-        if (nfc_initiator_mifare_cmd(pnd, MC_READ, iBlock, &mp)) {
-          memcpy(mtDump.amb[iBlock].mbd.abtData, mp.mpd.abtData, 16);
-        } else {
-          bFailure = true;
-          printf("!\nError: unable to read block 0x%02x\n", iBlock);
-          return false;
-        }
-      }
+  // Authenticate once per sector then read all its blocks
+  for (uint8_t uiSector = 0; uiSector < get_sectors(); uiSector++) {
+    const uint32_t uiFirstBlock = nfc_mfclassic_sector_first_block(uiSector);
+    const uint32_t uiTrailerBlock = get_trailer_block(uiFirstBlock);
+    nfc_mfclassic_key mkOpened;
+
+    fflush(stdout);
+    if (nfc_mfclassic_read_sectors(pnd, &nt, (read_unlocked) ? NULL : &mkm, (read_unlocked) ? NULL : &mkcKeys,
+                                   uiSector, 1, pmt->amb[uiFirstBlock].mbd.abtData, &mkOpened) < 0) {
+      print_success_or_failure(true, &uiReadBlocks);
+      printf("!\nError: unable to read sector %d (block 0x%02x)\n", uiSector, uiFirstBlock);
+      return false;
+    }
+    if (!read_unlocked) {
+      // Keep the key which opened the sector, then copy the keys over from our key dump
+      if (mkOpened.mkt == NFC_MFCLASSIC_KEY_A)
+        memcpy(mtKeys.amb[uiTrailerBlock].mbt.abtKeyA, mkOpened.abtKey, 6);
+      else
+        memcpy(mtKeys.amb[uiTrailerBlock].mbt.abtKeyB, mkOpened.abtKey, 6);
+      memcpy(pmt->amb[uiTrailerBlock].mbt.abtKeyA, mtKeys.amb[uiTrailerBlock].mbt.abtKeyA, 6);
+      memcpy(pmt->amb[uiTrailerBlock].mbt.abtKeyB, mtKeys.amb[uiTrailerBlock].mbt.abtKeyB, 6);
     }
+    if (pamkOpened)
+      pamkOpened[uiSector] = mkOpened;
+    print_success_or_failure(false, &uiReadBlocks);
   }
-  print_success_or_failure(bFailure, &uiReadBlocks);
   printf("|\n");
   printf("Done, %d of %d blocks read.\n", uiReadBlocks, uiBlocks + 1);
   fflush(stdout);
@@ -411,6 +421,151 @@ write_card(int write_block_zero)
   return true;
 }
 
+// Keys of a trailer are not readable: only its access bits and the key which opened the sector are known on the card,
+// so a trailer whose only change is the other key (e.g. no key file given) is not seen as changed
+static bool
+trailer_differs(const mifare_classic_block_trailer *pmbtCard, const mifare_classic_block_trailer *pmbtDump, const nfc_mfclassic_key *pmkOpened)
+{
+  if (memcmp(pmbtCard->abtAccessBits, pmbtDump->abtAccessBits, 4))
+    return true;
+  return memcmp(pmkOpened->abtKey, (pmkOpened->mkt == NFC_MFCLASSIC_KEY_A) ? pmbtDump->abtKeyA : pmbtDump->abtKeyB, 6) != 0;
+}
+
+static  bool
+write_card_differential(void)
+{
+  static mifare_classic_tag mtCard;
+  nfc_mfclassic_key amkOpened[NFC_MFCLASSIC_MAX_SECTORS];
+  bool    abChanged[256];
+  uint32_t uiChangedBlocks = 0;
+  uint32_t uiWriteBlocks = 0;
+
+  // Read current content the fastest way, then compare it with the dump as a read would store it
+  if (!read_card(false, &mtCard, amkOpened))
+    return false;
+
+  memset(abChanged, 0x00, sizeof(abChanged));
+  for (uint8_t uiSector = 0; uiSector < get_sectors(); uiSector++) {
+    const uint32_t uiFirstBlock = nfc_mfclassic_sector_first_block(uiSector);
+    const uint32_t uiTrailerBlock = get_trailer_block(uiFirstBlock);
+
+    // The first block 0x00 is read only, skip this
+    for (uint32_t uiBlock = (uiFirstBlock == 0) ? 1 : uiFirstBlock; uiBlock <= uiTrailerBlock; uiBlock++) {
+      if (uiBlock == uiTrailerBlock)
+        abChanged[uiBlock] = trailer_differs(&mtCard.amb[uiBlock].mbt, &mtDump.amb[uiBlock].mbt, &amkOpened[uiSector]);
+      else
+        abChanged[uiBlock] = (memcmp(mtCard.amb[uiBlock].mbd.abtData, mtDump.amb[uiBlock].mbd.abtData, 16) != 0);
+      if (abChanged[uiBlock])
+        uiChangedBlocks++;
+    }
+  }
+
+  printf("Writing %d changed blocks |", uiChangedBlocks);
+  for (uint8_t uiSector = 0; uiSector < get_sectors(); uiSector++) {
+    const uint32_t uiFirstBlock = nfc_mfclassic_sector_first_block(uiSector);
+    const uint32_t uiTrailerBlock = get_trailer_block(uiFirstBlock);
+    bool bAuthenticated = false;
+
+    for (uint32_t uiBlock = uiFirstBlock; uiBlock <= uiTrailerBlock; uiBlock++) {
+      if (!abChanged[uiBlock])
+        continue;
+      // Authenticate once per changed sector with the key which opened it
+      if (!bAuthenticated) {
+        memcpy(mp.mpa.abtAuthUid, nt.nti.nai.abtUid + nt.nti.nai.szUidLen - 4, 4);
+        memcpy(mp.mpa.abtKey, amkOpened[uiSector].abtKey, 6);
+        if (!nfc_initiator_mifare_cmd(pnd, (mifare_cmd) amkOpened[uiSector].mkt, uiBlock, &mp)) {
+          printf("!\nError: authentication failed for block %02x\n", uiBlock);
+          return false;
+        }
+        bAuthenticated = true;
+      }
+      memcpy(mp.mpd.abtData, mtDump.amb[uiBlock].mbd.abtData, 16);
+      if (!nfc_initiator_mifare_cmd(pnd, MC_WRITE, uiBlock, &mp)) {
+        print_success_or_failure(true, NULL);
+        printf("!\nError: unable to write block 0x%02x\n", uiBlock);
+        return false;
+      }
+      printf(".");
+      uiWriteBlocks++;
+    }
+  }
+  printf("|\n");
+  fflush(stdout);
+
+  // Verify: read back changed sectors, with the dump keys when the trailer was rewritten
+  for (uint8_t uiSector = 0; uiSector < get_sectors(); uiSector++) {
+    const uint32_t uiFirstBlock = nfc_mfclassic_sector_first_block(uiSector);
+    const uint32_t uiTrailerBlock = get_trailer_block(uiFirstBlock);
+    const mifare_classic_block_trailer *pmbt = &mtDump.amb[uiTrailerBlock].mbt;
+    mifare_classic_block amb[16];
+    nfc_mfclassic_keymap mkm;
+    bool bChanged = false;
+
+    for (uint32_t uiBlock = uiFirstBlock; uiBlock <= uiTrailerBlock; uiBlock++)
+      bChanged |= abChanged[uiBlock];
+    if (!bChanged)
+      continue;
+
+    memset(&mkm, 0x00, sizeof(mkm));
+    mkm.amkSector[uiSector][0] = amkOpened[uiSector];
+    mkm.amkSector[uiSector][1].mkt = amkOpened[uiSector].mkt;
+    memcpy(mkm.amkSector[uiSector][1].abtKey, (amkOpened[uiSector].mkt == NFC_MFCLASSIC_KEY_A) ? pmbt->abtKeyA : pmbt->abtKeyB, 6);
+    if (abChanged[uiTrailerBlock]) {
+      const nfc_mfclassic_key mk = mkm.amkSector[uiSector][0];
+      mkm.amkSector[uiSector][0] = mkm.amkSector[uiSector][1];
+      mkm.amkSector[uiSector][1] = mk;
+    }
+    if (nfc_mfclassic_read_sectors(pnd, &nt, &mkm, NULL, uiSector, 1, amb[0].mbd.abtData, NULL) < 0) {
+      printf("Error: unable to read back sector %d\n", uiSector);
+      return false;
+    }
+    for (uint32_t uiBlock = uiFirstBlock; uiBlock <= uiTrailerBlock; uiBlock++) {
+      const mifare_classic_block *pmb = &amb[uiBlock - uiFirstBlock];
+      // Keys of the trailer are not readable, only check its access bits
+      if (abChanged[uiBlock] && ((uiBlock == uiTrailerBlock) ?
+                                 memcmp(pmb->mbt.abtAccessBits, pmbt->abtAccessBits, 4) :
+                                 memcmp(pmb->mbd.abtData, mtDump.amb[uiBlock].mbd.abtData, 16))) {
+        printf("Error: block 0x%02x does not match the dump\n", uiBlock);
+        return false;
+      }
+    }
+  }
+  printf("Done, %d of %d blocks written (%d unchanged), verified.\n", uiWriteBlocks, uiBlocks + 1, uiBlocks + 1 - uiChangedBlocks);
+  fflush(stdout);
+
+  return true;
+}
+
+// Keys which opened sectors are kept between runs in the file named by NFC_MFCLASSIC_KEY_CACHE
+static void
+load_key_cache(void)
+{
+  const char *pcKeyCache = getenv("NFC_MFCLASSIC_KEY_CACHE");
+  FILE *pfKeyCache;
+
+  if (!pcKeyCache || !(pfKeyCache = fopen(pcKeyCache, "rb")))
+    return;
+  if (fread(&mkcKeys, 1, sizeof(mkcKeys), pfKeyCache) != sizeof(mkcKeys)) {
+    printf("Ignoring invalid key cache file: %s\n", pcKeyCache);
+    memset(&mkcKeys, 0x00, sizeof(mkcKeys));
+  }
+  fclose(pfKeyCache);
+}
+
+static void
+save_key_cache(void)
+{
+  const char *pcKeyCache = getenv("NFC_MFCLASSIC_KEY_CACHE");
+  FILE *pfKeyCache;
+
+  if (!pcKeyCache)
+    return;
+  if (!(pfKeyCache = fopen(pcKeyCache, "wb")) || (fwrite(&mkcKeys, 1, sizeof(mkcKeys), pfKeyCache) != sizeof(mkcKeys)))
+    printf("Could not write key cache file: %s\n", pcKeyCache);
+  if (pfKeyCache)
+    fclose(pfKeyCache);
+}
+
 typedef enum {
   ACTION_READ,
   ACTION_WRITE,
@@ -421,8 +576,10 @@ static void
 print_usage(const char *pcProgramName)
 {
   printf("Usage: ");
-  printf("%s r|R|w|W a|b <dump.mfd> [<keys.mfd>]\n", pcProgramName);
-  printf("  r|R|w|W       - Perform read from (r) or unlocked read from (R) or write to (w) or unlocked write to (W) card\n");
+  printf("%s r|R|w|W|d a|b <dump.mfd> [<keys.mfd>]\n", pcProgramName);
+  printf("  r|R|w|W|d     - Perform read from (r) or unlocked read from (R) or write to (w) or unlocked write to (W) or differential write to (d) card\n");
+  printf("                  *** differential write reads the card first, then writes only the blocks which differ and reads them back\n");
+  printf("                  *** differential write compares trailers on their access bits and the key which opened the sector only\n");
   printf("                  *** note that unlocked write will attempt to overwrite block 0 including UID\n");
   printf("                  *** unlocked read does not require authentication and will reveal A and B keys\n");
   printf("                  *** unlocking only works with special Mifare 1K cards (Chinese clones)\n");
@@ -439,6 +596,7 @@ main(int argc, const char *argv[])
   FILE   *pfKeys = NULL;
   FILE   *pfDump = NULL;
   int    unlock = 0;
+  bool   bDifferential = false;
 
   if (argc < 2) {
     print_usage(argv[0]);
@@ -456,7 +614,7 @@ main(int argc, const char *argv[])
       unlock = 1;
     bUseKeyA = tolower((int)((unsigned char) * (argv[2]))) == 'a';
     bUseKeyFile = (argc > 4);
-  } else if (strcmp(command, "w") == 0 || strcmp(command, "W") == 0) {
+  } else if (strcmp(command, "w") == 0 || strcmp(command, "W") == 0 || strcmp(command, "d") == 0) {
     if (argc < 4) {
       print_usage(argv[0]);
       exit(EXIT_FAILURE);
@@ -464,6 +622,8 @@ main(int argc, const char *argv[])
     atAction = ACTION_WRITE;
     if (strcmp(command, "W") == 0)
       unlock = 1;
+    if (strcmp(command, "d") == 0)
+      bDifferential = true;
     bUseKeyA = tolower((int)((unsigned char) * (argv[2]))) == 'a';
     bUseKeyFile = (argc > 4);
   }
@@ -573,7 +733,9 @@ main(int argc, const char *argv[])
       printf("Guessing size: seems to be a %i-byte card\n", (uiBlocks + 1) * 16);
 
       if (atAction == ACTION_READ) {
-        if (read_card(unlock)) {
+        load_key_cache();
+        if (read_card(unlock, &mtDump, NULL)) {
+          save_key_cache();
           printf("Writing data to file: %s ...", argv[3]);
           fflush(stdout);
           pfDump = fopen(argv[3], "wb");
@@ -589,7 +751,13 @@ main(int argc, const char *argv[])
           fclose(pfDump);
         }
       } else if (atAction == ACTION_WRITE) {
-        write_card(unlock);
+        if (bDifferential) {
+          load_key_cache();
+          if (write_card_differential())
+            save_key_cache();
+        } else {
+          write_card(unlock);
+        }
       }
 
       nfc_close(pnd);
@@ -47,6 +47,7 @@
 #include <ctype.h>
 
 #include <nfc/nfc.h>
+#include <nfc/nfc-type2.h>
 
 #include "nfc-utils.h"
 #include "mifare.h"
@@ -54,7 +55,9 @@
 static nfc_device *pnd;
 static nfc_target nt;
 static mifare_param mp;
-static mifareul_tag mtDump;
+static nfc_type2_info nti;
+static uint8_t abtDump[NFC_TYPE2_MAX_PAGES * NFC_TYPE2_PAGE_LEN];
+// Original MIFARE Ultralight dumps hold 16 pages
 static uint32_t uiBlocks = 0xF;
 
 static const nfc_modulation nmMifare = {
@@ -77,20 +80,24 @@ read_card(void)
   bool    bFailure = false;
   uint32_t uiReadedPages = 0;
 
+  if (nfc_type2_identify(pnd, &nt, &nti) < 0) {
+    nfc_perror(pnd, "nfc_type2_identify");
+    return false;
+  }
+  if (nti.bFastRead) {
+    printf("GET_VERSION: ");
+    print_hex(nti.abtVersion, sizeof(nti.abtVersion));
+  }
+  uiBlocks = nti.szPages - 1;
+
   printf("Reading %d pages |", uiBlocks + 1);
+  fflush(stdout);
 
-  for (page = 0; page <= uiBlocks; page += 4) {
-    // Try to read out the data block
-    if (nfc_initiator_mifare_cmd(pnd, MC_READ, page, &mp)) {
-      memcpy(mtDump.amb[page / 4].mbd.abtData, mp.mpd.abtData, 16);
-    } else {
-      bFailure = true;
-      break;
-    }
+  // The whole memory is read at once: a few FAST_READ, or READ 4 pages by 4 pages
+  if (nfc_type2_read(pnd, &nti, 0, abtDump, nti.szPages) < 0)
+    bFailure = true;
 
-    print_success_or_failure(bFailure, &uiReadedPages);
-    print_success_or_failure(bFailure, &uiReadedPages);
-    print_success_or_failure(bFailure, &uiReadedPages);
+  for (page = 0; page <= uiBlocks; page++) {
     print_success_or_failure(bFailure, &uiReadedPages);
   }
   printf("|\n");
@@ -101,12 +108,13 @@ read_card(void)
 }
 
 static  bool
-write_card(void)
+write_card(bool bDifferential)
 {
-  uint32_t uiBlock = 0;
   bool    bFailure = false;
   uint32_t uiWritenPages = 0;
   uint32_t uiSkippedPages;
+  uint8_t abtCard[(0xF + 1) * NFC_TYPE2_PAGE_LEN];
+  bool    abWritten[0xF + 1];
 
   char    buffer[BUFSIZ];
   bool    write_otp;
@@ -123,6 +131,19 @@ write_card(void)
   }
   write_lock = ((buffer[0] == 'y') || (buffer[0] == 'Y'));
 
+  // Differential write: read current content the fastest way, then write only pages which differ
+  memset(abWritten, 0x00, sizeof(abWritten));
+  if (bDifferential) {
+    if (nfc_type2_identify(pnd, &nt, &nti) < 0) {
+      nfc_perror(pnd, "nfc_type2_identify");
+      return false;
+    }
+    if (nfc_type2_read(pnd, &nti, 0, abtCard, 0xF + 1) < 0) {
+      nfc_perror(pnd, "nfc_type2_read");
+      return false;
+    }
+  }
+
   printf("Writing %d pages |", uiBlocks + 1);
   /* We need to skip 2 first pages. */
   printf("ss");
@@ -139,6 +160,11 @@ write_card(void)
       uiSkippedPages++;
       continue;
     }
+    if (bDifferential && !memcmp(abtCard + (page * NFC_TYPE2_PAGE_LEN), abtDump + (page * NFC_TYPE2_PAGE_LEN), NFC_TYPE2_PAGE_LEN)) {
+      printf("s");
+      uiSkippedPages++;
+      continue;
+    }
     // Show if the readout went well
     if (bFailure) {
       // When a failure occured we need to redo the anti-collision
@@ -152,16 +178,31 @@ write_card(void)
     // in compatibility mode, which only actually writes the first
     // page (4 bytes). The Ultralight-specific Write command only
     // writes one page at a time.
-    uiBlock = page / 4;
-    memcpy(mp.mpd.abtData, mtDump.amb[uiBlock].mbd.abtData + ((page % 4) * 4), 16);
+    memcpy(mp.mpd.abtData, abtDump + (page * NFC_TYPE2_PAGE_LEN), 16);
     if (!nfc_initiator_mifare_cmd(pnd, MC_WRITE, page, &mp))
       bFailure = true;
+    abWritten[page] = !bFailure;
 
     print_success_or_failure(bFailure, &uiWritenPages);
   }
   printf("|\n");
   printf("Done, %d of %d pages written (%d pages skipped).\n", uiWritenPages, uiBlocks + 1, uiSkippedPages);
 
+  // Verify written pages with a single read of the whole range
+  if (bDifferential && uiWritenPages) {
+    if (nfc_type2_read(pnd, &nti, 0, abtCard, 0xF + 1) < 0) {
+      nfc_perror(pnd, "nfc_type2_read");
+      return false;
+    }
+    for (int page = 0x2; page <= 0xF; page++) {
+      if (abWritten[page] && memcmp(abtCard + (page * NFC_TYPE2_PAGE_LEN), abtDump + (page * NFC_TYPE2_PAGE_LEN), NFC_TYPE2_PAGE_LEN)) {
+        ERR("page 0x%02x does not match the dump", page);
+        return false;
+      }
+    }
+    printf("Written pages verified.\n");
+  }
+
   return true;
 }
 
@@ -169,13 +210,14 @@ int
 main(int argc, const char *argv[])
 {
   bool    bReadAction;
+  bool    bDifferential;
   FILE   *pfDump;
 
   if (argc < 3) {
     printf("\n");
-    printf("%s r|w <dump.mfd>\n", argv[0]);
+    printf("%s r|w|d <dump.mfd>\n", argv[0]);
     printf("\n");
-    printf("r|w         - Perform read from or write to card\n");
+    printf("r|w|d       - Perform read from or write to card, or differential write (only pages which differ, then verified)\n");
     printf("<dump.mfd>  - MiFare Dump (MFD) used to write (card to MFD) or (MFD to card)\n");
     printf("\n");
     return 1;
@@ -184,9 +226,10 @@ main(int argc, const char *argv[])
   DBG("\nChecking arguments and settings\n");
 
   bReadAction = tolower((int)((unsigned char) * (argv[1])) == 'r');
+  bDifferential = tolower((int)((unsigned char) * (argv[1])) == 'd');
 
   if (bReadAction) {
-    memset(&mtDump, 0x00, sizeof(mtDump));
+    memset(abtDump, 0x00, sizeof(abtDump));
   } else {
     pfDump = fopen(argv[2], "rb");
 
@@ -195,7 +238,8 @@ main(int argc, const char *argv[])
       return 1;
     }
 
-    if (fread(&mtDump, 1, sizeof(mtDump), pfDump) != sizeof(mtDump)) {
+    // Dumps of bigger tags (NTAG, MIFARE Ultralight EV1) begin with the 16 pages written back
+    if (fread(abtDump, 1, sizeof(abtDump), pfDump) < (uiBlocks + 1) * NFC_TYPE2_PAGE_LEN) {
       ERR("Could not read from dump file: %s\n", argv[2]);
       fclose(pfDump);
       return 1;
@@ -258,7 +302,7 @@ main(int argc, const char *argv[])
         printf("Could not open file: %s\n", argv[2]);
         return EXIT_FAILURE;
       }
-      if (fwrite(&mtDump, 1, sizeof(mtDump), pfDump) != sizeof(mtDump)) {
+      if (fwrite(abtDump, 1, (uiBlocks + 1) * NFC_TYPE2_PAGE_LEN, pfDump) != (uiBlocks + 1) * NFC_TYPE2_PAGE_LEN) {
         printf("Could not write to file: %s\n", argv[2]);
         return EXIT_FAILURE;
       }
@@ -266,7 +310,7 @@ main(int argc, const char *argv[])
       printf("Done.\n");
     }
   } else {
-    write_card();
+    write_card(bDifferential);
   }
 
   nfc_close(pnd);
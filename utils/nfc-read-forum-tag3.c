@@ -52,6 +52,7 @@
 #include <unistd.h>
 
 #include <nfc/nfc.h>
+#include <nfc/nfc-felica.h>
 
 #include "nfc-utils.h"
 
@@ -74,79 +75,6 @@ static void stop_select(int sig)
     exit(EXIT_FAILURE);
 }
 
-static void
-build_felica_frame(const nfc_felica_info nfi, const uint8_t command, const uint8_t *payload, const size_t payload_len, uint8_t *frame, size_t *frame_len)
-{
-  frame[0] = 1 + 1 + 8 + payload_len;
-  *frame_len = frame[0];
-  frame[1] = command;
-  memcpy(frame + 2, nfi.abtId, 8);
-  memcpy(frame + 10, payload, payload_len);
-}
-
-#define CHECK 		0x06
-static int
-nfc_forum_tag_type3_check(nfc_device *dev, const nfc_target nt, const uint16_t block, const uint8_t block_count, uint8_t *data, size_t *data_len)
-{
-  uint8_t payload[1024] = {
-    1, // Services
-    0x0B, 0x00, // NFC Forum Tag Type 3's Service code
-    block_count,
-    0x80, block, // block 0
-  };
-
-  size_t payload_len = 1 + 2 + 1;
-  for (uint8_t b = 0; b < block_count; b++) {
-    if (block < 0x100) {
-      payload[payload_len++] = 0x80;
-      payload[payload_len++] = block + b;
-    } else {
-      payload[payload_len++] = 0x00;
-      payload[payload_len++] = (block + b) >> 8;
-      payload[payload_len++] = (block + b) & 0xff;
-    }
-  }
-
-  uint8_t frame[1024];
-  size_t frame_len = sizeof(frame);
-  build_felica_frame(nt.nti.nfi, CHECK, payload, payload_len, frame, &frame_len);
-
-  uint8_t rx[1024];
-  int res;
-  if ((res = nfc_initiator_transceive_bytes(dev, frame, frame_len, rx, sizeof(rx), 0)) < 0) {
-    return res;
-  }
-  const int res_overhead = 1 + 1 + 8 + 2;  // 1+1+8+2: LEN + CMD + NFCID2 + STATUS
-  if (res < res_overhead) {
-    // Not enough data
-    return -1;
-  }
-  uint8_t felica_res_len = rx[0];
-  if (res != felica_res_len) {
-    // Error while receiving felica frame
-    return -1;
-  }
-  if ((CHECK + 1) != rx[1]) {
-    // Command return does not match
-    return -1;
-  }
-  if (0 != memcmp(&rx[2], nt.nti.nfi.abtId, 8)) {
-    // NFCID2 does not match
-    return -1;
-  }
-  const uint8_t status_flag1 = rx[10];
-  const uint8_t status_flag2 = rx[11];
-  if ((status_flag1) || (status_flag2)) {
-    // Felica card's error
-    fprintf(stderr, "Status bytes: %02x, %02x\n", status_flag1, status_flag2);
-    return -1;
-  }
-  // const uint8_t res_block_count = res[12];
-  *data_len = res - res_overhead + 1; // +1 => block count is stored on 1 byte
-  memcpy(data, &rx[res_overhead + 1], *data_len);
-  return *data_len;
-}
-
 int
 main(int argc, char *argv[])
 {
@@ -247,67 +175,58 @@ main(int argc, char *argv[])
 
   //print_nfc_felica_info(nt.nti.nfi, true);
 
-  if ((nfc_device_set_property_bool(pnd, NP_EASY_FRAMING, false) < 0) || (nfc_device_set_property_bool(pnd, NP_INFINITE_SELECT, false) < 0)) {
+  if (nfc_device_set_property_bool(pnd, NP_INFINITE_SELECT, false) < 0) {
     nfc_perror(pnd, "nfc_device_set_property_bool");
     error = EXIT_FAILURE;
     goto error;
   }
 
-  uint8_t data[1024];
-  size_t data_len = sizeof(data);
-  int len;
-
-  if (0 >= (len = nfc_forum_tag_type3_check(pnd, nt, 0, 1, data, &data_len))) {
-    nfc_perror(pnd, "nfc_forum_tag_type3_check");
+  nfc_felica_attribute_info nfai;
+  if (nfc_felica_read_attribute_info(pnd, &nt, &nfai) < 0) {
+    nfc_perror(pnd, "nfc_felica_read_attribute_info");
     error = EXIT_FAILURE;
     goto error;
   }
 
-  const int ndef_major_version = (data[0] & 0xf0) >> 4;
-  const int ndef_minor_version = (data[0] & 0x0f);
+  const int ndef_major_version = (nfai.ui8Version & 0xf0) >> 4;
+  const int ndef_minor_version = (nfai.ui8Version & 0x0f);
   fprintf(message_stream, "NDEF Mapping version: %d.%d\n", ndef_major_version, ndef_minor_version);
+  fprintf(message_stream, "NFC Forum Tag Type 3 capacity: %d bytes\n", nfai.ui16Nmaxb * NFC_FELICA_BLOCK_LEN);
+  fprintf(message_stream, "NDEF data length: %d bytes\n", nfai.ui32Ln);
 
-  const int available_block_count = (data[3] << 8) + data[4];
-  fprintf(message_stream, "NFC Forum Tag Type 3 capacity: %d bytes\n", available_block_count * 16);
-
-  uint32_t ndef_data_len = (data[11] << 16) + (data[12] << 8) + data[13];
-  fprintf(message_stream, "NDEF data length: %d bytes\n", ndef_data_len);
-
-  uint16_t ndef_calculated_checksum = 0;
-  for (size_t n = 0; n < 14; n++)
-    ndef_calculated_checksum += data[n];
-
-  const uint16_t ndef_checksum = (data[14] << 8) + data[15];
-  if (ndef_calculated_checksum != ndef_checksum) {
-    fprintf(stderr, "NDEF CRC does not match with calculated one\n");
+  if (!nfai.ui32Ln) {
+    fprintf(stderr, "Empty NFC Forum Tag Type 3\n");
     error = EXIT_FAILURE;
     goto error;
   }
 
-  if (!ndef_data_len) {
-    fprintf(stderr, "Empty NFC Forum Tag Type 3\n");
+  const size_t block_count_to_check = (nfai.ui32Ln + NFC_FELICA_BLOCK_LEN - 1) / NFC_FELICA_BLOCK_LEN;
+  if (block_count_to_check > nfai.ui16Nmaxb) {
+    fprintf(stderr, "NDEF data length exceeds tag capacity\n");
     error = EXIT_FAILURE;
     goto error;
   }
 
-  const uint8_t block_max_per_check = data[1];
-  const uint16_t block_count_to_check = (ndef_data_len / 16) + 1;
-
-  data_len = 0;
-  for (uint16_t b = 0; b < (block_count_to_check / block_max_per_check); b += block_max_per_check) {
-    size_t size = sizeof(data) - data_len;
-    if (!nfc_forum_tag_type3_check(pnd, nt, 1 + b, MIN(block_max_per_check, (block_count_to_check - (b * block_max_per_check))), data + data_len, &size)) {
-      nfc_perror(pnd, "nfc_forum_tag_type3_check");
-      error = EXIT_FAILURE;
-      goto error;
-    }
-    data_len += size;
+  // NDEF data follow attribute information block, read Nbr blocks per Check command
+  uint8_t *data = malloc(block_count_to_check * NFC_FELICA_BLOCK_LEN);
+  if (!data) {
+    ERR("malloc");
+    error = EXIT_FAILURE;
+    goto error;
+  }
+  if (nfc_felica_check(pnd, &nt, NFC_FELICA_SERVICE_NDEF_RO, 1, data, block_count_to_check, nfai.ui8Nbr) < 0) {
+    nfc_perror(pnd, "nfc_felica_check");
+    free(data);
+    error = EXIT_FAILURE;
+    goto error;
   }
-  if (fwrite(data, 1, data_len, ndef_stream) != data_len) {
+  if (fwrite(data, 1, nfai.ui32Ln, ndef_stream) != nfai.ui32Ln) {
     fprintf(stderr, "Could not write to file.\n");
+    free(data);
     error = EXIT_FAILURE;
     goto error;
   }
+  free(data);
 
 error:
   fclose(ndef_stream);
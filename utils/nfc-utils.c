@@ -47,9 +47,21 @@ oddparity(const uint8_t bt)
 void
 oddparity_bytes_ts(const uint8_t *pbtData, const size_t szLen, uint8_t *pbtPar)
 {
-  size_t  szByteNr;
-  // Calculate the parity bits for the command
-  for (szByteNr = 0; szByteNr < szLen; szByteNr++) {
+  size_t  szByteNr = 0;
+  // Calculate the parity bits for the command, 8 bytes at once:
+  // folding each byte onto itself leaves its parity in its lowest bit
+  for (; szByteNr + 8 <= szLen; szByteNr += 8) {
+    uint64_t ui64Bytes = 0;
+    for (int n = 0; n < 8; n++)
+      ui64Bytes |= (uint64_t) pbtData[szByteNr + n] << (8 * n);
+    ui64Bytes ^= ui64Bytes >> 4;
+    ui64Bytes ^= ui64Bytes >> 2;
+    ui64Bytes ^= ui64Bytes >> 1;
+    ui64Bytes = ~ui64Bytes;
+    for (int n = 0; n < 8; n++)
+      pbtPar[szByteNr + n] = (ui64Bytes >> (8 * n)) & 1;
+  }
+  for (; szByteNr < szLen; szByteNr++) {
     pbtPar[szByteNr] = oddparity(pbtData[szByteNr]);
   }
 }